@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../../bin/echo-d"
+  "../../bin/echo-d.pdb"
+  "CMakeFiles/echo.dir/main.cpp.o"
+  "CMakeFiles/echo.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/echo.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
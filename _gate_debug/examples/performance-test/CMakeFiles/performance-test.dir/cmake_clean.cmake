@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../../bin/performance-test-d"
+  "../../bin/performance-test-d.pdb"
+  "CMakeFiles/performance-test.dir/main.cpp.o"
+  "CMakeFiles/performance-test.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/performance-test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
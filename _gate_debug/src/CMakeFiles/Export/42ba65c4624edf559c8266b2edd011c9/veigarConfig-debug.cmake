@@ -0,0 +1,19 @@
+#----------------------------------------------------------------
+# Generated CMake target import file for configuration "Debug".
+#----------------------------------------------------------------
+
+# Commands may need to know the format version.
+set(CMAKE_IMPORT_FILE_VERSION 1)
+
+# Import target "veigar::veigar" for configuration "Debug"
+set_property(TARGET veigar::veigar APPEND PROPERTY IMPORTED_CONFIGURATIONS DEBUG)
+set_target_properties(veigar::veigar PROPERTIES
+  IMPORTED_LINK_INTERFACE_LANGUAGES_DEBUG "CXX"
+  IMPORTED_LOCATION_DEBUG "${_IMPORT_PREFIX}/lib/libveigar-static-d.a"
+  )
+
+list(APPEND _cmake_import_check_targets veigar::veigar )
+list(APPEND _cmake_import_check_files_for_veigar::veigar "${_IMPORT_PREFIX}/lib/libveigar-static-d.a" )
+
+# Commands beyond this point should not need to know the version.
+set(CMAKE_IMPORT_FILE_VERSION)
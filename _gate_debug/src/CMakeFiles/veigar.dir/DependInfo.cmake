@@ -0,0 +1,47 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/broadcast_ring.cpp" "src/CMakeFiles/veigar.dir/broadcast_ring.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/broadcast_ring.cpp.o.d"
+  "/root/repo/src/call_context.cpp" "src/CMakeFiles/veigar.dir/call_context.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/call_context.cpp.o.d"
+  "/root/repo/src/call_dispatcher.cpp" "src/CMakeFiles/veigar.dir/call_dispatcher.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/call_dispatcher.cpp.o.d"
+  "/root/repo/src/call_future.cpp" "src/CMakeFiles/veigar.dir/call_future.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/call_future.cpp.o.d"
+  "/root/repo/src/call_scheduler.cpp" "src/CMakeFiles/veigar.dir/call_scheduler.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/call_scheduler.cpp.o.d"
+  "/root/repo/src/event.cpp" "src/CMakeFiles/veigar.dir/event.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/event.cpp.o.d"
+  "/root/repo/src/flow_control.cpp" "src/CMakeFiles/veigar.dir/flow_control.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/flow_control.cpp.o.d"
+  "/root/repo/src/log.cpp" "src/CMakeFiles/veigar.dir/log.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/log.cpp.o.d"
+  "/root/repo/src/message_queue.cpp" "src/CMakeFiles/veigar.dir/message_queue.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/message_queue.cpp.o.d"
+  "/root/repo/src/multi_call.cpp" "src/CMakeFiles/veigar.dir/multi_call.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/multi_call.cpp.o.d"
+  "/root/repo/src/priority_selector.cpp" "src/CMakeFiles/veigar.dir/priority_selector.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/priority_selector.cpp.o.d"
+  "/root/repo/src/recv_buffer_pool.cpp" "src/CMakeFiles/veigar.dir/recv_buffer_pool.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/recv_buffer_pool.cpp.o.d"
+  "/root/repo/src/resp_dispatcher.cpp" "src/CMakeFiles/veigar.dir/resp_dispatcher.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/resp_dispatcher.cpp.o.d"
+  "/root/repo/src/responder.cpp" "src/CMakeFiles/veigar.dir/responder.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/responder.cpp.o.d"
+  "/root/repo/src/response.cpp" "src/CMakeFiles/veigar.dir/response.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/response.cpp.o.d"
+  "/root/repo/src/run_time_recorder.cpp" "src/CMakeFiles/veigar.dir/run_time_recorder.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/run_time_recorder.cpp.o.d"
+  "/root/repo/src/semaphore.cpp" "src/CMakeFiles/veigar.dir/semaphore.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/semaphore.cpp.o.d"
+  "/root/repo/src/sender.cpp" "src/CMakeFiles/veigar.dir/sender.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/sender.cpp.o.d"
+  "/root/repo/src/shared_memory.cpp" "src/CMakeFiles/veigar.dir/shared_memory.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/shared_memory.cpp.o.d"
+  "/root/repo/src/stream.cpp" "src/CMakeFiles/veigar.dir/stream.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/stream.cpp.o.d"
+  "/root/repo/src/stream_credit.cpp" "src/CMakeFiles/veigar.dir/stream_credit.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/stream_credit.cpp.o.d"
+  "/root/repo/src/string_helper.cpp" "src/CMakeFiles/veigar.dir/string_helper.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/string_helper.cpp.o.d"
+  "/root/repo/src/thread_util.cpp" "src/CMakeFiles/veigar.dir/thread_util.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/thread_util.cpp.o.d"
+  "/root/repo/src/time_util.cpp" "src/CMakeFiles/veigar.dir/time_util.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/time_util.cpp.o.d"
+  "/root/repo/src/topic_hub.cpp" "src/CMakeFiles/veigar.dir/topic_hub.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/topic_hub.cpp.o.d"
+  "/root/repo/src/uuid.cpp" "src/CMakeFiles/veigar.dir/uuid.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/uuid.cpp.o.d"
+  "/root/repo/src/veigar.cpp" "src/CMakeFiles/veigar.dir/veigar.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/veigar.cpp.o.d"
+  "/root/repo/src/work_stealing_pool.cpp" "src/CMakeFiles/veigar.dir/work_stealing_pool.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/work_stealing_pool.cpp.o.d"
+  "/root/repo/src/worker_group.cpp" "src/CMakeFiles/veigar.dir/worker_group.cpp.o" "gcc" "src/CMakeFiles/veigar.dir/worker_group.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
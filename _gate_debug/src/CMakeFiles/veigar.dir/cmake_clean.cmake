@@ -0,0 +1,67 @@
+file(REMOVE_RECURSE
+  "../lib/libveigar-static-d.a"
+  "../lib/libveigar-static-d.pdb"
+  "CMakeFiles/veigar.dir/broadcast_ring.cpp.o"
+  "CMakeFiles/veigar.dir/broadcast_ring.cpp.o.d"
+  "CMakeFiles/veigar.dir/call_context.cpp.o"
+  "CMakeFiles/veigar.dir/call_context.cpp.o.d"
+  "CMakeFiles/veigar.dir/call_dispatcher.cpp.o"
+  "CMakeFiles/veigar.dir/call_dispatcher.cpp.o.d"
+  "CMakeFiles/veigar.dir/call_future.cpp.o"
+  "CMakeFiles/veigar.dir/call_future.cpp.o.d"
+  "CMakeFiles/veigar.dir/call_scheduler.cpp.o"
+  "CMakeFiles/veigar.dir/call_scheduler.cpp.o.d"
+  "CMakeFiles/veigar.dir/event.cpp.o"
+  "CMakeFiles/veigar.dir/event.cpp.o.d"
+  "CMakeFiles/veigar.dir/flow_control.cpp.o"
+  "CMakeFiles/veigar.dir/flow_control.cpp.o.d"
+  "CMakeFiles/veigar.dir/log.cpp.o"
+  "CMakeFiles/veigar.dir/log.cpp.o.d"
+  "CMakeFiles/veigar.dir/message_queue.cpp.o"
+  "CMakeFiles/veigar.dir/message_queue.cpp.o.d"
+  "CMakeFiles/veigar.dir/multi_call.cpp.o"
+  "CMakeFiles/veigar.dir/multi_call.cpp.o.d"
+  "CMakeFiles/veigar.dir/priority_selector.cpp.o"
+  "CMakeFiles/veigar.dir/priority_selector.cpp.o.d"
+  "CMakeFiles/veigar.dir/recv_buffer_pool.cpp.o"
+  "CMakeFiles/veigar.dir/recv_buffer_pool.cpp.o.d"
+  "CMakeFiles/veigar.dir/resp_dispatcher.cpp.o"
+  "CMakeFiles/veigar.dir/resp_dispatcher.cpp.o.d"
+  "CMakeFiles/veigar.dir/responder.cpp.o"
+  "CMakeFiles/veigar.dir/responder.cpp.o.d"
+  "CMakeFiles/veigar.dir/response.cpp.o"
+  "CMakeFiles/veigar.dir/response.cpp.o.d"
+  "CMakeFiles/veigar.dir/run_time_recorder.cpp.o"
+  "CMakeFiles/veigar.dir/run_time_recorder.cpp.o.d"
+  "CMakeFiles/veigar.dir/semaphore.cpp.o"
+  "CMakeFiles/veigar.dir/semaphore.cpp.o.d"
+  "CMakeFiles/veigar.dir/sender.cpp.o"
+  "CMakeFiles/veigar.dir/sender.cpp.o.d"
+  "CMakeFiles/veigar.dir/shared_memory.cpp.o"
+  "CMakeFiles/veigar.dir/shared_memory.cpp.o.d"
+  "CMakeFiles/veigar.dir/stream.cpp.o"
+  "CMakeFiles/veigar.dir/stream.cpp.o.d"
+  "CMakeFiles/veigar.dir/stream_credit.cpp.o"
+  "CMakeFiles/veigar.dir/stream_credit.cpp.o.d"
+  "CMakeFiles/veigar.dir/string_helper.cpp.o"
+  "CMakeFiles/veigar.dir/string_helper.cpp.o.d"
+  "CMakeFiles/veigar.dir/thread_util.cpp.o"
+  "CMakeFiles/veigar.dir/thread_util.cpp.o.d"
+  "CMakeFiles/veigar.dir/time_util.cpp.o"
+  "CMakeFiles/veigar.dir/time_util.cpp.o.d"
+  "CMakeFiles/veigar.dir/topic_hub.cpp.o"
+  "CMakeFiles/veigar.dir/topic_hub.cpp.o.d"
+  "CMakeFiles/veigar.dir/uuid.cpp.o"
+  "CMakeFiles/veigar.dir/uuid.cpp.o.d"
+  "CMakeFiles/veigar.dir/veigar.cpp.o"
+  "CMakeFiles/veigar.dir/veigar.cpp.o.d"
+  "CMakeFiles/veigar.dir/work_stealing_pool.cpp.o"
+  "CMakeFiles/veigar.dir/work_stealing_pool.cpp.o.d"
+  "CMakeFiles/veigar.dir/worker_group.cpp.o"
+  "CMakeFiles/veigar.dir/worker_group.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/veigar.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
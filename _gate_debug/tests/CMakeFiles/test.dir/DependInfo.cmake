@@ -0,0 +1,60 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/broadcast_ring.cpp" "tests/CMakeFiles/test.dir/__/src/broadcast_ring.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/broadcast_ring.cpp.o.d"
+  "/root/repo/src/call_context.cpp" "tests/CMakeFiles/test.dir/__/src/call_context.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/call_context.cpp.o.d"
+  "/root/repo/src/call_dispatcher.cpp" "tests/CMakeFiles/test.dir/__/src/call_dispatcher.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/call_dispatcher.cpp.o.d"
+  "/root/repo/src/call_future.cpp" "tests/CMakeFiles/test.dir/__/src/call_future.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/call_future.cpp.o.d"
+  "/root/repo/src/call_scheduler.cpp" "tests/CMakeFiles/test.dir/__/src/call_scheduler.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/call_scheduler.cpp.o.d"
+  "/root/repo/src/event.cpp" "tests/CMakeFiles/test.dir/__/src/event.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/event.cpp.o.d"
+  "/root/repo/src/flow_control.cpp" "tests/CMakeFiles/test.dir/__/src/flow_control.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/flow_control.cpp.o.d"
+  "/root/repo/src/log.cpp" "tests/CMakeFiles/test.dir/__/src/log.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/log.cpp.o.d"
+  "/root/repo/src/message_queue.cpp" "tests/CMakeFiles/test.dir/__/src/message_queue.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/message_queue.cpp.o.d"
+  "/root/repo/src/multi_call.cpp" "tests/CMakeFiles/test.dir/__/src/multi_call.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/multi_call.cpp.o.d"
+  "/root/repo/src/priority_selector.cpp" "tests/CMakeFiles/test.dir/__/src/priority_selector.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/priority_selector.cpp.o.d"
+  "/root/repo/src/recv_buffer_pool.cpp" "tests/CMakeFiles/test.dir/__/src/recv_buffer_pool.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/recv_buffer_pool.cpp.o.d"
+  "/root/repo/src/resp_dispatcher.cpp" "tests/CMakeFiles/test.dir/__/src/resp_dispatcher.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/resp_dispatcher.cpp.o.d"
+  "/root/repo/src/responder.cpp" "tests/CMakeFiles/test.dir/__/src/responder.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/responder.cpp.o.d"
+  "/root/repo/src/response.cpp" "tests/CMakeFiles/test.dir/__/src/response.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/response.cpp.o.d"
+  "/root/repo/src/run_time_recorder.cpp" "tests/CMakeFiles/test.dir/__/src/run_time_recorder.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/run_time_recorder.cpp.o.d"
+  "/root/repo/src/semaphore.cpp" "tests/CMakeFiles/test.dir/__/src/semaphore.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/semaphore.cpp.o.d"
+  "/root/repo/src/sender.cpp" "tests/CMakeFiles/test.dir/__/src/sender.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/sender.cpp.o.d"
+  "/root/repo/src/shared_memory.cpp" "tests/CMakeFiles/test.dir/__/src/shared_memory.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/shared_memory.cpp.o.d"
+  "/root/repo/src/stream.cpp" "tests/CMakeFiles/test.dir/__/src/stream.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/stream.cpp.o.d"
+  "/root/repo/src/stream_credit.cpp" "tests/CMakeFiles/test.dir/__/src/stream_credit.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/stream_credit.cpp.o.d"
+  "/root/repo/src/string_helper.cpp" "tests/CMakeFiles/test.dir/__/src/string_helper.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/string_helper.cpp.o.d"
+  "/root/repo/src/thread_util.cpp" "tests/CMakeFiles/test.dir/__/src/thread_util.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/thread_util.cpp.o.d"
+  "/root/repo/src/time_util.cpp" "tests/CMakeFiles/test.dir/__/src/time_util.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/time_util.cpp.o.d"
+  "/root/repo/src/topic_hub.cpp" "tests/CMakeFiles/test.dir/__/src/topic_hub.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/topic_hub.cpp.o.d"
+  "/root/repo/src/uuid.cpp" "tests/CMakeFiles/test.dir/__/src/uuid.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/uuid.cpp.o.d"
+  "/root/repo/src/veigar.cpp" "tests/CMakeFiles/test.dir/__/src/veigar.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/veigar.cpp.o.d"
+  "/root/repo/src/work_stealing_pool.cpp" "tests/CMakeFiles/test.dir/__/src/work_stealing_pool.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/work_stealing_pool.cpp.o.d"
+  "/root/repo/src/worker_group.cpp" "tests/CMakeFiles/test.dir/__/src/worker_group.cpp.o" "gcc" "tests/CMakeFiles/test.dir/__/src/worker_group.cpp.o.d"
+  "/root/repo/tests/event.cpp" "tests/CMakeFiles/test.dir/event.cpp.o" "gcc" "tests/CMakeFiles/test.dir/event.cpp.o.d"
+  "/root/repo/tests/main.cpp" "tests/CMakeFiles/test.dir/main.cpp.o" "gcc" "tests/CMakeFiles/test.dir/main.cpp.o.d"
+  "/root/repo/tests/t_bind.cpp" "tests/CMakeFiles/test.dir/t_bind.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_bind.cpp.o.d"
+  "/root/repo/tests/t_coroutine_call.cpp" "tests/CMakeFiles/test.dir/t_coroutine_call.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_coroutine_call.cpp.o.d"
+  "/root/repo/tests/t_init_uninit.cpp" "tests/CMakeFiles/test.dir/t_init_uninit.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_init_uninit.cpp.o.d"
+  "/root/repo/tests/t_inprocess_call.cpp" "tests/CMakeFiles/test.dir/t_inprocess_call.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_inprocess_call.cpp.o.d"
+  "/root/repo/tests/t_message_queue.cpp" "tests/CMakeFiles/test.dir/t_message_queue.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_message_queue.cpp.o.d"
+  "/root/repo/tests/t_outprocess_call.cpp" "tests/CMakeFiles/test.dir/t_outprocess_call.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_outprocess_call.cpp.o.d"
+  "/root/repo/tests/t_semaphore.cpp" "tests/CMakeFiles/test.dir/t_semaphore.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_semaphore.cpp.o.d"
+  "/root/repo/tests/t_shm.cpp" "tests/CMakeFiles/test.dir/t_shm.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_shm.cpp.o.d"
+  "/root/repo/tests/t_topic.cpp" "tests/CMakeFiles/test.dir/t_topic.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_topic.cpp.o.d"
+  "/root/repo/tests/t_type.cpp" "tests/CMakeFiles/test.dir/t_type.cpp.o" "gcc" "tests/CMakeFiles/test.dir/t_type.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_gate_debug/src/CMakeFiles/veigar.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,91 @@
+file(REMOVE_RECURSE
+  "../bin/test-d"
+  "../bin/test-d.pdb"
+  "CMakeFiles/test.dir/__/src/broadcast_ring.cpp.o"
+  "CMakeFiles/test.dir/__/src/broadcast_ring.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/call_context.cpp.o"
+  "CMakeFiles/test.dir/__/src/call_context.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/call_dispatcher.cpp.o"
+  "CMakeFiles/test.dir/__/src/call_dispatcher.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/call_future.cpp.o"
+  "CMakeFiles/test.dir/__/src/call_future.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/call_scheduler.cpp.o"
+  "CMakeFiles/test.dir/__/src/call_scheduler.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/event.cpp.o"
+  "CMakeFiles/test.dir/__/src/event.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/flow_control.cpp.o"
+  "CMakeFiles/test.dir/__/src/flow_control.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/log.cpp.o"
+  "CMakeFiles/test.dir/__/src/log.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/message_queue.cpp.o"
+  "CMakeFiles/test.dir/__/src/message_queue.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/multi_call.cpp.o"
+  "CMakeFiles/test.dir/__/src/multi_call.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/priority_selector.cpp.o"
+  "CMakeFiles/test.dir/__/src/priority_selector.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/recv_buffer_pool.cpp.o"
+  "CMakeFiles/test.dir/__/src/recv_buffer_pool.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/resp_dispatcher.cpp.o"
+  "CMakeFiles/test.dir/__/src/resp_dispatcher.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/responder.cpp.o"
+  "CMakeFiles/test.dir/__/src/responder.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/response.cpp.o"
+  "CMakeFiles/test.dir/__/src/response.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/run_time_recorder.cpp.o"
+  "CMakeFiles/test.dir/__/src/run_time_recorder.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/semaphore.cpp.o"
+  "CMakeFiles/test.dir/__/src/semaphore.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/sender.cpp.o"
+  "CMakeFiles/test.dir/__/src/sender.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/shared_memory.cpp.o"
+  "CMakeFiles/test.dir/__/src/shared_memory.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/stream.cpp.o"
+  "CMakeFiles/test.dir/__/src/stream.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/stream_credit.cpp.o"
+  "CMakeFiles/test.dir/__/src/stream_credit.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/string_helper.cpp.o"
+  "CMakeFiles/test.dir/__/src/string_helper.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/thread_util.cpp.o"
+  "CMakeFiles/test.dir/__/src/thread_util.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/time_util.cpp.o"
+  "CMakeFiles/test.dir/__/src/time_util.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/topic_hub.cpp.o"
+  "CMakeFiles/test.dir/__/src/topic_hub.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/uuid.cpp.o"
+  "CMakeFiles/test.dir/__/src/uuid.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/veigar.cpp.o"
+  "CMakeFiles/test.dir/__/src/veigar.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/work_stealing_pool.cpp.o"
+  "CMakeFiles/test.dir/__/src/work_stealing_pool.cpp.o.d"
+  "CMakeFiles/test.dir/__/src/worker_group.cpp.o"
+  "CMakeFiles/test.dir/__/src/worker_group.cpp.o.d"
+  "CMakeFiles/test.dir/event.cpp.o"
+  "CMakeFiles/test.dir/event.cpp.o.d"
+  "CMakeFiles/test.dir/main.cpp.o"
+  "CMakeFiles/test.dir/main.cpp.o.d"
+  "CMakeFiles/test.dir/t_bind.cpp.o"
+  "CMakeFiles/test.dir/t_bind.cpp.o.d"
+  "CMakeFiles/test.dir/t_coroutine_call.cpp.o"
+  "CMakeFiles/test.dir/t_coroutine_call.cpp.o.d"
+  "CMakeFiles/test.dir/t_init_uninit.cpp.o"
+  "CMakeFiles/test.dir/t_init_uninit.cpp.o.d"
+  "CMakeFiles/test.dir/t_inprocess_call.cpp.o"
+  "CMakeFiles/test.dir/t_inprocess_call.cpp.o.d"
+  "CMakeFiles/test.dir/t_message_queue.cpp.o"
+  "CMakeFiles/test.dir/t_message_queue.cpp.o.d"
+  "CMakeFiles/test.dir/t_outprocess_call.cpp.o"
+  "CMakeFiles/test.dir/t_outprocess_call.cpp.o.d"
+  "CMakeFiles/test.dir/t_semaphore.cpp.o"
+  "CMakeFiles/test.dir/t_semaphore.cpp.o.d"
+  "CMakeFiles/test.dir/t_shm.cpp.o"
+  "CMakeFiles/test.dir/t_shm.cpp.o.d"
+  "CMakeFiles/test.dir/t_topic.cpp.o"
+  "CMakeFiles/test.dir/t_topic.cpp.o.d"
+  "CMakeFiles/test.dir/t_type.cpp.o"
+  "CMakeFiles/test.dir/t_type.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../../bin/other-d"
+  "../../bin/other-d.pdb"
+  "CMakeFiles/other.dir/main.cpp.o"
+  "CMakeFiles/other.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/other.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_CALL_AWAITABLE_H_
+#define VEIGAR_CALL_AWAITABLE_H_
+#pragma once
+
+#include "veigar/config.h"
+
+#if VEIGAR_HAS_COROUTINE
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include "veigar/call_result.h"
+#include "veigar/executor.h"
+
+namespace veigar {
+// Returned by Veigar::call, co_await it to get the CallResult.
+//
+// The call has already been sent when the awaitable is created.
+// The awaiting coroutine is resumed by the executor once the response arrives or the deadline passes,
+// or immediately if the call has already completed.
+class CallAwaitable {
+   public:
+    struct State {
+        CallResult result;
+        Executor executor;
+        std::coroutine_handle<> handle;
+
+        // Set by whichever of the completion and the suspension comes first, the other one resumes the coroutine.
+        std::atomic_bool arrived = {false};
+
+        void complete(const CallResult& ret) {
+            result.errCode = ret.errCode;
+            result.errorMessage = ret.errorMessage;
+            result.obj = veigar_msgpack::clone(ret.obj.get());
+
+            if (arrived.exchange(true)) {
+                if (executor) {
+                    std::coroutine_handle<> h = handle;
+                    executor([h]() { h.resume(); });
+                }
+                else {
+                    handle.resume();
+                }
+            }
+        }
+    };
+
+    explicit CallAwaitable(std::shared_ptr<State> state) noexcept :
+        state_(std::move(state)) {
+    }
+
+    bool await_ready() const noexcept {
+        return state_->arrived.load();
+    }
+
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        state_->handle = h;
+        return !state_->arrived.exchange(true);
+    }
+
+    CallResult await_resume() noexcept {
+        return std::move(state_->result);
+    }
+
+   private:
+    std::shared_ptr<State> state_;
+};
+}  // namespace veigar
+#endif  // VEIGAR_HAS_COROUTINE
+#endif  // !VEIGAR_CALL_AWAITABLE_H_
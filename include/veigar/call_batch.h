@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_CALL_BATCH_H_
+#define VEIGAR_CALL_BATCH_H_
+#pragma once
+
+#include <string>
+#include <tuple>
+#include "veigar/config.h"
+#include "veigar/msgpack.hpp"
+
+namespace veigar {
+// A list of calls that is sent to a channel in one message, see Veigar::callBatch.
+class VEIGAR_API CallBatch {
+   public:
+    CallBatch() noexcept = default;
+
+    // Runs the calls on several dispatcher threads of the target instead of one after another.
+    // The results keep the order of the calls either way.
+    void setParallel(bool parallel) {
+        parallel_ = parallel;
+    }
+
+    bool isParallel() const {
+        return parallel_;
+    }
+
+    template <typename... Args>
+    CallBatch& add(const std::string& funcName, Args... args) {
+        veigar_msgpack::pack(entries_, std::make_tuple(funcName, std::make_tuple(args...)));
+        size_++;
+        return *this;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    void clear() {
+        entries_.clear();
+        size_ = 0;
+    }
+
+   private:
+    bool parallel_ = false;
+    size_t size_ = 0;
+
+    // The packed funcName - args entries, one after another.
+    veigar_msgpack::sbuffer entries_;
+
+    friend class Veigar;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_CALL_BATCH_H_
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_CALL_CONTEXT_H_
+#define VEIGAR_CALL_CONTEXT_H_
+#pragma once
+
+#include <string>
+#include <memory>
+#include "veigar/config.h"
+
+namespace veigar {
+namespace detail {
+class CallDispatcher;
+}
+
+// The call being run by a bound function, see CallContext::Current.
+//
+// A function can check the time remaining before the caller gives up,
+// and skip or cut short the work that nobody will wait for.
+class VEIGAR_API CallContext {
+   public:
+    // An invalid context, see isValid.
+    CallContext() noexcept = default;
+
+    // The context of the call being run on the current thread.
+    // Only valid inside a function bound by Veigar::bind, bindDeferred or bindStream.
+    // The context is a copy, it can be kept, e.g. by a deferred function until it responds.
+    static CallContext Current();
+
+    bool isValid() const;
+
+    std::string callId() const;
+
+    // Empty for notifications.
+    std::string callerChannelName() const;
+
+    // Monotonic time in microseconds (same clock as ResultMeta::deadline) after which the caller no longer waits for the result.
+    // 0 means no deadline.
+    int64_t deadline() const;
+
+    // The milliseconds remaining before the deadline, 0 once it has passed, -1 if there is no deadline.
+    int64_t remainingMS() const;
+
+    bool isExpired() const;
+
+    // True once the caller has cancelled the call by Veigar::cancel, the result will be discarded.
+    bool isCancelled() const;
+
+   private:
+    CallContext(const std::string& callId,
+                const std::string& callerChannelName,
+                int64_t deadline,
+                std::weak_ptr<detail::CallDispatcher> dispatcher);
+
+   private:
+    bool valid_ = false;
+    std::string callId_;
+    std::string callerChannelName_;
+    int64_t deadline_ = 0;
+    std::weak_ptr<detail::CallDispatcher> dispatcher_;
+
+    friend class detail::CallDispatcher;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_CALL_CONTEXT_H_
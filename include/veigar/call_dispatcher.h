@@ -10,11 +10,19 @@
 #define DISPATCHER_H_CXIVZD5L
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <string>
 #include "veigar/config.h"
 #include "veigar/msgpack.hpp"
+#include "veigar/call_result.h"
+#include "veigar/call_context.h"
+#include "veigar/responder.h"
+#include "veigar/stream.h"
 #include "veigar/detail/call.h"
 #include "veigar/detail/func_tools.h"
 #include "veigar/detail/func_traits.h"
@@ -24,12 +32,14 @@
 namespace veigar {
 class Veigar;
 class MessageQueue;
+class RecvBufferPool;
+struct Statistics;
 
 namespace detail {
 
 // This class maintains a registry of functors associated with their names,
 // and callable using a msgpack-rpc call pack.
-class VEIGAR_API CallDispatcher {
+class VEIGAR_API CallDispatcher : public std::enable_shared_from_this<CallDispatcher> {
    public:
     // This functor type unifies the interfaces of functions that are called remotely
     using AdaptorType =
@@ -38,22 +48,58 @@ class VEIGAR_API CallDispatcher {
     CallDispatcher(Veigar* veigar) noexcept;
     ~CallDispatcher() noexcept;
 
-    bool init();
+    // The messages are received into buffers of 'bufferPool', shared with the response dispatcher.
+    bool init(std::shared_ptr<RecvBufferPool> bufferPool);
     bool isInit() const;
     void uninit();
 
-    std::shared_ptr<MessageQueue> messageQueue();
+    // The shards of the call queue, see Veigar::setCallQueueShards.
+    std::vector<std::shared_ptr<MessageQueue>> messageQueues();
+
+    // See Veigar::pollHandles and Veigar::processReady.
+    std::vector<PollHandle> pollHandles() const;
+    uint32_t processReady(uint32_t maxMessages);
+
+    // The name of the call queue shard of the channel, the first shard has the name of an unsharded queue.
+    static std::string CallQueueName(std::string const& channelName, uint32_t shard);
+
+    // Fills the call dispatcher part of the statistics.
+    void collectStatistics(Statistics& stats) const;
 
     // This is the type of messages as per the msgpack-rpc spec.
-    // flag(0) - callId - callerChannelName - funcName - args
-    using CallMsg = std::tuple<int8_t, std::string, std::string, std::string, veigar_msgpack::object>;
+    // flag(0 = call, 2 = notification, 3 = stream call, 4 = stream credit, 5 = batch, 6 = cancel) - callId - callerChannelName - funcName - args - deadline
+    // A notification has no response.
+    // The deadline is the monotonic time in microseconds after which the caller no longer waits for the result, 0 means none.
+    // It is optional and only sent with Veigar::setDeadlinePropagation, since the versions before it only accept 5 elements.
+    // A call that has expired by the time it is dispatched is answered with ErrorCode::TIMEOUT without being run.
+    // The funcName of a batch is empty, its args is parallel - [[funcName, args], ...] and its result is [[error, result], ...],
+    // the error of an entry is the same as that of a call, a message or [error code, message].
+    // The args of a stream credit is the number of items granted to the function, or -1 to cancel the stream.
+    // A cancel has no args, the call is skipped if it has not been dispatched yet, see CallContext::isCancelled.
+    using CallMsg = std::tuple<int8_t, std::string, std::string, std::string, veigar_msgpack::object, int64_t>;
 
     // Binds a functor to a name so it becomes callable via RPC.
     // name: The name of the functor.
     // func: The functor to bind.
+    // priority: The minimum priority used to dispatch calls of the functor.
     // F: The type of the functor.
     template <typename F>
-    bool bind(std::string const& name, F func);
+    bool bind(std::string const& name, F func, CallPriority priority = CallPriority::NORMAL);
+
+    // Binds a functor that responds later through the Responder passed as its first argument,
+    // so that the dispatcher thread is released as soon as the functor returns.
+    // F: void(Responder, Args...)
+    template <typename F>
+    bool bindDeferred(std::string const& name, F func, CallPriority priority = CallPriority::NORMAL);
+
+    // Binds a functor that sends its result as a stream of items through the StreamWriter passed as its first argument.
+    // The functor can only be called by Veigar::streamCall.
+    // F: void(StreamWriter, Args...)
+    template <typename F>
+    bool bindStream(std::string const& name, F func, CallPriority priority = CallPriority::NORMAL);
+
+    // Sends the response to the caller, an empty response is not sent.
+    bool sendResponse(std::string const& callerChannelName, detail::Response const& resp);
 
     // Stores a void, zero-arg functor with a name.
     template <typename F>
@@ -71,6 +117,21 @@ class VEIGAR_API CallDispatcher {
     template <typename F>
     bool bind(std::string const& name, F func, detail::tags::nonvoid_result const&, detail::tags::nonzero_arg const&);
 
+    // Admission control, the calls over the limits are rejected with ErrorCode::OVERLOADED before they are run.
+    // 0 means unlimited, the limits can be changed at any time.
+    //
+    // The maximum number of calls drained from the call queue and waiting for a dispatcher thread.
+    void setPendingCallLimit(uint32_t maxPending);
+
+    // The maximum number of calls of the function pending or running at the same time.
+    void setFunctionCallLimit(std::string const& name, uint32_t maxInFlight);
+
+    // The maximum number of calls from the caller channel pending or running at the same time.
+    void setCallerCallLimit(std::string const& callerChannelName, uint32_t maxInFlight);
+
+    // The share of the caller with FairnessPolicy::CALLER, 0 resets it to the default (1).
+    void setCallerWeight(std::string const& callerChannelName, uint32_t weight);
+
     // Unbind a functor with a given name from callable functors.
     void unbind(std::string const& name);
 
@@ -89,19 +150,87 @@ class VEIGAR_API CallDispatcher {
 
     bool isFuncNameExist(std::string const& func);
 
+    // The priority to dispatch the call with, which is the higher one of the lane priority and the bound priority.
+    uint32_t callPriority(veigar_msgpack::object const& msg, uint32_t lanePriority) const;
+
     // Dispatches a call (which will have a response).
     detail::Response dispatchCall(veigar_msgpack::object const& msg, std::string& callerChannelName);
 
-    void dispatchThreadProc();
+    // Dispatches the calls of a batch, the response holds the error and result of each call.
+    detail::Response dispatchBatch(std::string const& callId,
+                                   std::string const& callerChannelName,
+                                   int64_t deadline,
+                                   veigar_msgpack::object const& args);
+    detail::Response dispatchBatchEntry(std::string const& callId,
+                                        std::string const& callerChannelName,
+                                        int64_t deadline,
+                                        veigar_msgpack::object const& entry);
+
+    // Runs the functor of a notification, errors are only logged.
+    void dispatchNotification(std::string const& callId, std::string const& funcName, veigar_msgpack::object const& args);
+
+    // Drains the call queue and hands the decoded calls over to the dispatcher threads.
+    void drainThreadProc(uint32_t shard);
+
+    // Pops a message of the queue and unpacks it into 'objs', 'backlog' is the number of messages left.
+    // Return false if the queue is empty, 'signaled' tells whether the queue was expected to have messages.
+    bool popCall(MessageQueue& queue, std::vector<veigar_msgpack::object_handle>& objs, uint32_t& lane, int64_t& backlog, bool signaled);
+
+    // Queues the calls unpacked from a message for the dispatcher threads, or for processReady if 'polled'.
+    void acceptCalls(std::vector<veigar_msgpack::object_handle>& objs, uint32_t lane, bool polled);
+
+    // The context of the call being dispatched on the current thread, see CallContext::Current.
+    static CallContext currentCallContext();
+
+    // Creates the responder of the call being dispatched on the current thread.
+    Responder makeResponder();
+
+    // Moves the admission slot of the call being dispatched on the current thread to the returned releaser,
+    // so that a deferred call is counted as in flight until it responds. Null if the call holds no slot.
+    std::function<void()> takeAdmissionSlot();
+
+    // Creates the stream writer of the stream call being dispatched on the current thread.
+    StreamWriter makeStreamWriter();
+
+    // Applies a stream credit message, return false if the message is not a stream credit.
+    // Credits are applied on the drain threads, since the dispatcher threads may all be waiting for them.
+    bool handleStreamCredit(veigar_msgpack::object const& msg);
+
+    void removeStream(std::string const& callId);
+
+    // Applies a cancel message, return false if the message is not a cancel.
+    // Handled on the drain threads, so that the cancel is not queued behind the call.
+    bool handleCancel(veigar_msgpack::object const& msg);
+
+    bool isCancelled(std::string const& callId) const;
+
+    // Sends packed data to the response queue of the caller.
+    bool sendData(std::string const& callerChannelName, veigar_msgpack::sbuffer const& data);
+
+    // Responds to a call that is not run, e.g. shed, with 'ec'. A notification is only logged.
+    void rejectCall(veigar_msgpack::object const& msg, ErrorCode ec, std::string const& reason);
+
+    // Runs on a dispatcher thread, dispatches the most urgent pending call.
+    void processNextCall();
+
+    void processCall(veigar_msgpack::object const& msg);
 
    private:
     Veigar* veigar_ = nullptr;
-    bool init_ = false;
+
+    // Read by the Responder and StreamWriter send paths on any thread.
+    std::atomic_bool init_ = {false};
 
     std::unordered_map<std::string, AdaptorType> funcs_;
+    std::unordered_map<std::string, CallPriority> priorities_;
+    std::unordered_set<std::string> streamFuncs_;
+    std::unordered_set<std::string> deferredFuncs_;
 
     class Impl;
     Impl* impl_ = nullptr;
+
+    friend class veigar::StreamWriter;
+    friend class veigar::CallContext;
 };
 }  // namespace detail
 }  // namespace veigar
@@ -8,15 +8,106 @@
 namespace veigar {
 namespace detail {
 template <typename F>
-bool CallDispatcher::bind(std::string const& name, F func) {
+bool CallDispatcher::bind(std::string const& name, F func, CallPriority priority) {
     if (name.empty() || isFuncNameExist(name)) {
         return false;
     }
 
-    return bind(name,
-                func,
-                typename detail::func_kind_info<F>::result_kind(),
-                typename detail::func_kind_info<F>::args_kind());
+    if (!bind(name,
+              func,
+              typename detail::func_kind_info<F>::result_kind(),
+              typename detail::func_kind_info<F>::args_kind())) {
+        return false;
+    }
+
+    priorities_[name] = priority;
+    return true;
+}
+
+template <typename F>
+bool CallDispatcher::bindDeferred(std::string const& name, F func, CallPriority priority) {
+    using args_type = typename func_traits<F>::args_type;
+    using call_args_type = typename tuple_tail<args_type>::type;
+    static_assert(std::is_same<typename std::tuple_element<0, args_type>::type, Responder>::value,
+                  "The first parameter of a deferred function must be veigar::Responder.");
+    static_assert(std::is_void<typename func_traits<F>::result_type>::value,
+                  "A deferred function must return void, the result is sent by the Responder.");
+
+    if (name.empty() || isFuncNameExist(name)) {
+        return false;
+    }
+
+    funcs_.insert(
+        std::make_pair(name,
+                       [this, func, name](veigar_msgpack::object const& args) {
+                           constexpr int args_count = std::tuple_size<call_args_type>::value;
+                           assert(args_count == args.via.array.size);
+
+                           call_args_type args_real;
+                           // note: dispatcher will catch this type_error exception.
+                           args.convert(args_real);
+
+                           Responder responder = makeResponder();
+                           auto args_all = std::tuple_cat(std::make_tuple(responder), std::move(args_real));
+                           try {
+                               detail::call(func, args_all);
+                           } catch (...) {
+                               // Let the dispatcher respond with the exception, unless the functor has responded.
+                               if (responder.claim()) {
+                                   throw;
+                               }
+                           }
+
+                           // No result means the response is deferred.
+                           return std::unique_ptr<veigar_msgpack::object_handle>();
+                       }));
+
+    priorities_[name] = priority;
+    deferredFuncs_.insert(name);
+    return true;
+}
+
+template <typename F>
+bool CallDispatcher::bindStream(std::string const& name, F func, CallPriority priority) {
+    using args_type = typename func_traits<F>::args_type;
+    using call_args_type = typename tuple_tail<args_type>::type;
+    static_assert(std::is_same<typename std::tuple_element<0, args_type>::type, StreamWriter>::value,
+                  "The first parameter of a stream function must be veigar::StreamWriter.");
+    static_assert(std::is_void<typename func_traits<F>::result_type>::value,
+                  "A stream function must return void, the items are sent by the StreamWriter.");
+
+    if (name.empty() || isFuncNameExist(name)) {
+        return false;
+    }
+
+    funcs_.insert(
+        std::make_pair(name,
+                       [this, func, name](veigar_msgpack::object const& args) {
+                           constexpr int args_count = std::tuple_size<call_args_type>::value;
+                           assert(args_count == args.via.array.size);
+
+                           call_args_type args_real;
+                           // note: dispatcher will catch this type_error exception.
+                           args.convert(args_real);
+
+                           StreamWriter writer = makeStreamWriter();
+                           auto args_all = std::tuple_cat(std::make_tuple(writer), std::move(args_real));
+                           try {
+                               detail::call(func, args_all);
+                           } catch (...) {
+                               // Let the dispatcher end the stream with the exception, unless the functor has closed it.
+                               if (writer.claim()) {
+                                   throw;
+                               }
+                           }
+
+                           // The stream is ended by the writer.
+                           return std::unique_ptr<veigar_msgpack::object_handle>();
+                       }));
+
+    priorities_[name] = priority;
+    streamFuncs_.insert(name);
+    return true;
 }
 
 template <typename F>
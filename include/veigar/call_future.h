@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_CALL_FUTURE_H_
+#define VEIGAR_CALL_FUTURE_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "veigar/config.h"
+#include "veigar/call_result.h"
+#include "veigar/executor.h"
+
+namespace veigar {
+// Returned by Veigar::asyncCallFuture, a handle to the result of a call that can be chained and combined.
+//
+// Unlike std::future, no thread has to wait for the result: continuations added by 'then' run
+// on the thread that completes the call (see Veigar::setCallbackPolicy), or are posted to the given executor.
+// Copies share the same result.
+class VEIGAR_API CallFuture {
+   public:
+    // An invalid future, see isValid.
+    CallFuture() noexcept = default;
+
+    bool isValid() const;
+
+    // The id of the call, which can be cancelled by Veigar::cancel.
+    // Empty if the call could not be sent, and for the futures returned by then, WhenAll and WhenAny.
+    std::string callId() const;
+
+    bool isReady() const;
+
+    // Return false if the result is not ready after 'timeoutMS'.
+    bool wait(uint32_t timeoutMS) const;
+
+    // Only valid once ready, the result is not changed afterwards.
+    const CallResult& result() const;
+
+    // Runs 'func' with the result once it is ready, the returned future is completed with the value returned by 'func'.
+    // If 'func' throws, the returned future is completed with ErrorCode::FAILED.
+    CallFuture then(std::function<CallResult(const CallResult&)> func, Executor executor = Executor()) const;
+
+    // Same as above, but 'func' starts another asynchronous step (e.g. another call),
+    // the returned future is completed with the result of that step.
+    CallFuture then(std::function<CallFuture(const CallResult&)> func, Executor executor = Executor()) const;
+
+    // Completed once all futures are ready.
+    // The result is ErrorCode::SUCCESS if all of them succeeded, otherwise it is a copy of the first failed one (in the order given).
+    // The results themselves are read from the futures.
+    static CallFuture WhenAll(const std::vector<CallFuture>& futures);
+
+    // Completed with a copy of the result of whichever future is ready first.
+    static CallFuture WhenAny(const std::vector<CallFuture>& futures);
+
+   private:
+    class State;
+
+    explicit CallFuture(std::shared_ptr<State> state) noexcept;
+
+    static CallFuture Create();
+
+    // The callback that completes this future, to be used as the ResultCallback of the call.
+    ResultCallback completer() const;
+
+    void setCallId(const std::string& callId);
+
+   private:
+    std::shared_ptr<State> state_;
+
+    friend class Veigar;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_CALL_FUTURE_H_
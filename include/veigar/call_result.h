@@ -11,6 +11,7 @@
 #pragma once
 
 #include <future>
+#include "veigar/config.h"
 #include "veigar/msgpack.hpp"
 
 namespace veigar {
@@ -22,6 +23,115 @@ enum class ErrorCode {
     SUCCESS = 0,
     TIMEOUT = 1,
     FAILED = 2,
+
+    // The call was not sent since the outgoing queue of the caller is full, see SendQueuePolicy.
+    BUSY = 3,
+
+    // The call was rejected by the target without running it, since the target is overloaded.
+    // It is safe to retry the call, e.g. on another channel.
+    OVERLOADED = 4,
+
+    // The call was cancelled by Veigar::cancel.
+    CANCELLED = 5,
+};
+
+// What an event loop waits on to know that an incoming queue has messages, see Veigar::pollHandles.
+#ifdef _WIN32
+using PollHandle = void*;  // a semaphore HANDLE, for WaitForMultipleObjects
+#else
+using PollHandle = int;  // a file descriptor that becomes readable, for poll, epoll or select
+#endif
+
+// What a writer does when a call or response queue (in shared memory) is full, chosen by the owner of the queue.
+// See Veigar::setCallQueueFullPolicy and Veigar::setResponseQueueFullPolicy.
+enum class QueueFullPolicy {
+    // Wait for space until the timeout of the message, then fail with ErrorCode::TIMEOUT.
+    BLOCK = 0,
+
+    // Fail at once with ErrorCode::OVERLOADED, the messages already queued are kept.
+    REJECT = 1,
+
+    // Discard the oldest messages of the lane to make room, so that the writers never wait.
+    // The calls discarded are completed with ErrorCode::TIMEOUT by their deadline.
+    DROP_OLDEST = 2,
+};
+
+// Each priority has its own lane in the call queue of the target channel.
+enum class CallPriority {
+    LOW = 0,
+    NORMAL = 1,
+    HIGH = 2,
+};
+
+static constexpr uint32_t kCallPriorityNumber = 3;
+
+// How the lanes of different priorities are drained.
+enum class PriorityPolicy {
+    // Always drain the highest priority lane that has messages.
+    STRICT = 0,
+
+    // Drain lanes in weighted round-robin, the weight of a lane is 2^priority (LOW = 1, NORMAL = 2, HIGH = 4).
+    WEIGHTED = 1,
+};
+
+// The order of the calls of the same priority, applies to the outgoing calls and to the dispatch of the incoming calls.
+enum class SchedulingPolicy {
+    // First in, first out.
+    FIFO = 0,
+
+    // Earliest deadline first, using the deadline carried by each call (see ResultMeta::deadline).
+    // The calls without a deadline (notifications and stream calls) go after those with one.
+    EDF = 1,
+};
+
+// Which call queue shard of the target a call is pushed to, see Veigar::setCallQueueShards.
+enum class ShardPolicy {
+    // By the hash of the channel name of the caller, so that the calls of a caller stay in order.
+    CALLER_HASH = 0,
+
+    // The less deep of two shards picked at random, so that each call only locks two queues.
+    // The calls of a caller may be dispatched out of order.
+    LEAST_DEPTH = 1,
+};
+
+// How the incoming calls of the same priority are shared among their callers.
+enum class FairnessPolicy {
+    // The calls are dispatched in the order of the SchedulingPolicy, whoever sent them.
+    NONE = 0,
+
+    // Deficit round-robin among the callers, each caller takes turns dispatching as many calls as its weight
+    // (see Veigar::setCallerWeight). A caller flooding the channel only delays its own calls.
+    // Within the calls of a caller, the SchedulingPolicy still applies.
+    CALLER = 1,
+};
+
+// What to do with a call (or response) when the outgoing queue of the instance is full.
+enum class SendQueuePolicy {
+    // Wait for space until the timeout of the call, then fail with ErrorCode::TIMEOUT.
+    BLOCK = 0,
+
+    // Fail the new call with ErrorCode::BUSY.
+    FAIL_FAST = 1,
+
+    // Fail the oldest queued calls with ErrorCode::BUSY to make room, starting from the lowest priority lane.
+    // With SchedulingPolicy::EDF, the queued calls that would be sent last are failed instead.
+    DROP_OLDEST = 2,
+};
+
+// The bounds of the outgoing queues, the calls and the responses are bounded separately.
+struct SendQueueLimit {
+    uint32_t maxNumber = VEIGAR_SEND_QUEUE_MAX_NUMBER;  // 0 means unlimited
+    uint64_t maxBytes = VEIGAR_SEND_QUEUE_MAX_BYTES;    // 0 means unlimited
+    SendQueuePolicy policy = SendQueuePolicy::BLOCK;
+};
+
+// The credits of each target channel, a call takes a credit when it is sent and returns it once completed,
+// typically with its response. Notifications take no credit.
+// Once a target is out of credit, a new call to it waits in the calling thread, up to the timeout of the call
+// (a thread-less instance fails it with ErrorCode::BUSY instead, see Veigar::setThreadless).
+struct FlowControlLimit {
+    uint32_t maxNumber = 0;  // the calls in flight to a target, 0 means unlimited
+    uint64_t maxBytes = 0;   // the bytes of the calls in flight to a target, 0 means unlimited
 };
 
 class VEIGAR_API CallResult {
@@ -73,9 +183,20 @@ using AsyncCallResult = std::pair<std::string /* call id*/, std::future<CallResu
 
 typedef std::function<void(const CallResult&)> ResultCallback;
 struct ResultMeta {
-    int8_t metaType = 0;  // 0 = promise, 1 = callback
+    int8_t metaType = 0;  // 0 = promise, 1 = callback, 2 = none (notification), 3 = stream
     std::shared_ptr<std::promise<CallResult>> p;
     ResultCallback cb;
+
+    // Stream only, called for each item as it arrives (not necessarily in order), 'seq' starts from 0.
+    // 'cb' is called when the stream has ended, CallResult::obj is the number of items.
+    std::function<void(uint64_t seq, veigar_msgpack::object_handle& item)> itemCb;
+
+    // The channel the call is sent to, set by Veigar.
+    std::string channel;
+
+    // Monotonic time in microseconds, 0 means no deadline.
+    // The call is completed with ErrorCode::TIMEOUT if the response has not arrived by then.
+    int64_t deadline = 0;
 };
 }  // namespace veigar
 
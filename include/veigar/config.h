@@ -43,24 +43,169 @@ static constexpr unsigned VERSION_MINOR = 5;
 #define VEIGAR_CALL_QUEUE_NAME_SUFFIX "_call"
 #endif
 
+// See Veigar::setCallQueueShards.
+#ifndef VEIGAR_CALL_QUEUE_MAX_SHARD_NUMBER
+#define VEIGAR_CALL_QUEUE_MAX_SHARD_NUMBER 64
+#endif
+
+// Where the FIFOs of the pollable queues are created (POSIX only), see Veigar::setPollMode.
+#ifndef VEIGAR_POLL_FIFO_DIR
+#define VEIGAR_POLL_FIFO_DIR "/tmp"
+#endif
+
 #ifndef VEIGAR_RESPONSE_QUEUE_NAME_SUFFIX
 #define VEIGAR_RESPONSE_QUEUE_NAME_SUFFIX "_resp"
 #endif
 
+#ifndef VEIGAR_TOPIC_NAME_SUFFIX
+#define VEIGAR_TOPIC_NAME_SUFFIX "_topic"
+#endif
+
+// The dispatcher and sender thread pools are elastic.
+// Each pool starts with its MIN number of threads, grows toward its maximum number while the queue has backlog
+// and all threads are busy, and shrinks back after threads have been idle for VEIGAR_WORKER_IDLE_TIMEOUT.
+// The maximum numbers of the dispatcher and sender pools are the thread numbers of the fixed pools they replace.
+//
+// The call queue is drained by VEIGAR_CALL_DRAIN_* threads which only decode the calls,
+// the bound functions run on the dispatcher threads (a work-stealing pool).
+//
+#ifndef VEIGAR_CALL_DRAIN_MIN_THREAD_NUMBER
+#define VEIGAR_CALL_DRAIN_MIN_THREAD_NUMBER 1
+#endif
+
+#ifndef VEIGAR_CALL_DRAIN_THREAD_NUMBER
+#define VEIGAR_CALL_DRAIN_THREAD_NUMBER 2
+#endif
+
+#ifndef VEIGAR_DISPATCHER_MIN_THREAD_NUMBER
+#define VEIGAR_DISPATCHER_MIN_THREAD_NUMBER 1
+#endif
+
 #ifndef VEIGAR_DISPATCHER_THREAD_NUMBER
 #define VEIGAR_DISPATCHER_THREAD_NUMBER 3
 #endif
 
+#ifndef VEIGAR_SEND_CALL_MIN_THREAD_NUMBER
+#define VEIGAR_SEND_CALL_MIN_THREAD_NUMBER 1
+#endif
+
 #ifndef VEIGAR_SEND_CALL_THREAD_NUMBER
 #define VEIGAR_SEND_CALL_THREAD_NUMBER 3
 #endif
 
+#ifndef VEIGAR_SEND_RESPONSE_MIN_THREAD_NUMBER
+#define VEIGAR_SEND_RESPONSE_MIN_THREAD_NUMBER 1
+#endif
+
 #ifndef VEIGAR_SEND_RESPONSE_THREAD_NUMBER
 #define VEIGAR_SEND_RESPONSE_THREAD_NUMBER 3
 #endif
 
+#ifndef VEIGAR_CALLBACK_MIN_THREAD_NUMBER
+#define VEIGAR_CALLBACK_MIN_THREAD_NUMBER 1
+#endif
+
+#ifndef VEIGAR_CALLBACK_THREAD_NUMBER
+#define VEIGAR_CALLBACK_THREAD_NUMBER 4
+#endif
+
+// The maximum number of result callbacks posted to the pool or executor but not finished yet.
+// Once reached, the response dispatcher waits for the callbacks to catch up before posting more.
+#ifndef VEIGAR_CALLBACK_BACKLOG_LIMIT
+#define VEIGAR_CALLBACK_BACKLOG_LIMIT 4096
+#endif
+
+// How long uninit waits for the result callbacks already posted to the pool.
+// The callbacks still running after it are left to finish on their own.
+#ifndef VEIGAR_CALLBACK_DRAIN_TIMEOUT
+#define VEIGAR_CALLBACK_DRAIN_TIMEOUT 3000 // ms
+#endif
+
+// The default bounds of the outgoing call and response queues, see SendQueueLimit.
+#ifndef VEIGAR_SEND_QUEUE_MAX_NUMBER
+#define VEIGAR_SEND_QUEUE_MAX_NUMBER 100000
+#endif
+
+#ifndef VEIGAR_SEND_QUEUE_MAX_BYTES
+#define VEIGAR_SEND_QUEUE_MAX_BYTES 268435456  // 256MB
+#endif
+
+#ifndef VEIGAR_WORKER_IDLE_TIMEOUT
+#define VEIGAR_WORKER_IDLE_TIMEOUT 10000 // ms
+#endif
+
+// The messages are received into buffers shared by the call and response dispatchers of an instance,
+// pooled by size class (powers of two from VEIGAR_RECV_BUFFER_MIN_SIZE to VEIGAR_RECV_BUFFER_MAX_SIZE).
+// A larger message gets a buffer of its own, freed once the message has been processed.
+// The pool keeps at most VEIGAR_RECV_BUFFER_POOL_MAX_BYTES of idle buffers, and frees those idle for VEIGAR_RECV_BUFFER_IDLE_TRIM.
+#ifndef VEIGAR_RECV_BUFFER_MIN_SIZE
+#define VEIGAR_RECV_BUFFER_MIN_SIZE 1024
+#endif
+
+#ifndef VEIGAR_RECV_BUFFER_MAX_SIZE
+#define VEIGAR_RECV_BUFFER_MAX_SIZE 1048576  // 1MB
+#endif
+
+#ifndef VEIGAR_RECV_BUFFER_POOL_MAX_BYTES
+#define VEIGAR_RECV_BUFFER_POOL_MAX_BYTES 4194304  // 4MB
+#endif
+
+#ifndef VEIGAR_RECV_BUFFER_IDLE_TRIM
+#define VEIGAR_RECV_BUFFER_IDLE_TRIM 5000 // ms
+#endif
+
+// The coroutine call API (Veigar::call) is only available when the user code is built as C++20 with coroutine support.
+// The library itself does not depend on it, so it can still be built as C++11.
+#ifndef VEIGAR_HAS_COROUTINE
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define VEIGAR_HAS_COROUTINE 1
+#endif
+#endif
+#endif
+
+#ifndef VEIGAR_HAS_COROUTINE
+#define VEIGAR_HAS_COROUTINE 0
+#endif
+
 #ifndef VEIGAR_WRITE_RESPONSE_QUEUE_TIMEOUT
 #define VEIGAR_WRITE_RESPONSE_QUEUE_TIMEOUT 1500 // ms
 #endif
 
+#ifndef VEIGAR_WRITE_NOTIFICATION_QUEUE_TIMEOUT
+#define VEIGAR_WRITE_NOTIFICATION_QUEUE_TIMEOUT 1500 // ms
+#endif
+
+// The number of stream items the function can send ahead of the caller,
+// it should fit in the response queue of the caller together with the other responses.
+#ifndef VEIGAR_STREAM_WINDOW
+#define VEIGAR_STREAM_WINDOW 32
+#endif
+
+// How long (in milliseconds) the target remembers a cancelled call that it has not dispatched yet.
+// A call dispatched later than that is run, as the cancellation has been forgotten.
+#ifndef VEIGAR_CANCELLED_CALL_RETENTION
+#define VEIGAR_CANCELLED_CALL_RETENTION 60000
+#endif
+
+// How long StreamWriter::write waits for the caller to consume items before failing.
+#ifndef VEIGAR_STREAM_WRITE_TIMEOUT
+#define VEIGAR_STREAM_WRITE_TIMEOUT 10000 // ms
+#endif
+
+// The default ring size of a topic, the events of a topic are kept until they are overwritten.
+#ifndef VEIGAR_TOPIC_CAPACITY
+#define VEIGAR_TOPIC_CAPACITY 1048576 // bytes
+#endif
+
+#ifndef VEIGAR_TOPIC_MAX_SUBSCRIBER_NUMBER
+#define VEIGAR_TOPIC_MAX_SUBSCRIBER_NUMBER 16
+#endif
+
+// With TopicPolicy::BLOCK, a subscriber that has held back the publisher without reading for this long
+// (e.g. its process crashed) is lapped from then on, until it reads again.
+#ifndef VEIGAR_TOPIC_STALL_TIMEOUT
+#define VEIGAR_TOPIC_STALL_TIMEOUT 5000 // ms
+#endif
+
 #endif  // !VEIGAR_CONFIG_H_
\ No newline at end of file
@@ -84,6 +84,15 @@ struct func_kind_info<R (*)(Args...)> {
     typedef typename tags::result_trait<R>::type result_kind;
 };
 
+// The tuple without its first element type.
+template <typename T>
+struct tuple_tail;
+
+template <typename H, typename... T>
+struct tuple_tail<std::tuple<H, T...>> {
+    using type = std::tuple<T...>;
+};
+
 template <typename F>
 using is_zero_arg = is_zero<func_traits<F>::arg_count>;
 
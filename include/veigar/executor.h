@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_EXECUTOR_H_
+#define VEIGAR_EXECUTOR_H_
+#pragma once
+
+#include <functional>
+
+namespace veigar {
+// Runs the given task, e.g. by posting it to an event loop or a thread pool.
+// An empty executor means the task runs inline on the thread that completes the call.
+typedef std::function<void(std::function<void()>)> Executor;
+
+// Where the result callbacks (and the continuations built on them) are run.
+enum class CallbackPolicy {
+    // On the thread that drains the response queue, a slow callback delays the other responses.
+    INLINE = 0,
+
+    // On a thread pool of the instance.
+    POOL = 1,
+
+    // Posted to the executor given by the user.
+    EXECUTOR = 2,
+};
+}  // namespace veigar
+#endif  // !VEIGAR_EXECUTOR_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_MULTI_CALL_H_
+#define VEIGAR_MULTI_CALL_H_
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "veigar/config.h"
+#include "veigar/call_result.h"
+
+namespace veigar {
+// Called once for each channel of Veigar::callAll as its result arrives, 'index' is the position of the channel.
+typedef std::function<void(size_t index, const std::string& channel, const CallResult& ret)> MultiResultCallback;
+
+// Returned by Veigar::callAll, collects the results of the same call made to many channels.
+// Every call completes (with ErrorCode::TIMEOUT at the latest) once the timeout of callAll has passed.
+class VEIGAR_API MultiCallResult {
+   public:
+    size_t size() const;
+
+    std::vector<std::string> channels() const;
+
+    // The number of calls that have completed.
+    size_t completedCount() const;
+
+    // The indexes of the completed calls, in the order they completed.
+    std::vector<size_t> completionOrder() const;
+
+    // Waits up to 'timeoutMS' for all calls to complete, return false if some are still ongoing.
+    bool waitAll(uint32_t timeoutMS);
+
+    // Waits up to 'timeoutMS' for at least 'k' calls to complete, see completionOrder for which ones.
+    bool waitFirst(size_t k, uint32_t timeoutMS);
+
+    bool isCompleted(size_t index) const;
+
+    // Only valid once the call of 'index' has completed, the result is not changed afterwards.
+    const CallResult& result(size_t index) const;
+
+   private:
+    class State;
+
+    MultiCallResult(const std::vector<std::string>& channels, MultiResultCallback cb) noexcept;
+
+    // Fills the callback the result of the call of 'index' is delivered to.
+    void bindResultMeta(size_t index, ResultMeta& retMeta);
+
+    void complete(size_t index, const CallResult& ret);
+
+   private:
+    std::shared_ptr<State> state_;
+
+    friend class Veigar;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_MULTI_CALL_H_
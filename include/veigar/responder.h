@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_RESPONDER_H_
+#define VEIGAR_RESPONDER_H_
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "veigar/config.h"
+#include "veigar/msgpack.hpp"
+#include "veigar/detail/response.h"
+
+namespace veigar {
+namespace detail {
+class CallDispatcher;
+}
+
+// Completes a call of a function bound by Veigar::bindDeferred.
+//
+// The responder can be copied and used from any thread, only the first response is sent to the caller.
+// If all copies are destroyed without responding, an error response is sent to the caller.
+class VEIGAR_API Responder {
+   public:
+    Responder() noexcept = default;
+
+    // False for a default constructed responder.
+    bool isValid() const;
+
+    std::string callId() const;
+    std::string callerChannelName() const;
+
+    // True once a response has been sent (or is being sent) by any copy.
+    // Always true when the function is called by Veigar::notify.
+    bool isResponded() const;
+
+    // Sends the result to the caller.
+    // Return false if a response has already been sent, or the channel has been uninitialized.
+    template <typename T>
+    bool respond(T&& result);
+
+    // Same as above, for the functions that have no result.
+    bool respond();
+
+    // Sends an error to the caller, CallResult::errorMessage of the caller will be set to 'errorMessage'.
+    bool respondError(const std::string& errorMessage);
+
+   private:
+    class State;
+
+    Responder(std::shared_ptr<State> state) noexcept;
+
+    // 'responded' is true for notifications, which have no response.
+    // 'onDone' is called once, on the first response or when all copies have been destroyed.
+    static Responder Create(const std::string& callId,
+                            const std::string& callerChannelName,
+                            std::weak_ptr<detail::CallDispatcher> dispatcher,
+                            bool responded,
+                            std::function<void()> onDone);
+
+    // Return true if this is the first response, 'onDone' is called then.
+    bool claim();
+
+    bool send(const detail::Response& resp);
+
+   private:
+    std::shared_ptr<State> state_;
+
+    friend class detail::CallDispatcher;
+};
+
+template <typename T>
+bool Responder::respond(T&& result) {
+    if (!claim()) {
+        return false;
+    }
+
+    return send(detail::Response::MakeResponseWithResult(callId(), std::forward<T>(result)));
+}
+}  // namespace veigar
+#endif  // !VEIGAR_RESPONDER_H_
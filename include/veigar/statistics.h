@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_STATISTICS_H_
+#define VEIGAR_STATISTICS_H_
+#pragma once
+
+#include <inttypes.h>
+#include <vector>
+
+namespace veigar {
+// The internal threads that can be placed on CPUs.
+enum class ThreadRole {
+    // The threads that drain the call queue and run the bound functions.
+    CALL_DISPATCHER = 0,
+
+    // The threads that drain the response queue and deliver the results.
+    RESPONSE_DISPATCHER = 1,
+
+    // The threads that push calls and responses to the target queues.
+    SENDER = 2,
+
+    // The threads that run the result callbacks, see CallbackPolicy::POOL.
+    RESULT_CALLBACK = 3,
+};
+
+static constexpr uint32_t kThreadRoleNumber = 4;
+
+struct ThreadStatistics {
+    // The number of threads currently running, and the number of them doing work.
+    uint32_t threadNumber = 0;
+    uint32_t busyThreadNumber = 0;
+
+    // The CPUs the threads are pinned to, empty if they are not pinned.
+    std::vector<uint32_t> cpus;
+
+    // The number of threads that could not be pinned to the CPUs.
+    uint32_t pinFailedThreadNumber = 0;
+};
+
+struct QueueStatistics {
+    // The size of the shared memory in bytes.
+    // A call queue shard has kCallPriorityNumber lanes of the capacity given to Veigar::init, the response queue has one.
+    int64_t memorySize = 0;
+
+    // The NUMA node the shared memory is bound to, -1 if it is not bound.
+    int32_t numaNode = -1;
+
+    // The number of shards, see Veigar::setCallQueueShards, the memory size is their total.
+    uint32_t shardNumber = 1;
+
+    // The messages the writers of all processes found this queue full for, by its QueueFullPolicy, since it was created.
+    int64_t droppedNumber = 0;   // discarded to make room (DROP_OLDEST)
+    int64_t rejectedNumber = 0;  // failed with ErrorCode::OVERLOADED (REJECT)
+    int64_t blockedNumber = 0;   // waited for space (BLOCK)
+};
+
+// The outgoing queue of the calls or the responses, in process memory.
+struct SendQueueStatistics {
+    // The messages waiting to be pushed to the targets.
+    int64_t number = 0;
+    int64_t bytes = 0;
+
+    // The messages failed with ErrorCode::BUSY (or discarded for responses) since init.
+    int64_t rejectedNumber = 0;
+    int64_t droppedNumber = 0;
+};
+
+// The calls holding a credit, see FlowControlLimit.
+struct FlowControlStatistics {
+    int64_t number = 0;
+    int64_t bytes = 0;
+
+    // The calls that had to wait for a credit, and those that timed out waiting, since init.
+    int64_t waitedNumber = 0;
+    int64_t timeoutNumber = 0;
+};
+
+// The receive buffers shared by the call and response dispatchers, see VEIGAR_RECV_BUFFER_MIN_SIZE.
+struct RecvBufferStatistics {
+    // The buffers holding messages being processed, and the idle buffers kept by the pool.
+    int64_t usedBytes = 0;
+    int64_t pooledBytes = 0;
+
+    // The buffers allocated and those taken from the pool, since init.
+    int64_t allocatedNumber = 0;
+    int64_t reusedNumber = 0;
+
+    // The idle buffers freed after VEIGAR_RECV_BUFFER_IDLE_TRIM, since init.
+    int64_t trimmedNumber = 0;
+};
+
+// A snapshot of the runtime state of a Veigar instance.
+struct Statistics {
+    ThreadStatistics threads[kThreadRoleNumber];  // index is ThreadRole
+
+    QueueStatistics callQueue;
+    QueueStatistics responseQueue;
+
+    SendQueueStatistics callSendQueue;
+    SendQueueStatistics responseSendQueue;
+
+    FlowControlStatistics flowControl;
+
+    RecvBufferStatistics recvBuffers;
+
+    // The calls drained from the call queue and waiting for a dispatcher thread.
+    int64_t pendingCallNumber = 0;
+
+    // The calls rejected with ErrorCode::OVERLOADED since init.
+    int64_t shedCallNumber = 0;
+
+    // The calls answered with ErrorCode::TIMEOUT without being run since init, since their deadline had passed.
+    int64_t expiredCallNumber = 0;
+
+    // The calls skipped without being run since init, since their callers had cancelled them.
+    int64_t cancelledCallNumber = 0;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_STATISTICS_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_STREAM_H_
+#define VEIGAR_STREAM_H_
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include "veigar/config.h"
+#include "veigar/msgpack.hpp"
+#include "veigar/call_result.h"
+
+namespace veigar {
+class Veigar;
+class StreamCredit;
+
+namespace detail {
+class CallDispatcher;
+}
+
+// Sends the items of a function bound by Veigar::bindStream.
+//
+// The writer can be copied and used from any thread, the items are delivered to the caller in the order of write.
+// If all copies are destroyed without closing, the stream is ended with an error.
+class VEIGAR_API StreamWriter {
+   public:
+    StreamWriter() noexcept = default;
+
+    // False for a default constructed writer.
+    bool isValid() const;
+
+    std::string callId() const;
+    std::string callerChannelName() const;
+
+    // True once the stream has been closed by any copy.
+    bool isClosed() const;
+
+    // True if the caller has stopped reading, the function should stop writing.
+    bool isCancelled() const;
+
+    // Sends an item to the caller.
+    // Waits while VEIGAR_STREAM_WINDOW items have not been consumed by the caller yet.
+    // Return false if the stream has been closed or cancelled, or the caller has not consumed any item in VEIGAR_STREAM_WRITE_TIMEOUT.
+    template <typename T>
+    bool write(T&& item);
+
+    // Ends the stream.
+    // Return false if the stream has already been closed or cancelled, or the channel has been uninitialized.
+    bool close();
+
+    // Ends the stream with an error, the items written before are still delivered to the caller.
+    bool closeWithError(const std::string& errorMessage);
+
+   private:
+    class State;
+
+    StreamWriter(std::shared_ptr<State> state) noexcept;
+
+    static StreamWriter Create(const std::string& callId,
+                               const std::string& callerChannelName,
+                               std::weak_ptr<detail::CallDispatcher> dispatcher,
+                               std::shared_ptr<StreamCredit> credit);
+
+    // Return true if this is the first close.
+    bool claim();
+
+    bool writeObject(const veigar_msgpack::object& item);
+
+   private:
+    std::shared_ptr<State> state_;
+
+    friend class detail::CallDispatcher;
+};
+
+template <typename T>
+bool StreamWriter::write(T&& item) {
+    try {
+        veigar_msgpack::zone z;
+        veigar_msgpack::object obj(std::forward<T>(item), z);
+        return writeObject(obj);
+    } catch (std::exception&) {
+        return false;
+    }
+}
+
+// Reads the items of a call made by Veigar::streamCall.
+//
+// The reader grants the function more items as they are read, so a reader that stops reading also stops the function.
+// Destroying the reader before the stream has ended cancels the stream, it must be destroyed before the Veigar instance.
+class VEIGAR_API StreamReader {
+   public:
+    ~StreamReader();
+
+    std::string callId() const;
+
+    // Waits up to 'timeoutMS' for the next item.
+    // Return false if the stream has ended (see isEnded) or no item arrived in time.
+    bool next(CallResult& item, uint32_t timeoutMS);
+
+    // True once the stream has ended and all of its items have been read.
+    bool isEnded() const;
+
+    // The status of the stream, only meaningful once it has ended.
+    // ErrorCode::SUCCESS with an error message means the function ended the stream with an error.
+    ErrorCode errorCode() const;
+    std::string errorMessage() const;
+
+    // Stops the stream, the items that have not been read are discarded.
+    void cancel();
+
+   private:
+    class State;
+
+    StreamReader(const std::string& callId,
+                 std::function<void(int64_t)> granter,
+                 std::function<void()> releaser) noexcept;
+
+    // Fills the callbacks the items and the end of the stream are delivered to.
+    void bindResultMeta(ResultMeta& retMeta);
+
+   private:
+    std::shared_ptr<State> state_;
+
+    friend class Veigar;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_STREAM_H_
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_TOPIC_H_
+#define VEIGAR_TOPIC_H_
+#pragma once
+
+#include <inttypes.h>
+#include <functional>
+#include "veigar/msgpack.hpp"
+
+namespace veigar {
+// What the publisher does when the ring of the topic is full and a subscriber has not read the oldest event.
+enum class TopicPolicy {
+    // Overwrite the oldest event, the slow subscriber skips it and is told how many events it missed.
+    LAP = 0,
+
+    // Wait for the slow subscriber, the publish fails if it does not catch up in time.
+    // A subscriber that holds back the publisher for VEIGAR_TOPIC_STALL_TIMEOUT without reading, e.g. a crashed one,
+    // is no longer waited for and is lapped until it reads again.
+    BLOCK = 1,
+};
+
+struct TopicEvent {
+    // The sequence number of the event, starting from 0 for each topic.
+    uint64_t seq = 0;
+
+    // The number of events the subscriber missed right before this one, because it has been lapped.
+    uint64_t missed = 0;
+
+    veigar_msgpack::object_handle obj;
+};
+
+// Called on the subscription thread of the topic.
+typedef std::function<void(const TopicEvent&)> TopicCallback;
+}  // namespace veigar
+#endif  // !VEIGAR_TOPIC_H_
@@ -15,6 +15,15 @@
 #include <inttypes.h>
 #include "veigar/config.h"
 #include "veigar/call_result.h"
+#include "veigar/statistics.h"
+#include "veigar/executor.h"
+#include "veigar/topic.h"
+#include "veigar/stream.h"
+#include "veigar/call_batch.h"
+#include "veigar/multi_call.h"
+#include "veigar/call_future.h"
+#include "veigar/call_awaitable.h"
+#include "veigar/call_context.h"
 #include "veigar/call_dispatcher.h"
 
 namespace veigar {
@@ -39,10 +48,12 @@ class VEIGAR_API Veigar {
      * @tparam F The type of the function to bind
      * @param funcName The name under which the function will be exposed
      * @param func The function to bind
+     * @param priority The minimum priority used to dispatch calls of this function,
+     *                 calls made with a higher priority keep their own priority
      * @return true if binding was successful, false otherwise
      */
     template <typename F>
-    bool bind(const std::string& funcName, F func);
+    bool bind(const std::string& funcName, F func, CallPriority priority = CallPriority::NORMAL);
 
     /**
      * @brief Unbinds a previously bound function
@@ -57,12 +68,15 @@ class VEIGAR_API Veigar {
      *                   The uniqueness must be guaranteed by the user as Veigar does not validate this.
      * 
      * @param msgQueueCapacity The maximum number of messages that can be queued.
-     *                        When this limit is reached, the oldest message will be discarded
-     *                        to accommodate new messages.
+     *                        When this limit is reached, the writers wait, fail, or discard the oldest messages,
+     *                        see setCallQueueFullPolicy and setResponseQueueFullPolicy.
+     *                        The call queue applies it to each of its kCallPriorityNumber priority lanes.
      * 
      * @param expectedMsgMaxSize The expected maximum size of a single message in bytes.
      *                          The total shared memory allocation will be:
-     *                          msgQueueCapacity * expectedMsgMaxSize.
+     *                          msgQueueCapacity * expectedMsgMaxSize for the response queue, and
+     *                          kCallPriorityNumber * msgQueueCapacity * expectedMsgMaxSize for each call queue shard,
+     *                          since every priority lane is sized like the response queue.
      *                          Messages larger than expectedMsgMaxSize can still be sent,
      *                          but if they exceed msgQueueCapacity * expectedMsgMaxSize,
      *                          the operation will fail.
@@ -84,7 +98,7 @@ class VEIGAR_API Veigar {
 
     /**
      * @brief Returns the current message queue capacity
-     * @return The maximum number of messages that can be queued
+     * @return The maximum number of messages that can be queued, per priority lane for the call queue
      */
     uint32_t msgQueueCapacity() const;
 
@@ -106,6 +120,38 @@ class VEIGAR_API Veigar {
      */
     std::vector<std::string> bindNames() const;
 
+    /**
+     * @brief Binds a function that responds later, from any thread
+     *
+     * The function receives a Responder as its first argument and returns void.
+     * The dispatcher thread is released as soon as the function returns,
+     * the response is sent when Responder::respond (or respondError) is called.
+     *
+     * @tparam F The type of the function to bind, void(Responder, Args...)
+     * @param funcName The name under which the function will be exposed
+     * @param func The function to bind
+     * @param priority See bind
+     * @return true if binding was successful, false otherwise
+     */
+    template <typename F>
+    bool bindDeferred(const std::string& funcName, F func, CallPriority priority = CallPriority::NORMAL);
+
+    /**
+     * @brief Binds a function that sends its result as a stream of items
+     *
+     * The function receives a StreamWriter as its first argument and returns void.
+     * Each item is sent to the caller as soon as it is written, the stream ends when StreamWriter::close is called.
+     * The function can only be called by streamCall.
+     *
+     * @tparam F The type of the function to bind, void(StreamWriter, Args...)
+     * @param funcName The name under which the function will be exposed
+     * @param func The function to bind
+     * @param priority See bind
+     * @return true if binding was successful, false otherwise
+     */
+    template <typename F>
+    bool bindStream(const std::string& funcName, F func, CallPriority priority = CallPriority::NORMAL);
+
     /**
      * @brief Asynchronously calls a function on a remote process
      * 
@@ -123,6 +169,17 @@ class VEIGAR_API Veigar {
         const std::string& funcName,
         Args... args);
 
+    /**
+     * @brief Same as above, but the call is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    std::shared_ptr<AsyncCallResult> asyncCall(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
     /**
      * @brief Asynchronously calls a function on a remote process with a callback
      * 
@@ -141,6 +198,108 @@ class VEIGAR_API Veigar {
         const std::string& funcName,
         Args... args);
 
+    /**
+     * @brief Same as above, but the call is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    void asyncCall(
+        CallPriority priority,
+        ResultCallback cb,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Asynchronously calls a function on a remote process, the result is delivered to a CallFuture
+     *
+     * Continuations can be chained by CallFuture::then and futures combined by CallFuture::WhenAll / WhenAny,
+     * without parking a thread on each call. There is no need to call releaseCall.
+     *
+     * @tparam Args Variadic template parameter for function arguments
+     * @param targetChannel The channel name of the target process
+     * @param timeoutMS The deadline of the call, from now
+     * @param funcName The name of the function to call
+     * @param args The arguments to pass to the function
+     * @return The future of the call, it is completed with ErrorCode::TIMEOUT at the latest once the deadline has passed
+     */
+    template <typename... Args>
+    CallFuture asyncCallFuture(
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Same as above, but the call is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    CallFuture asyncCallFuture(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Calls a function on a remote process without waiting for a response
+     *
+     * The function is run by the target, but no response is sent back and no result is tracked.
+     * Errors (e.g. the function does not exist) are only logged by the target.
+     *
+     * @tparam Args Variadic template parameter for function arguments
+     * @param targetChannel The channel name of the target process
+     * @param funcName The name of the function to call
+     * @param args The arguments to pass to the function
+     * @return true if the notification has been queued for sending, false otherwise
+     */
+    template <typename... Args>
+    bool notify(
+        const std::string& targetChannel,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Same as above, but the notification is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    bool notify(
+        CallPriority priority,
+        const std::string& targetChannel,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Calls a function bound by bindStream on a remote process
+     *
+     * The items are read from the returned StreamReader as they arrive.
+     * The function can only send VEIGAR_STREAM_WINDOW items ahead of the reader.
+     *
+     * @tparam Args Variadic template parameter for function arguments
+     * @param targetChannel The channel name of the target process
+     * @param timeoutMS The maximum time to wait for the call to be queued to the target
+     * @param funcName The name of the function to call
+     * @param args The arguments to pass to the function
+     * @return The reader of the stream, or nullptr if the call could not be sent
+     */
+    template <typename... Args>
+    std::shared_ptr<StreamReader> streamCall(
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Same as above, but the call is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    std::shared_ptr<StreamReader> streamCall(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
     /**
      * @brief Releases resources associated with an asynchronous call
      * 
@@ -151,6 +310,53 @@ class VEIGAR_API Veigar {
      */
     void releaseCall(const std::string& callId);
 
+    /**
+     * @brief Cancels an asynchronous call
+     *
+     * The call is completed with ErrorCode::CANCELLED right away, no need to wait for the target.
+     * If the call has not been sent yet, it is removed from the send queue; otherwise the target is told to skip it,
+     * or if it is already running, the function can observe it through CallContext::isCancelled.
+     * There is no need to call releaseCall afterwards.
+     *
+     * @param callId The unique identifier of the call to cancel
+     * @return false if the call is unknown or has already completed
+     */
+    bool cancel(const std::string& callId);
+
+#if VEIGAR_HAS_COROUTINE
+    /**
+     * @brief Calls a function on a remote process from a coroutine (C++20 only)
+     *
+     * Usage: CallResult ret = co_await vg.call(...);
+     * No thread is blocked while waiting, the coroutine is resumed where the result callbacks run (see setCallbackPolicy).
+     * If the response has not arrived within timeoutMS, the coroutine is resumed with ErrorCode::TIMEOUT.
+     *
+     * @tparam Args Variadic template parameter for function arguments
+     * @param targetChannel The channel name of the target process
+     * @param timeoutMS The deadline of the call, from now
+     * @param funcName The name of the function to call
+     * @param args The arguments to pass to the function
+     * @return An awaitable that produces the CallResult
+     */
+    template <typename... Args>
+    CallAwaitable call(
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Same as above, but the coroutine is resumed by the given executor
+     */
+    template <typename... Args>
+    CallAwaitable call(
+        Executor executor,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+#endif
+
     /**
      * @brief Synchronously calls a function on a remote process
      * 
@@ -168,6 +374,129 @@ class VEIGAR_API Veigar {
         const std::string& funcName,
         Args... args);
 
+    /**
+     * @brief Same as above, but the call is sent through the lane of the given priority
+     */
+    template <typename... Args>
+    CallResult syncCall(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Creates a topic that this instance publishes to
+     *
+     * Each topic is a ring in shared memory with a single publisher and up to
+     * VEIGAR_TOPIC_MAX_SUBSCRIBER_NUMBER subscribers, each subscriber reads the events at its own pace.
+     * The topic name must be unique within the current computer scope.
+     *
+     * @param topic The name of the topic
+     * @param policy What to do with a subscriber that has not read the oldest event when the ring is full
+     * @param capacity The size of the ring in bytes
+     * @return true if the topic was created, false otherwise
+     */
+    bool createTopic(const std::string& topic, TopicPolicy policy = TopicPolicy::LAP, uint32_t capacity = VEIGAR_TOPIC_CAPACITY);
+
+    /**
+     * @brief Destroys a topic created by createTopic
+     */
+    void destroyTopic(const std::string& topic);
+
+    /**
+     * @brief Publishes an event to all subscribers of the topic
+     *
+     * @tparam T The type of the event, it must be serializable by msgpack
+     * @param topic The name of the topic, which must be created by this instance
+     * @param event The event to publish
+     * @param timeoutMS How long to wait for slow subscribers, only used by TopicPolicy::BLOCK
+     * @return true if the event was written to the ring, false otherwise
+     */
+    template <typename T>
+    bool publish(const std::string& topic, const T& event, uint32_t timeoutMS = 0);
+
+    /**
+     * @brief Subscribes to a topic created by another instance (or this one)
+     *
+     * Only the events published after subscribing are received.
+     * The callback is called in order on a thread dedicated to the subscription,
+     * it must not call unsubscribe for the same topic.
+     *
+     * @param topic The name of the topic
+     * @param cb The callback to receive the events
+     * @return true if subscribed, false if the topic does not exist or has too many subscribers
+     */
+    bool subscribe(const std::string& topic, TopicCallback cb);
+
+    /**
+     * @brief Stops receiving the events of the topic, waits for the running callback to return
+     */
+    void unsubscribe(const std::string& topic);
+
+    /**
+     * @brief Synchronously calls many functions on a remote process with one message
+     *
+     * The calls are run by the target one after another, or in parallel if CallBatch::setParallel is set,
+     * and all results are sent back in one response.
+     * Functions bound by bindDeferred or bindStream can not be called in a batch.
+     *
+     * @param targetChannel The channel name of the target process
+     * @param timeoutMS The maximum time to wait for all results
+     * @param batch The calls
+     * @return The result of each call, in the order of the calls.
+     *         A call the target did not run holds the reason as for a single call,
+     *         e.g. ErrorCode::OVERLOADED when shed by setFunctionCallLimit.
+     *         If the batch itself failed (e.g. timeout), all results hold the same error.
+     */
+    std::vector<CallResult> callBatch(
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const CallBatch& batch);
+
+    /**
+     * @brief Same as above, but the batch is sent through the lane of the given priority
+     */
+    std::vector<CallResult> callBatch(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        const CallBatch& batch);
+
+    /**
+     * @brief Calls the same function on many remote processes
+     *
+     * The arguments are serialized once and the same bytes are sent to every target.
+     * The returned MultiCallResult collects the results, it can be waited for all of them or for the first k.
+     *
+     * @tparam Args Variadic template parameter for function arguments
+     * @param targetChannels The channel names of the target processes
+     * @param timeoutMS The deadline of each call, from now
+     * @param funcName The name of the function to call
+     * @param args The arguments to pass to the function
+     * @return The aggregate result, never nullptr
+     */
+    template <typename... Args>
+    std::shared_ptr<MultiCallResult> callAll(
+        const std::vector<std::string>& targetChannels,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
+    /**
+     * @brief Same as above, but 'cb' is also called with each result as it arrives
+     *
+     * The callback is called where the result callbacks run (see setCallbackPolicy, or the calling thread if the call could not be sent),
+     * before the result is visible to the waiters of MultiCallResult.
+     */
+    template <typename... Args>
+    std::shared_ptr<MultiCallResult> callAll(
+        MultiResultCallback cb,
+        const std::vector<std::string>& targetChannels,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        Args... args);
+
     /**
      * @brief Sets the timeout for acquiring inter-process read-write locks
      * 
@@ -184,19 +513,353 @@ class VEIGAR_API Veigar {
      */
     uint32_t timeoutOfRWLock() const;
 
+    /**
+     * @brief Sets how the priority lanes are drained, both for outgoing calls and for incoming calls
+     *
+     * Must be called before init.
+     *
+     * @param policy The priority policy (default: PriorityPolicy::STRICT)
+     */
+    void setPriorityPolicy(PriorityPolicy policy);
+
+    /**
+     * @brief Returns the current priority policy
+     */
+    PriorityPolicy priorityPolicy() const;
+
+    /**
+     * @brief Sets the order of the calls of the same priority
+     *
+     * Applies to the outgoing calls of this instance and to the dispatch of the calls it receives.
+     * With SchedulingPolicy::EDF, a call close to its deadline is not held up by calls with time to spare.
+     * Must be called before init.
+     *
+     * @param policy The scheduling policy (default: SchedulingPolicy::FIFO)
+     */
+    void setSchedulingPolicy(SchedulingPolicy policy);
+
+    /**
+     * @brief Returns the current scheduling policy
+     */
+    SchedulingPolicy schedulingPolicy() const;
+
+    /**
+     * @brief Sets whether the outgoing calls carry their deadline to the target
+     *
+     * The target then answers a call that has expired before it is dispatched with ErrorCode::TIMEOUT without running it,
+     * orders the calls by deadline under SchedulingPolicy::EDF, and reports the time remaining through CallContext.
+     * The deadline is packed as an extra element of the call message, which the versions of Veigar without deadline support
+     * do not accept: they drop such calls, and the caller only sees them time out. Enable it once every target is upgraded.
+     * Must be called before init.
+     *
+     * @param enable Whether to send the deadline with the calls (default: false)
+     */
+    void setDeadlinePropagation(bool enable);
+
+    /**
+     * @brief Returns whether the outgoing calls carry their deadline
+     */
+    bool deadlinePropagation() const;
+
+    /**
+     * @brief Sets how the calls this instance receives are shared among their callers
+     *
+     * With FairnessPolicy::CALLER, a caller that floods the call queue no longer holds up the calls of the others.
+     * Must be called before init.
+     *
+     * @param policy The fairness policy (default: FairnessPolicy::NONE)
+     */
+    void setFairnessPolicy(FairnessPolicy policy);
+
+    /**
+     * @brief Returns the current fairness policy
+     */
+    FairnessPolicy fairnessPolicy() const;
+
+    /**
+     * @brief Sets the share of the dispatcher threads the caller gets with FairnessPolicy::CALLER
+     *
+     * A caller of weight 2 dispatches two calls in each of its turns, twice as many as a caller of the default weight.
+     * Can be changed at any time.
+     *
+     * @param callerChannelName The channel name of the caller
+     * @param weight The weight, 0 resets it to the default (1)
+     */
+    void setCallerWeight(const std::string& callerChannelName, uint32_t weight);
+
+    /**
+     * @brief Splits the call queue of this instance into shards
+     *
+     * Each shard is a call queue of its own, with its own lock, wakeup semaphore and drain threads,
+     * so that the callers no longer all contend on a single queue. Each shard has the full capacity given to init.
+     * The priorities, deadlines, fairness and admission control still apply across all shards.
+     * Must be called before init.
+     *
+     * @param shardNumber The number of shards, from 1 (default) to VEIGAR_CALL_QUEUE_MAX_SHARD_NUMBER
+     */
+    void setCallQueueShards(uint32_t shardNumber);
+
+    /**
+     * @brief Returns the number of call queue shards
+     */
+    uint32_t callQueueShards() const;
+
+    /**
+     * @brief Sets how this instance picks the shard of the target for each call
+     *
+     * Must be called before init.
+     *
+     * @param policy The shard policy (default: ShardPolicy::CALLER_HASH)
+     */
+    void setShardPolicy(ShardPolicy policy);
+
+    /**
+     * @brief Returns the current shard policy
+     */
+    ShardPolicy shardPolicy() const;
+
+    /**
+     * @brief Sets what the callers do when the call queue of this instance is full
+     *
+     * Must be called before init. The callers of all processes follow the policy of the queue,
+     * and Statistics::callQueue counts the calls dropped, rejected and blocked.
+     *
+     * @param policy The queue full policy (default: QueueFullPolicy::BLOCK)
+     */
+    void setCallQueueFullPolicy(QueueFullPolicy policy);
+
+    /**
+     * @brief Returns the current call queue full policy
+     */
+    QueueFullPolicy callQueueFullPolicy() const;
+
+    /**
+     * @brief Sets what the targets do when the response queue of this instance is full
+     *
+     * Must be called before init. With QueueFullPolicy::DROP_OLDEST, the calls whose responses are dropped time out.
+     *
+     * @param policy The queue full policy (default: QueueFullPolicy::BLOCK)
+     */
+    void setResponseQueueFullPolicy(QueueFullPolicy policy);
+
+    /**
+     * @brief Returns the current response queue full policy
+     */
+    QueueFullPolicy responseQueueFullPolicy() const;
+
+    /**
+     * @brief Lets the application dispatch the incoming calls and responses from its own event loop
+     *
+     * In poll mode, no call or response dispatcher threads are started. The application waits for the
+     * handles returned by pollHandles to become readable (poll/epoll on POSIX, WaitForMultipleObjects on Windows),
+     * then calls processReady, which runs the call handlers and completes the calls on the calling thread.
+     * Stream functions still run on the instance's threads, since they wait for credits of the reader.
+     * Must be called before init.
+     *
+     * @param enable Whether to enable poll mode (default: false)
+     */
+    void setPollMode(bool enable);
+
+    /**
+     * @brief Returns whether poll mode is enabled
+     */
+    bool pollMode() const;
+
+    /**
+     * @brief Returns the readiness handles of the call queue shards and the response queue
+     *
+     * On POSIX, the handles are file descriptors that become readable when a message is pushed.
+     * On Windows, the handles are semaphores that are signaled when a message is pushed, waiting on one consumes the signal.
+     * Only valid between init and uninit, and only in poll mode.
+     */
+    std::vector<PollHandle> pollHandles() const;
+
+    /**
+     * @brief Dispatches the calls and responses that are ready, on the calling thread
+     *
+     * Does not block, the handles are ready again if messages are left.
+     *
+     * @param maxMessages The maximum number of queue messages to process per queue, 0 means all of them
+     * @return The number of queue messages processed
+     */
+    uint32_t processReady(uint32_t maxMessages = 0);
+
+    /**
+     * @brief Starts no thread of the instance at all, the application drives it by calling poll
+     *
+     * Implies poll mode. The calls and responses are only sent, received and completed by poll,
+     * so a synchronous call or a wait on a result must not be made on the polling thread, it would time out.
+     * The result callbacks run on the polling thread unless CallbackPolicy::EXECUTOR is set.
+     * Only poll drains the send queues and returns the flow control credits, so instead of waiting for them,
+     * a call fails at once with ErrorCode::BUSY when the send queue is full under SendQueuePolicy::BLOCK,
+     * or when the target has no credit left (see setFlowControl).
+     * Stream functions are not supported, their calls fail with ErrorCode::FAILED.
+     * Must be called before init.
+     *
+     * @param enable Whether to start no thread (default: false)
+     */
+    void setThreadless(bool enable);
+
+    /**
+     * @brief Returns whether the instance is thread-less
+     */
+    bool threadless() const;
+
+    /**
+     * @brief Drives a thread-less instance for one round
+     *
+     * Sends the queued calls, dispatches the calls and responses that are ready, running the functions and the callbacks,
+     * sends the responses, then completes the calls past their deadline. Everything runs on the calling thread.
+     * The queued messages that do not fit into a full target queue are kept for the next round.
+     *
+     * @param maxMessages The maximum number of queue messages to process per queue, 0 means all of them
+     * @param timeoutMS How long to wait for a message when none is ready, 0 means not to wait
+     * @return The number of messages processed
+     */
+    uint32_t poll(uint32_t maxMessages = 0, uint32_t timeoutMS = 0);
+
+    /**
+     * @brief Bounds the outgoing call and response queues of this instance
+     *
+     * The calls are queued in process memory until they are pushed to the target's call queue,
+     * the bounds keep a slow target from piling them up. Must be called before init.
+     *
+     * @param limit The bounds and the policy applied when they are reached (default: see SendQueueLimit)
+     */
+    void setSendQueueLimit(const SendQueueLimit& limit);
+
+    /**
+     * @brief Returns the bounds set by setSendQueueLimit
+     */
+    SendQueueLimit sendQueueLimit() const;
+
+    /**
+     * @brief Sheds incoming calls when too many of them are waiting to be dispatched
+     *
+     * A shed call is not run, the caller gets ErrorCode::OVERLOADED right away and may retry it elsewhere.
+     * Shed notifications are dropped. Can be changed at any time.
+     *
+     * @param maxPending The maximum number of pending calls, 0 means unlimited (default)
+     */
+    void setPendingCallLimit(uint32_t maxPending);
+
+    /**
+     * @brief Sheds incoming calls to the function when too many of them are queued or running
+     *
+     * A call of a function bound by bindDeferred is in flight until its Responder responds or is destroyed.
+     * Each entry of a batch also counts against the limit of its function, an entry that is shed fails alone.
+     *
+     * @param funcName The function name
+     * @param maxInFlight The maximum number of calls in flight, 0 means unlimited (default)
+     */
+    void setFunctionCallLimit(const std::string& funcName, uint32_t maxInFlight);
+
+    /**
+     * @brief Sheds incoming calls from the caller when too many of them are queued or running
+     *
+     * @param callerChannelName The channel name of the caller
+     * @param maxInFlight The maximum number of calls in flight, 0 means unlimited (default)
+     */
+    void setCallerCallLimit(const std::string& callerChannelName, uint32_t maxInFlight);
+
+    /**
+     * @brief Bounds the calls in flight to each target channel
+     *
+     * Each target is granted the same budget of calls and bytes, the credits return as the calls complete.
+     * Out of credit, the caller waits locally instead of filling the call queue of the target,
+     * so that many callers of a saturated target keep making progress. Must be called before init.
+     *
+     * @param limit The budget of each target (default: unlimited)
+     */
+    void setFlowControl(const FlowControlLimit& limit);
+
+    /**
+     * @brief Returns the budget set by setFlowControl
+     */
+    FlowControlLimit flowControl() const;
+
+    /**
+     * @brief Sets where the result callbacks are run
+     *
+     * This applies to the callbacks of asyncCall and to everything built on them (CallFuture, callAll, coroutines).
+     * The promise of asyncCall is always fulfilled on the response dispatcher thread.
+     * Must be called before init.
+     *
+     * @param policy The callback policy (default: CallbackPolicy::INLINE)
+     * @param executor The executor used by CallbackPolicy::EXECUTOR
+     */
+    void setCallbackPolicy(CallbackPolicy policy, Executor executor = Executor());
+
+    /**
+     * @brief Returns the current callback policy
+     */
+    CallbackPolicy callbackPolicy() const;
+
+    /**
+     * @brief Returns the executor set by setCallbackPolicy
+     */
+    Executor callbackExecutor() const;
+
+    /**
+     * @brief Names the internal threads of the role and pins them to the given CPUs
+     *
+     * Must be called before init. Pinning is not supported on macOS.
+     *
+     * @param role The internal threads to pin
+     * @param cpus The CPU indexes, empty means the threads are not pinned (default)
+     */
+    void setCpuAffinity(ThreadRole role, const std::vector<uint32_t>& cpus);
+
+    /**
+     * @brief Returns the CPUs the internal threads of the role are pinned to
+     */
+    std::vector<uint32_t> cpuAffinity(ThreadRole role) const;
+
+    /**
+     * @brief Binds the shared memory of this channel's call and response queues to a NUMA node
+     *
+     * Must be called before init. Only supported on Linux and Windows,
+     * the placement actually applied is reported by statistics().
+     *
+     * @param node The NUMA node, -1 means no binding (default)
+     */
+    void setNumaNode(int32_t node);
+
+    /**
+     * @brief Returns the NUMA node set by setNumaNode
+     */
+    int32_t numaNode() const;
+
+    /**
+     * @brief Returns a snapshot of the runtime state, including the thread and memory placement
+     */
+    Statistics statistics() const;
+
    private:
     std::string getNextCallId(const std::string& funcName) const;
 
+    // Monotonic microseconds, see ResultMeta::deadline.
+    static int64_t deadlineAfter(uint32_t timeoutMS);
+
+    // flag(0) - callId - callerChannelName - funcName - args [- deadline]
+    // The deadline is only packed with setDeadlinePropagation.
+    template <typename T>
+    void packCall(veigar_msgpack::sbuffer& buffer, const std::string& callId, const std::string& funcName, const T& argsObj, int64_t deadline) const;
+
     // std::promise will not set_exception forever.
     template <typename... Args>
     std::shared_ptr<AsyncCallResult> doAsyncCall(
+        CallPriority priority,
         const std::string& targetChannel,
         uint32_t timeoutMS,
         const std::string& funcName,
         Args... args);
 
+    // Return the call id, empty if the call could not be sent.
     template <typename... Args>
-    void doAsyncCallWithCallback(
+    std::string doAsyncCallWithCallback(
+        CallPriority priority,
+        int64_t deadline,  // monotonic microseconds, 0 = none
         ResultCallback cb,
         const std::string& targetChannel,
         uint32_t timeoutMS,
@@ -204,14 +867,47 @@ class VEIGAR_API Veigar {
         Args... args);
 
     bool sendCall(
+        CallPriority priority,
         const std::string& channelName,
         uint32_t timeoutMS,
         std::shared_ptr<veigar_msgpack::sbuffer> buffer,
         const std::string& callId,
         const std::string& funcName,
         const ResultMeta& retMeta,
+        ErrorCode& errCode,
         std::string& errMsg);
 
+    // Sends the call with the packed 'args' to each target.
+    std::shared_ptr<MultiCallResult> sendMultiCall(
+        MultiResultCallback cb,
+        const std::vector<std::string>& targetChannels,
+        uint32_t timeoutMS,
+        const std::string& funcName,
+        const veigar_msgpack::sbuffer& args);
+
+    std::shared_ptr<StreamReader> sendStreamCall(
+        CallPriority priority,
+        const std::string& targetChannel,
+        uint32_t timeoutMS,
+        std::shared_ptr<veigar_msgpack::sbuffer> buffer,
+        const std::string& callId,
+        const std::string& funcName);
+
+    // Grants the stream function more items, a negative credit cancels the stream.
+    void sendStreamCredit(
+        const std::string& targetChannel,
+        const std::string& callId,
+        int64_t credit);
+
+    // Tells the target to skip the call, or the running function that the call has been cancelled.
+    void sendCancel(const std::string& targetChannel, const std::string& callId);
+
+    bool publishData(
+        const std::string& topic,
+        const uint8_t* buf,
+        size_t bufSize,
+        uint32_t timeoutMS);
+
     bool sendResponse(
         const std::string& targetChannel,
         const uint8_t* buf,
@@ -7,11 +7,27 @@
  */
 namespace veigar {
 template <typename F>
-bool Veigar::bind(const std::string& funcName, F func) {
+bool Veigar::bind(const std::string& funcName, F func, CallPriority priority) {
     if (!callDisp_) {
         return false;
     }
-    return callDisp_->bind(funcName, func);
+    return callDisp_->bind(funcName, func, priority);
+}
+
+template <typename F>
+bool Veigar::bindDeferred(const std::string& funcName, F func, CallPriority priority) {
+    if (!callDisp_) {
+        return false;
+    }
+    return callDisp_->bindDeferred(funcName, func, priority);
+}
+
+template <typename F>
+bool Veigar::bindStream(const std::string& funcName, F func, CallPriority priority) {
+    if (!callDisp_) {
+        return false;
+    }
+    return callDisp_->bindStream(funcName, func, priority);
 }
 
 template <typename... Args>
@@ -19,17 +35,57 @@ std::shared_ptr<AsyncCallResult> Veigar::asyncCall(const std::string& targetChan
                                                    uint32_t timeoutMS,
                                                    const std::string& funcName,
                                                    Args... args) {
-    return doAsyncCall(targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+    return doAsyncCall(CallPriority::NORMAL, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+std::shared_ptr<AsyncCallResult> Veigar::asyncCall(CallPriority priority,
+                                                   const std::string& targetChannel,
+                                                   uint32_t timeoutMS,
+                                                   const std::string& funcName,
+                                                   Args... args) {
+    return doAsyncCall(priority, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+void Veigar::asyncCall(
+    ResultCallback cb,
+    const std::string& targetChannel,
+    uint32_t timeoutMS,
+    const std::string& funcName,
+    Args... args) {
+    doAsyncCallWithCallback(CallPriority::NORMAL, 0, cb, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void Veigar::asyncCall(
+    CallPriority priority,
     ResultCallback cb,
     const std::string& targetChannel,
     uint32_t timeoutMS,
     const std::string& funcName,
     Args... args) {
-    doAsyncCallWithCallback(cb, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+    doAsyncCallWithCallback(priority, 0, cb, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+CallFuture Veigar::asyncCallFuture(const std::string& targetChannel,
+                                   uint32_t timeoutMS,
+                                   const std::string& funcName,
+                                   Args... args) {
+    return asyncCallFuture(CallPriority::NORMAL, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+CallFuture Veigar::asyncCallFuture(CallPriority priority,
+                                   const std::string& targetChannel,
+                                   uint32_t timeoutMS,
+                                   const std::string& funcName,
+                                   Args... args) {
+    CallFuture future = CallFuture::Create();
+    future.setCallId(
+        doAsyncCallWithCallback(priority, deadlineAfter(timeoutMS), future.completer(), targetChannel, timeoutMS, funcName, std::forward<Args>(args)...));
+    return future;
 }
 
 template <typename... Args>
@@ -37,7 +93,16 @@ CallResult Veigar::syncCall(const std::string& targetChannel,
                             uint32_t timeoutMS,
                             const std::string& funcName,
                             Args... args) {
-    std::shared_ptr<AsyncCallResult> acr = doAsyncCall(targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+    return syncCall(CallPriority::NORMAL, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+CallResult Veigar::syncCall(CallPriority priority,
+                            const std::string& targetChannel,
+                            uint32_t timeoutMS,
+                            const std::string& funcName,
+                            Args... args) {
+    std::shared_ptr<AsyncCallResult> acr = doAsyncCall(priority, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
     if (!acr || !acr->second.valid()) {
         if (acr) {
             releaseCall(acr->first);
@@ -57,7 +122,114 @@ CallResult Veigar::syncCall(const std::string& targetChannel,
 }
 
 template <typename... Args>
-std::shared_ptr<AsyncCallResult> Veigar::doAsyncCall(const std::string& targetChannel,
+bool Veigar::notify(const std::string& targetChannel,
+                    const std::string& funcName,
+                    Args... args) {
+    return notify(CallPriority::NORMAL, targetChannel, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+bool Veigar::notify(CallPriority priority,
+                    const std::string& targetChannel,
+                    const std::string& funcName,
+                    Args... args) {
+    const std::string callId = getNextCallId(funcName);
+    assert(!callId.empty());
+    if (callId.empty()) {
+        return false;
+    }
+
+    try {
+        std::string curChannelName = channelName();
+        auto argsObj = std::make_tuple(args...);
+        auto notifyObj = std::make_tuple(2, callId, curChannelName, funcName, argsObj);
+
+        auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
+        veigar_msgpack::pack(*buffer, notifyObj);
+
+        ResultMeta retMeta;
+        retMeta.metaType = 2;
+
+        ErrorCode errCode = ErrorCode::FAILED;
+        std::string errMsg;
+        return sendCall(priority, targetChannel, VEIGAR_WRITE_NOTIFICATION_QUEUE_TIMEOUT, buffer, callId, funcName, retMeta, errCode, errMsg);
+    } catch (std::exception&) {
+        return false;
+    }
+}
+
+template <typename... Args>
+std::shared_ptr<StreamReader> Veigar::streamCall(const std::string& targetChannel,
+                                                 uint32_t timeoutMS,
+                                                 const std::string& funcName,
+                                                 Args... args) {
+    return streamCall(CallPriority::NORMAL, targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+std::shared_ptr<StreamReader> Veigar::streamCall(CallPriority priority,
+                                                 const std::string& targetChannel,
+                                                 uint32_t timeoutMS,
+                                                 const std::string& funcName,
+                                                 Args... args) {
+    const std::string callId = getNextCallId(funcName);
+    assert(!callId.empty());
+    if (callId.empty()) {
+        return nullptr;
+    }
+
+    try {
+        std::string curChannelName = channelName();
+        auto argsObj = std::make_tuple(args...);
+        auto callObj = std::make_tuple(3, callId, curChannelName, funcName, argsObj);
+
+        auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
+        veigar_msgpack::pack(*buffer, callObj);
+
+        return sendStreamCall(priority, targetChannel, timeoutMS, buffer, callId, funcName);
+    } catch (std::exception&) {
+        return nullptr;
+    }
+}
+
+template <typename... Args>
+std::shared_ptr<MultiCallResult> Veigar::callAll(const std::vector<std::string>& targetChannels,
+                                                 uint32_t timeoutMS,
+                                                 const std::string& funcName,
+                                                 Args... args) {
+    return callAll(MultiResultCallback(), targetChannels, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+std::shared_ptr<MultiCallResult> Veigar::callAll(MultiResultCallback cb,
+                                                 const std::vector<std::string>& targetChannels,
+                                                 uint32_t timeoutMS,
+                                                 const std::string& funcName,
+                                                 Args... args) {
+    veigar_msgpack::sbuffer argsBuffer;
+    try {
+        veigar_msgpack::pack(argsBuffer, std::make_tuple(args...));
+    } catch (std::exception&) {
+        argsBuffer.clear();
+    }
+
+    return sendMultiCall(cb, targetChannels, timeoutMS, funcName, argsBuffer);
+}
+
+template <typename T>
+bool Veigar::publish(const std::string& topic, const T& event, uint32_t timeoutMS) {
+    try {
+        veigar_msgpack::sbuffer buffer;
+        veigar_msgpack::pack(buffer, event);
+        return publishData(topic, (const uint8_t*)buffer.data(), buffer.size(), timeoutMS);
+    } catch (std::exception&) {
+        return false;
+    }
+}
+
+template <typename... Args>
+std::shared_ptr<AsyncCallResult> Veigar::doAsyncCall(CallPriority priority,
+                                                     const std::string& targetChannel,
                                                      uint32_t timeoutMS,
                                                      const std::string& funcName,
                                                      Args... args) {
@@ -77,19 +249,19 @@ std::shared_ptr<AsyncCallResult> Veigar::doAsyncCall(const std::string& targetCh
     try {
         auto ft = p->get_future();
 
-        std::string curChannelName = channelName();
         auto argsObj = std::make_tuple(args...);
-        auto callObj = std::make_tuple(0, callId, curChannelName, funcName, argsObj);
 
         auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
-        veigar_msgpack::pack(*buffer, callObj);
+        packCall(*buffer, callId, funcName, argsObj, deadlineAfter(timeoutMS));
 
         ResultMeta retMeta;
         retMeta.metaType = 0;
         retMeta.p = p;
 
+        ErrorCode errCode = ErrorCode::FAILED;
         std::string errMsg;
-        if (!sendCall(targetChannel, timeoutMS, buffer, callId, funcName, retMeta, errMsg)) {
+        if (!sendCall(priority, targetChannel, timeoutMS, buffer, callId, funcName, retMeta, errCode, errMsg)) {
+            failedRet.errCode = errCode;
             if (errMsg.empty()) {
                 failedRet.errorMessage = "Send failed: Unknown.";
             }
@@ -110,7 +282,9 @@ std::shared_ptr<AsyncCallResult> Veigar::doAsyncCall(const std::string& targetCh
 }
 
 template <typename... Args>
-void Veigar::doAsyncCallWithCallback(
+std::string Veigar::doAsyncCallWithCallback(
+    CallPriority priority,
+    int64_t deadline,
     ResultCallback cb,
     const std::string& targetChannel,
     uint32_t timeoutMS,
@@ -126,23 +300,25 @@ void Veigar::doAsyncCallWithCallback(
             failedRet.errorMessage = "Unable to generate call id.";
             cb(failedRet);
         }
-        return;
+        return std::string();
     }
 
     try {
-        std::string curChannelName = channelName();
         auto argsObj = std::make_tuple(args...);
-        auto callObj = std::make_tuple(0, callId, curChannelName, funcName, argsObj);
 
+        // The target skips the call once the caller no longer waits for it.
         auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
-        veigar_msgpack::pack(*buffer, callObj);
+        packCall(*buffer, callId, funcName, argsObj, deadline > 0 ? deadline : deadlineAfter(timeoutMS));
 
         ResultMeta retMeta;
         retMeta.metaType = 1;
         retMeta.cb = cb;
+        retMeta.deadline = deadline;
 
+        ErrorCode errCode = ErrorCode::FAILED;
         std::string errMsg;
-        if (!sendCall(targetChannel, timeoutMS, buffer, callId, funcName, retMeta, errMsg)) {
+        if (!sendCall(priority, targetChannel, timeoutMS, buffer, callId, funcName, retMeta, errCode, errMsg)) {
+            failedRet.errCode = errCode;
             if (errMsg.empty()) {
                 failedRet.errorMessage = "Send failed: Unknown.";
             }
@@ -153,14 +329,62 @@ void Veigar::doAsyncCallWithCallback(
             if (cb) {
                 cb(failedRet);
             }
-            return;
+            return std::string();
         }
     } catch (std::exception& e) {
         failedRet.errorMessage = e.what();
         if (cb) {
             cb(failedRet);
         }
-        return;
+        return std::string();
     }
+
+    return callId;
+}
+
+template <typename T>
+void Veigar::packCall(veigar_msgpack::sbuffer& buffer, const std::string& callId, const std::string& funcName, const T& argsObj, int64_t deadline) const {
+    const bool withDeadline = deadlinePropagation();
+    veigar_msgpack::packer<veigar_msgpack::sbuffer> pk(buffer);
+    pk.pack_array(withDeadline ? 6 : 5);
+    pk.pack(0);
+    pk.pack(callId);
+    pk.pack(channelName());
+    pk.pack(funcName);
+    pk.pack(argsObj);
+    if (withDeadline) {
+        pk.pack(deadline);
+    }
+}
+
+#if VEIGAR_HAS_COROUTINE
+template <typename... Args>
+CallAwaitable Veigar::call(const std::string& targetChannel,
+                           uint32_t timeoutMS,
+                           const std::string& funcName,
+                           Args... args) {
+    return call(Executor(), targetChannel, timeoutMS, funcName, std::forward<Args>(args)...);
+}
+
+template <typename... Args>
+CallAwaitable Veigar::call(Executor executor,
+                           const std::string& targetChannel,
+                           uint32_t timeoutMS,
+                           const std::string& funcName,
+                           Args... args) {
+    std::shared_ptr<CallAwaitable::State> state = std::make_shared<CallAwaitable::State>();
+    state->executor = std::move(executor);
+
+    doAsyncCallWithCallback(
+        CallPriority::NORMAL,
+        deadlineAfter(timeoutMS),
+        [state](const CallResult& ret) { state->complete(ret); },
+        targetChannel,
+        timeoutMS,
+        funcName,
+        std::forward<Args>(args)...);
+
+    return CallAwaitable(state);
 }
-}  // namespace veigar
\ No newline at end of file
+#endif
+}  // namespace veigar
@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "broadcast_ring.h"
+#include <assert.h>
+#include <cstring>
+#include <thread>
+#include "log.h"
+#include "time_util.h"
+
+namespace veigar {
+/*
+| Header | Slot 0 | Slot 1 | ... | Ring data (capacity) |
+
+Each record in the ring data:
+| Payload Size | Seq | Payload (padded to 8 bytes) |
+|      8       |  8  |                             |
+
+A record never wraps, if it does not fit at the end of the ring,
+the remaining bytes are skipped (marked by a payload size of -1) and the record is written at the beginning.
+
+The positions are the total number of bytes written, the offset in the ring is position % capacity.
+*/
+struct BroadcastRing::Header {
+    int64_t capacity;
+    int64_t maxReaders;
+    int64_t policy;
+    int64_t writePos;  // where the next record will be written
+    int64_t tailPos;   // the oldest record still in the ring
+    int64_t nextSeq;
+    int64_t stallTimeout;  // microseconds
+};
+
+struct BroadcastRing::Slot {
+    int64_t active;
+    int64_t cursor;  // the next record to read
+    int64_t missed;
+    int64_t blockedSince;  // monotonic microseconds since the reader holds back the writer, 0 if it does not
+    int64_t stalled;       // the writer no longer waits for the reader
+};
+
+namespace {
+const int64_t kRecordHeaderSize = sizeof(int64_t) * 2;
+const int64_t kSkipMark = -1;
+const uint32_t kLockTimeout = 1000;  // ms
+
+int64_t Align8(int64_t size) {
+    return (size + 7) & ~((int64_t)7);
+}
+}  // namespace
+
+BroadcastRing::~BroadcastRing() {
+    close();
+}
+
+int64_t BroadcastRing::HeaderSize(int32_t maxReaders) {
+    return (int64_t)sizeof(Header) + (int64_t)sizeof(Slot) * maxReaders;
+}
+
+bool BroadcastRing::create(const std::string& name,
+                           int64_t capacity,
+                           int32_t maxReaders,
+                           TopicPolicy policy,
+                           int64_t stallTimeoutMS) {
+    assert(!shm_);
+    capacity = Align8(capacity);
+    if (name.empty() || capacity <= kRecordHeaderSize || maxReaders <= 0) {
+        return false;
+    }
+
+    bool result = false;
+    do {
+        creator_ = true;
+        name_ = name;
+
+        const int64_t shmSize = HeaderSize(maxReaders) + capacity;
+        shm_ = std::make_shared<SharedMemory>(name + "_shm", shmSize);
+        if (!shm_->create()) {
+            break;
+        }
+
+        lock_ = std::make_shared<Semaphore>();
+        if (!lock_->create(name + "_rwlock", 1, 1)) {
+            break;
+        }
+
+        bool smpCreated = true;
+        for (int32_t i = 0; i < maxReaders; ++i) {
+            std::shared_ptr<Semaphore> smp = std::make_shared<Semaphore>();
+            if (!smp->create(name + "_readsmp" + std::to_string(i), 0)) {
+                smpCreated = false;
+                break;
+            }
+            readSmps_.push_back(smp);
+        }
+
+        if (!smpCreated) {
+            break;
+        }
+
+        memset(shm_->data(), 0, (size_t)shmSize);
+        Header* h = header();
+        h->capacity = capacity;
+        h->maxReaders = maxReaders;
+        h->policy = (int64_t)policy;
+        h->stallTimeout = stallTimeoutMS * 1000;
+
+        result = true;
+    } while (false);
+
+    if (!result) {
+        close();
+    }
+
+    return result;
+}
+
+bool BroadcastRing::open(const std::string& name) {
+    assert(!shm_);
+    if (name.empty()) {
+        return false;
+    }
+
+    bool result = false;
+    do {
+        creator_ = false;
+        name_ = name;
+
+        // Map the header first to learn the size of the ring.
+        int64_t capacity = 0;
+        int32_t maxReaders = 0;
+        {
+            SharedMemory headerShm(name + "_shm", sizeof(Header));
+            if (!headerShm.open()) {
+                break;
+            }
+            const Header* h = (const Header*)headerShm.data();
+            capacity = h->capacity;
+            maxReaders = (int32_t)h->maxReaders;
+            headerShm.close();
+        }
+
+        if (capacity <= 0 || maxReaders <= 0) {
+            veigar::log("Veigar: [ERROR] Invalid broadcast ring header: %s.\n", name.c_str());
+            break;
+        }
+
+        shm_ = std::make_shared<SharedMemory>(name + "_shm", HeaderSize(maxReaders) + capacity);
+        if (!shm_->open()) {
+            break;
+        }
+
+        lock_ = std::make_shared<Semaphore>();
+        if (!lock_->open(name + "_rwlock", 1)) {
+            break;
+        }
+
+        bool smpOpened = true;
+        for (int32_t i = 0; i < maxReaders; ++i) {
+            std::shared_ptr<Semaphore> smp = std::make_shared<Semaphore>();
+            if (!smp->open(name + "_readsmp" + std::to_string(i), 0)) {
+                smpOpened = false;
+                break;
+            }
+            readSmps_.push_back(smp);
+        }
+
+        if (!smpOpened) {
+            break;
+        }
+
+        result = true;
+    } while (false);
+
+    if (!result) {
+        close();
+    }
+
+    return result;
+}
+
+void BroadcastRing::close() {
+    for (auto& smp : readSmps_) {
+        smp->close();
+    }
+    readSmps_.clear();
+
+    if (lock_) {
+        lock_->close();
+        lock_.reset();
+    }
+
+    if (shm_) {
+        shm_->close();
+        shm_.reset();
+    }
+
+    name_.clear();
+}
+
+bool BroadcastRing::write(const void* data, int64_t size, uint32_t timeoutMS) {
+    assert(creator_ && shm_);
+    if (!creator_ || !shm_ || size < 0) {
+        return false;
+    }
+
+    Header* h = header();
+    const int64_t need = kRecordHeaderSize + Align8(size);
+    if (need > h->capacity) {
+        veigar::log("Veigar: [ERROR] Event is too large for broadcast ring %s (%" PRId64 " bytes).\n", name_.c_str(), size);
+        return false;
+    }
+
+    const int64_t startTime = TimeUtil::GetMonotonicTimestamp();
+    if (!lock()) {
+        return false;
+    }
+
+    int64_t offset = 0;
+    int64_t skip = 0;
+    while (true) {
+        // Computed again after the lock is re-acquired, the ring may have been written by other threads.
+        offset = h->writePos % h->capacity;
+        skip = (h->capacity - offset < need) ? h->capacity - offset : 0;
+        if (h->writePos + skip + need - h->tailPos <= h->capacity) {
+            break;
+        }
+
+        if (dropOldest()) {
+            continue;
+        }
+
+        // TopicPolicy::BLOCK, wait for the slow readers.
+        unlock();
+        if (TimeUtil::GetMonotonicTimestamp() - startTime >= (int64_t)timeoutMS * 1000) {
+            veigar::log("Veigar: [WARNING] Broadcast ring %s is full, waiting for slow subscribers timeout.\n", name_.c_str());
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (!lock()) {
+            return false;
+        }
+    }
+
+    uint8_t* ring = ringData();
+    if (skip > 0) {
+        *(int64_t*)(ring + offset) = kSkipMark;
+    }
+
+    uint8_t* record = ring + (h->writePos + skip) % h->capacity;
+    *(int64_t*)record = size;
+    *(int64_t*)(record + sizeof(int64_t)) = h->nextSeq;
+    if (size > 0) {
+        memcpy(record + kRecordHeaderSize, data, (size_t)size);
+    }
+
+    h->writePos += skip + need;
+    h->nextSeq++;
+
+    std::vector<int32_t> activeSlots;
+    for (int32_t i = 0; i < (int32_t)h->maxReaders; ++i) {
+        if (slot(i)->active) {
+            activeSlots.push_back(i);
+        }
+    }
+
+    unlock();
+
+    for (int32_t i : activeSlots) {
+        notifyRead(i);
+    }
+
+    return true;
+}
+
+bool BroadcastRing::dropOldest() {
+    // The lock must be held by caller.
+    Header* h = header();
+    assert(h->tailPos < h->writePos);
+    if (h->tailPos >= h->writePos) {
+        return false;
+    }
+
+    const int64_t offset = h->tailPos % h->capacity;
+    const int64_t size = *(int64_t*)(ringData() + offset);
+    const bool skipped = (size == kSkipMark);
+    const int64_t next = h->tailPos + (skipped ? h->capacity - offset : kRecordHeaderSize + Align8(size));
+
+    if ((TopicPolicy)h->policy == TopicPolicy::BLOCK && !skipped) {
+        const int64_t now = TimeUtil::GetMonotonicTimestamp();
+        bool blocked = false;
+        for (int32_t i = 0; i < (int32_t)h->maxReaders; ++i) {
+            Slot* s = slot(i);
+            if (!s->active || s->stalled || s->cursor >= next) {
+                continue;
+            }
+
+            if (s->blockedSince == 0) {
+                s->blockedSince = now;
+            }
+            else if (now - s->blockedSince >= h->stallTimeout) {
+                veigar::log("Veigar: [WARNING] Reader %d of broadcast ring %s has stalled, it is lapped until it reads again.\n", i, name_.c_str());
+                s->stalled = 1;
+                continue;
+            }
+            blocked = true;
+        }
+
+        if (blocked) {
+            return false;
+        }
+    }
+
+    for (int32_t i = 0; i < (int32_t)h->maxReaders; ++i) {
+        Slot* s = slot(i);
+        if (s->active && s->cursor < next) {
+            s->cursor = next;
+            if (!skipped) {
+                s->missed++;
+            }
+        }
+    }
+
+    h->tailPos = next;
+    return true;
+}
+
+int32_t BroadcastRing::attach() {
+    if (!shm_ || !lock()) {
+        return -1;
+    }
+
+    int32_t index = -1;
+    Header* h = header();
+    for (int32_t i = 0; i < (int32_t)h->maxReaders; ++i) {
+        Slot* s = slot(i);
+        if (!s->active) {
+            s->active = 1;
+            s->cursor = h->writePos;
+            s->missed = 0;
+            s->blockedSince = 0;
+            s->stalled = 0;
+            index = i;
+            break;
+        }
+    }
+
+    unlock();
+
+    // Drain the wakeups left by the previous reader of the slot.
+    if (index >= 0) {
+        while (readSmps_[index]->wait(0)) {
+        }
+    }
+
+    return index;
+}
+
+void BroadcastRing::detach(int32_t slotIndex) {
+    if (!shm_ || slotIndex < 0 || slotIndex >= (int32_t)header()->maxReaders) {
+        return;
+    }
+
+    const bool locked = lock();
+    slot(slotIndex)->active = 0;
+    if (locked) {
+        unlock();
+    }
+}
+
+bool BroadcastRing::read(int32_t slotIndex, std::vector<uint8_t>& buf, uint64_t& seq, uint64_t& missed) {
+    if (!shm_ || slotIndex < 0 || slotIndex >= (int32_t)header()->maxReaders) {
+        return false;
+    }
+
+    if (!lock()) {
+        return false;
+    }
+
+    bool result = false;
+    Header* h = header();
+    Slot* s = slot(slotIndex);
+    while (s->active && s->cursor < h->writePos) {
+        assert(s->cursor >= h->tailPos);
+        const int64_t offset = s->cursor % h->capacity;
+        const uint8_t* record = ringData() + offset;
+        const int64_t size = *(const int64_t*)record;
+        if (size == kSkipMark) {
+            s->cursor += h->capacity - offset;
+            continue;
+        }
+
+        seq = *(const uint64_t*)(record + sizeof(int64_t));
+        missed = (uint64_t)s->missed;
+        buf.assign(record + kRecordHeaderSize, record + kRecordHeaderSize + size);
+
+        s->cursor += kRecordHeaderSize + Align8(size);
+        s->missed = 0;
+        s->blockedSince = 0;
+        s->stalled = 0;
+        result = true;
+        break;
+    }
+
+    unlock();
+    return result;
+}
+
+bool BroadcastRing::waitForRead(int32_t slotIndex, int64_t ms) {
+    if (slotIndex < 0 || slotIndex >= (int32_t)readSmps_.size()) {
+        return false;
+    }
+    return readSmps_[slotIndex]->wait(ms);
+}
+
+void BroadcastRing::notifyRead(int32_t slotIndex) {
+    if (slotIndex < 0 || slotIndex >= (int32_t)readSmps_.size()) {
+        return;
+    }
+    readSmps_[slotIndex]->release();
+}
+
+int32_t BroadcastRing::readerNumber() {
+    if (!shm_ || !lock()) {
+        return 0;
+    }
+
+    int32_t num = 0;
+    Header* h = header();
+    for (int32_t i = 0; i < (int32_t)h->maxReaders; ++i) {
+        if (slot(i)->active) {
+            num++;
+        }
+    }
+
+    unlock();
+    return num;
+}
+
+BroadcastRing::Header* BroadcastRing::header() const {
+    assert(shm_);
+    return (Header*)shm_->data();
+}
+
+BroadcastRing::Slot* BroadcastRing::slot(int32_t index) const {
+    return (Slot*)(shm_->data() + sizeof(Header)) + index;
+}
+
+uint8_t* BroadcastRing::ringData() const {
+    return shm_->data() + HeaderSize((int32_t)header()->maxReaders);
+}
+
+bool BroadcastRing::lock() {
+    assert(lock_);
+    if (!lock_ || !lock_->wait(kLockTimeout)) {
+        veigar::log("Veigar: [WARNING] Timeout while acquiring lock of broadcast ring %s.\n", name_.c_str());
+        return false;
+    }
+    return true;
+}
+
+void BroadcastRing::unlock() {
+    assert(lock_);
+    lock_->release();
+}
+}  // namespace veigar
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_BROADCAST_RING_H_
+#define VEIGAR_BROADCAST_RING_H_
+#pragma once
+
+#include <inttypes.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "veigar/config.h"
+#include "veigar/topic.h"
+#include "shared_memory.h"
+#include "semaphore.h"
+
+namespace veigar {
+// A single-writer, multi-reader ring of records in shared memory.
+//
+// Every record is written once and can be read by all attached readers, each reader has its own cursor.
+// When the ring is full, the oldest record is dropped. Readers that have not read it yet are either
+// moved past it (TopicPolicy::LAP) or make the writer wait (TopicPolicy::BLOCK).
+// A reader that has made the writer wait for more than the stall timeout without reading is lapped
+// like with TopicPolicy::LAP until it reads again, so a crashed reader can not block the writer for good.
+class BroadcastRing {
+   public:
+    BroadcastRing() noexcept = default;
+    ~BroadcastRing();
+
+    // Writer side. 'stallTimeoutMS' is only used by TopicPolicy::BLOCK.
+    bool create(const std::string& name,
+                int64_t capacity,
+                int32_t maxReaders,
+                TopicPolicy policy,
+                int64_t stallTimeoutMS = VEIGAR_TOPIC_STALL_TIMEOUT);
+
+    // Reader side, the capacity is read from the ring header.
+    bool open(const std::string& name);
+
+    void close();
+
+    // Writer only. 'timeoutMS' is how long to wait for slow readers, only used by TopicPolicy::BLOCK.
+    bool write(const void* data, int64_t size, uint32_t timeoutMS);
+
+    // Attach a reader, which only reads the records written after it has been attached.
+    // Return the reader slot, or -1 if all slots are in use.
+    int32_t attach();
+    void detach(int32_t slot);
+
+    // Copy the next record of the reader to 'buf'.
+    // 'missed' is set to the number of records the reader has been moved past since last read (TopicPolicy::LAP).
+    // Return false if there is no record to read.
+    bool read(int32_t slot, std::vector<uint8_t>& buf, uint64_t& seq, uint64_t& missed);
+
+    // Wait for the writer to signal the reader slot.
+    bool waitForRead(int32_t slot, int64_t ms);
+    void notifyRead(int32_t slot);
+
+    // The number of attached readers.
+    int32_t readerNumber();
+
+   private:
+    struct Header;
+    struct Slot;
+
+    Header* header() const;
+    Slot* slot(int32_t index) const;
+    uint8_t* ringData() const;
+
+    static int64_t HeaderSize(int32_t maxReaders);
+
+    // Drop the oldest record, the lock must be held.
+    // Return false if it is still needed by a reader that has not stalled and the policy is TopicPolicy::BLOCK.
+    bool dropOldest();
+
+    bool lock();
+    void unlock();
+
+   private:
+    bool creator_ = false;
+    std::string name_;
+    std::shared_ptr<SharedMemory> shm_;
+    std::shared_ptr<Semaphore> lock_;
+    std::vector<std::shared_ptr<Semaphore>> readSmps_;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_BROADCAST_RING_H_
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "veigar/call_context.h"
+#include "veigar/call_dispatcher.h"
+#include "time_util.h"
+
+namespace veigar {
+CallContext::CallContext(const std::string& callId,
+                         const std::string& callerChannelName,
+                         int64_t deadline,
+                         std::weak_ptr<detail::CallDispatcher> dispatcher) :
+    valid_(true),
+    callId_(callId),
+    callerChannelName_(callerChannelName),
+    deadline_(deadline),
+    dispatcher_(dispatcher) {
+}
+
+CallContext CallContext::Current() {
+    return detail::CallDispatcher::currentCallContext();
+}
+
+bool CallContext::isValid() const {
+    return valid_;
+}
+
+std::string CallContext::callId() const {
+    return callId_;
+}
+
+std::string CallContext::callerChannelName() const {
+    return callerChannelName_;
+}
+
+int64_t CallContext::deadline() const {
+    return deadline_;
+}
+
+int64_t CallContext::remainingMS() const {
+    if (deadline_ <= 0) {
+        return -1;
+    }
+
+    const int64_t remaining = deadline_ - TimeUtil::GetMonotonicTimestamp();
+    return remaining > 0 ? remaining / 1000 : 0;
+}
+
+bool CallContext::isExpired() const {
+    return deadline_ > 0 && TimeUtil::GetMonotonicTimestamp() >= deadline_;
+}
+
+bool CallContext::isCancelled() const {
+    std::shared_ptr<detail::CallDispatcher> dispatcher = dispatcher_.lock();
+    return dispatcher && dispatcher->isCancelled(callId_);
+}
+}  // namespace veigar
@@ -13,20 +13,259 @@
 #include "time_util.h"
 #include <atomic>
 #include <queue>
+#include <algorithm>
+#include <condition_variable>
 #include "message_queue.h"
+#include "worker_group.h"
+#include "work_stealing_pool.h"
+#include "call_scheduler.h"
+#include "stream_credit.h"
 #include "run_time_recorder.h"
+#include "recv_buffer_pool.h"
 
 namespace veigar {
 namespace detail {
 using detail::Response;
 
+namespace {
+// The call being dispatched on the current thread.
+thread_local const std::string* tlsCallId = nullptr;
+thread_local const std::string* tlsCallerChannelName = nullptr;
+thread_local bool tlsStreamCall = false;
+thread_local int64_t tlsDeadline = 0;
+thread_local CallDispatcher* tlsDispatcher = nullptr;
+thread_local CallScheduler::PendingCall* tlsPendingCall = nullptr;
+
+bool IsExpired(int64_t deadline) {
+    return deadline > 0 && TimeUtil::GetMonotonicTimestamp() >= deadline;
+}
+
+// The optional deadline of a call message, 0 if it has none.
+int64_t CallDeadline(veigar_msgpack::object const& msg) {
+    if (msg.type != veigar_msgpack::type::ARRAY || msg.via.array.size < 6) {
+        return 0;
+    }
+
+    const veigar_msgpack::object& deadlineObj = msg.via.array.ptr[5];
+    if (deadlineObj.type != veigar_msgpack::type::POSITIVE_INTEGER) {
+        return 0;
+    }
+    return (int64_t)deadlineObj.via.u64;
+}
+}  // namespace
+
 class CallDispatcher::Impl {
    public:
-    std::vector<std::thread> workers_;
+    // A call queue shard and the threads draining it.
+    struct Shard {
+        std::shared_ptr<MessageQueue> queue;
+        WorkerGroup drainWorkers;
+    };
+
+    void closeShards();
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    // See Veigar::setPollMode, the shards are drained by processReady instead of the drain threads.
+    bool pollMode_ = false;
+    std::mutex pollMutex_;
+    size_t pollNextShard_ = 0;
+
+    std::shared_ptr<RecvBufferPool> bufferPool_;
+    WorkStealingPool executor_;
+    CallScheduler scheduler_;
     std::atomic_bool stop_ = {false};
-    std::shared_ptr<MessageQueue> callMsgQueue_;
+
+    std::mutex streamsMutex_;
+    std::unordered_map<std::string, std::weak_ptr<StreamCredit>> streams_;  // call id -> credit
+
+    // Return false if the call must be shed, 'reason' tells why.
+    bool admitCall(CallScheduler::PendingCall& pc, std::string& reason);
+    void releaseCall(CallScheduler::PendingCall const& pc);
+
+    // The per function limits also apply to each entry of a batch, the caller limit counts the batch once.
+    bool admitBatchEntry(std::string const& funcName, std::string& reason);
+    void releaseBatchEntry(std::string const& funcName);
+
+    // Dispatches the call and releases its admission slot,
+    // unless a function bound by bindDeferred has taken it over, see CallDispatcher::makeResponder.
+    void runCall(CallDispatcher* dispatcher, CallScheduler::PendingCall& pc);
+
+    // Admission control, see CallDispatcher::setPendingCallLimit.
+    std::atomic<uint32_t> pendingLimit_ = {0};
+    std::atomic<int64_t> shedNumber_ = {0};
+
+    // The calls answered with ErrorCode::TIMEOUT without being run, since their deadline had passed.
+    std::atomic<int64_t> expiredNumber_ = {0};
+
+    // The calls cancelled by their callers, kept for VEIGAR_CANCELLED_CALL_RETENTION.
+    void markCancelled(std::string const& callId);
+    bool isCancelled(std::string const& callId, bool forget);
+
+    mutable std::mutex cancelledMutex_;
+    std::unordered_map<std::string, int64_t> cancelled_;  // call id -> monotonic time to forget it
+    std::atomic<size_t> cancelledSize_ = {0};               // checked before locking
+    int64_t nextCancelledSweep_ = 0;
+    std::atomic<int64_t> cancelledNumber_ = {0};
+
+    std::mutex admissionMutex_;
+    std::unordered_map<std::string, uint32_t> funcLimits_;
+    std::unordered_map<std::string, uint32_t> callerLimits_;
+    std::unordered_map<std::string, uint32_t> funcInFlight_;
+    std::unordered_map<std::string, uint32_t> callerInFlight_;
 };
 
+void CallDispatcher::Impl::closeShards() {
+    for (auto& shard : shards_) {
+        if (shard->queue) {
+            shard->queue->close();
+        }
+    }
+    shards_.clear();
+}
+
+bool CallDispatcher::Impl::admitCall(CallScheduler::PendingCall& pc, std::string& reason) {
+    const uint32_t pendingLimit = pendingLimit_.load();
+    if (pendingLimit > 0 && scheduler_.size() >= pendingLimit) {
+        reason = StringHelper::StringPrintf("The channel is overloaded, %u calls are pending.", pendingLimit);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(admissionMutex_);
+    const bool limited = !funcLimits_.empty() || !callerLimits_.empty();
+    if (!limited && scheduler_.fairnessPolicy() == FairnessPolicy::NONE) {
+        return true;
+    }
+
+    // flag - callId - callerChannelName - funcName - args
+    const veigar_msgpack::object& msg = pc.obj->get();
+    if (msg.type != veigar_msgpack::type::ARRAY || msg.via.array.size < 4) {
+        return true;
+    }
+
+    const veigar_msgpack::object& callerObj = msg.via.array.ptr[2];
+    const veigar_msgpack::object& funcNameObj = msg.via.array.ptr[3];
+    if (callerObj.type == veigar_msgpack::type::STR) {
+        pc.callerChannelName.assign(callerObj.via.str.ptr, callerObj.via.str.size);
+    }
+    if (funcNameObj.type == veigar_msgpack::type::STR) {
+        pc.funcName.assign(funcNameObj.via.str.ptr, funcNameObj.via.str.size);
+    }
+
+    // The names are only needed by the scheduler.
+    if (!limited) {
+        return true;
+    }
+
+    auto itFunc = funcLimits_.find(pc.funcName);
+    if (itFunc != funcLimits_.end() && funcInFlight_[pc.funcName] >= itFunc->second) {
+        reason = StringHelper::StringPrintf("Function '%s' is overloaded, %u calls are in flight.", pc.funcName.c_str(), itFunc->second);
+        return false;
+    }
+
+    auto itCaller = callerLimits_.find(pc.callerChannelName);
+    if (itCaller != callerLimits_.end() && callerInFlight_[pc.callerChannelName] >= itCaller->second) {
+        reason = StringHelper::StringPrintf("The channel is overloaded by caller '%s', %u calls are in flight.",
+                                            pc.callerChannelName.c_str(), itCaller->second);
+        return false;
+    }
+
+    funcInFlight_[pc.funcName]++;
+    callerInFlight_[pc.callerChannelName]++;
+    pc.admitted = true;
+    return true;
+}
+
+void CallDispatcher::Impl::markCancelled(std::string const& callId) {
+    const int64_t now = TimeUtil::GetMonotonicTimestamp();
+
+    std::lock_guard<std::mutex> lg(cancelledMutex_);
+    cancelled_[callId] = now + (int64_t)VEIGAR_CANCELLED_CALL_RETENTION * 1000;
+
+    if (now >= nextCancelledSweep_) {
+        nextCancelledSweep_ = now + 1000000;
+        for (auto it = cancelled_.begin(); it != cancelled_.end();) {
+            if (it->second <= now) {
+                it = cancelled_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    cancelledSize_.store(cancelled_.size());
+}
+
+bool CallDispatcher::Impl::isCancelled(std::string const& callId, bool forget) {
+    if (cancelledSize_.load() == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(cancelledMutex_);
+    auto it = cancelled_.find(callId);
+    if (it == cancelled_.end()) {
+        return false;
+    }
+
+    if (forget) {
+        cancelled_.erase(it);
+        cancelledSize_.store(cancelled_.size());
+    }
+    return true;
+}
+
+void CallDispatcher::Impl::releaseCall(CallScheduler::PendingCall const& pc) {
+    if (!pc.admitted) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lg(admissionMutex_);
+    auto itFunc = funcInFlight_.find(pc.funcName);
+    if (itFunc != funcInFlight_.end() && --itFunc->second == 0) {
+        funcInFlight_.erase(itFunc);
+    }
+
+    auto itCaller = callerInFlight_.find(pc.callerChannelName);
+    if (itCaller != callerInFlight_.end() && --itCaller->second == 0) {
+        callerInFlight_.erase(itCaller);
+    }
+}
+
+bool CallDispatcher::Impl::admitBatchEntry(std::string const& funcName, std::string& reason) {
+    std::lock_guard<std::mutex> lg(admissionMutex_);
+    auto itFunc = funcLimits_.find(funcName);
+    if (itFunc == funcLimits_.end()) {
+        return true;
+    }
+
+    uint32_t& inFlight = funcInFlight_[funcName];
+    if (inFlight >= itFunc->second) {
+        reason = StringHelper::StringPrintf("Function '%s' is overloaded, %u calls are in flight.", funcName.c_str(), itFunc->second);
+        return false;
+    }
+
+    inFlight++;
+    return true;
+}
+
+void CallDispatcher::Impl::releaseBatchEntry(std::string const& funcName) {
+    std::lock_guard<std::mutex> lg(admissionMutex_);
+    auto itFunc = funcInFlight_.find(funcName);
+    if (itFunc != funcInFlight_.end() && --itFunc->second == 0) {
+        funcInFlight_.erase(itFunc);
+    }
+}
+
+void CallDispatcher::Impl::runCall(CallDispatcher* dispatcher, CallScheduler::PendingCall& pc) {
+    assert(pc.obj);
+    tlsPendingCall = &pc;
+    dispatcher->processCall(pc.obj->get());
+    tlsPendingCall = nullptr;
+
+    releaseCall(pc);
+}
+
 CallDispatcher::CallDispatcher(Veigar* veigar) noexcept :
     veigar_(veigar),
     impl_(new Impl()) {
@@ -39,21 +278,62 @@ CallDispatcher::~CallDispatcher() noexcept {
     }
 }
 
-bool CallDispatcher::init() {
+bool CallDispatcher::init(std::shared_ptr<RecvBufferPool> bufferPool) {
     if (init_) {
         return true;
     }
 
-    impl_->callMsgQueue_ = std::make_shared<MessageQueue>(veigar_->msgQueueCapacity(), veigar_->expectedMsgMaxSize());
-    if (!impl_->callMsgQueue_->create(veigar_->channelName() + VEIGAR_CALL_QUEUE_NAME_SUFFIX)) {
-        veigar::log("Veigar: Error: Create call message queue(%s) failed.\n", veigar_->channelName().c_str());
-        return false;
+    impl_->bufferPool_ = bufferPool;
+
+    const uint32_t shardNumber = veigar_->callQueueShards();
+    impl_->pollMode_ = veigar_->pollMode();
+    impl_->pollNextShard_ = 0;
+    for (uint32_t i = 0; i < shardNumber; ++i) {
+        std::unique_ptr<Impl::Shard> shard = detail::make_unique<Impl::Shard>();
+        shard->queue = std::make_shared<MessageQueue>(veigar_->msgQueueCapacity(), veigar_->expectedMsgMaxSize(), kCallPriorityNumber);
+        shard->queue->setNumaNode(veigar_->numaNode());
+        shard->queue->setPollable(veigar_->pollMode());
+        shard->queue->setFullPolicy(veigar_->callQueueFullPolicy());
+        if (!shard->queue->create(CallQueueName(veigar_->channelName(), i))) {
+            veigar::log("Veigar: Error: Create call message queue(%s, shard %u) failed.\n", veigar_->channelName().c_str(), i);
+            impl_->closeShards();
+            return false;
+        }
+        shard->queue->setShardNumber(shardNumber);
+        shard->queue->setPriorityPolicy(veigar_->priorityPolicy());
+        impl_->shards_.push_back(std::move(shard));
     }
 
+    impl_->scheduler_.setPriorityPolicy(veigar_->priorityPolicy());
+    impl_->scheduler_.setSchedulingPolicy(veigar_->schedulingPolicy());
+    impl_->scheduler_.setFairnessPolicy(veigar_->fairnessPolicy());
+
     impl_->stop_.store(false);
 
-    for (size_t i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER; ++i) {
-        impl_->workers_.emplace_back(std::thread(&CallDispatcher::dispatchThreadProc, this));
+    const std::vector<uint32_t> cpus = veigar_->cpuAffinity(ThreadRole::CALL_DISPATCHER);
+    impl_->executor_.setPlacement("veigar-call", cpus);
+
+    // A thread-less instance runs every call from Veigar::poll, a batch is then dispatched on the polling thread only.
+    if (!veigar_->threadless() && !impl_->executor_.start(VEIGAR_DISPATCHER_MIN_THREAD_NUMBER, VEIGAR_DISPATCHER_THREAD_NUMBER)) {
+        veigar::log("Veigar: Error: Start dispatcher threads failed.\n");
+        impl_->closeShards();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < shardNumber && !impl_->pollMode_; ++i) {
+        Impl::Shard& shard = *impl_->shards_[i];
+
+        // With several shards, each one is drained on a core of its own.
+        if (shardNumber > 1 && !cpus.empty()) {
+            shard.drainWorkers.setPlacement("veigar-drain" + std::to_string(i), {cpus[i % cpus.size()]});
+        }
+        else {
+            shard.drainWorkers.setPlacement("veigar-drain", cpus);
+        }
+
+        shard.drainWorkers.start(VEIGAR_CALL_DRAIN_MIN_THREAD_NUMBER,
+                                 VEIGAR_CALL_DRAIN_THREAD_NUMBER,
+                                 std::bind(&CallDispatcher::drainThreadProc, this, i));
     }
 
     init_ = true;
@@ -72,28 +352,137 @@ void CallDispatcher::uninit() {
 
     impl_->stop_.store(true);
 
-    for (std::thread& worker : impl_->workers_) {
-        impl_->callMsgQueue_->notifyRead();
+    for (auto& shard : impl_->shards_) {
+        std::shared_ptr<MessageQueue> queue = shard->queue;
+        shard->drainWorkers.stop([queue]() { queue->notifyRead(); });
     }
 
-    for (std::thread& worker : impl_->workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    // Wake up the stream functions waiting for credits, no more credit can arrive.
+    impl_->streamsMutex_.lock();
+    for (auto& it : impl_->streams_) {
+        std::shared_ptr<StreamCredit> credit = it.second.lock();
+        if (credit) {
+            credit->cancel();
         }
     }
+    impl_->streams_.clear();
+    impl_->streamsMutex_.unlock();
 
-    if (impl_->callMsgQueue_) {
-        impl_->callMsgQueue_->close();
-        impl_->callMsgQueue_.reset();
-    }
+    impl_->executor_.stop();
+    impl_->scheduler_.clear();
+
+    impl_->admissionMutex_.lock();
+    impl_->funcInFlight_.clear();
+    impl_->callerInFlight_.clear();
+    impl_->admissionMutex_.unlock();
+
+    impl_->cancelledMutex_.lock();
+    impl_->cancelled_.clear();
+    impl_->cancelledSize_.store(0);
+    impl_->cancelledMutex_.unlock();
+
+    impl_->closeShards();
+    impl_->bufferPool_.reset();
 
     funcs_.clear();
+    priorities_.clear();
+    streamFuncs_.clear();
+    deferredFuncs_.clear();
 
     init_ = false;
 }
 
-std::shared_ptr<veigar::MessageQueue> CallDispatcher::messageQueue() {
-    return impl_->callMsgQueue_;
+std::vector<std::shared_ptr<MessageQueue>> CallDispatcher::messageQueues() {
+    std::vector<std::shared_ptr<MessageQueue>> queues;
+    for (auto& shard : impl_->shards_) {
+        queues.push_back(shard->queue);
+    }
+    return queues;
+}
+
+std::vector<PollHandle> CallDispatcher::pollHandles() const {
+    std::vector<PollHandle> handles;
+    if (impl_->pollMode_) {
+        for (auto& shard : impl_->shards_) {
+            handles.push_back(shard->queue->pollHandle());
+        }
+    }
+    return handles;
+}
+
+std::string CallDispatcher::CallQueueName(std::string const& channelName, uint32_t shard) {
+    if (shard == 0) {
+        return channelName + VEIGAR_CALL_QUEUE_NAME_SUFFIX;
+    }
+    return channelName + VEIGAR_CALL_QUEUE_NAME_SUFFIX + "_" + std::to_string(shard);
+}
+
+void CallDispatcher::collectStatistics(Statistics& stats) const {
+    ThreadStatistics& ts = stats.threads[(uint32_t)ThreadRole::CALL_DISPATCHER];
+    ts.threadNumber = impl_->executor_.threadNumber();
+    ts.busyThreadNumber = impl_->executor_.busyThreadNumber();
+    ts.pinFailedThreadNumber = impl_->executor_.pinFailedThreadNumber();
+    ts.cpus.clear();
+    for (auto& shard : impl_->shards_) {
+        ts.threadNumber += shard->drainWorkers.size();
+        ts.busyThreadNumber += shard->drainWorkers.busy();
+        ts.pinFailedThreadNumber += shard->drainWorkers.pinFailed();
+        for (uint32_t cpu : shard->drainWorkers.cpus()) {
+            if (std::find(ts.cpus.begin(), ts.cpus.end(), cpu) == ts.cpus.end()) {
+                ts.cpus.push_back(cpu);
+            }
+        }
+    }
+
+    stats.pendingCallNumber = (int64_t)impl_->scheduler_.size();
+    stats.shedCallNumber = impl_->shedNumber_.load();
+    stats.expiredCallNumber = impl_->expiredNumber_.load();
+    stats.cancelledCallNumber = impl_->cancelledNumber_.load();
+
+    if (!impl_->shards_.empty()) {
+        stats.callQueue.memorySize = 0;
+        for (auto& shard : impl_->shards_) {
+            stats.callQueue.memorySize += shard->queue->memorySize();
+
+            if (shard->queue->processRWLock(veigar_->timeoutOfRWLock())) {
+                const MessageQueue::FullCounters counters = shard->queue->fullCounters();
+                shard->queue->processRWUnlock();
+                stats.callQueue.droppedNumber += counters.droppedNumber;
+                stats.callQueue.rejectedNumber += counters.rejectedNumber;
+                stats.callQueue.blockedNumber += counters.blockedNumber;
+            }
+        }
+        stats.callQueue.numaNode = impl_->shards_[0]->queue->numaNode();
+        stats.callQueue.shardNumber = (uint32_t)impl_->shards_.size();
+    }
+}
+
+void CallDispatcher::setPendingCallLimit(uint32_t maxPending) {
+    impl_->pendingLimit_.store(maxPending);
+}
+
+void CallDispatcher::setFunctionCallLimit(std::string const& name, uint32_t maxInFlight) {
+    std::lock_guard<std::mutex> lg(impl_->admissionMutex_);
+    if (maxInFlight == 0) {
+        impl_->funcLimits_.erase(name);
+    }
+    else {
+        impl_->funcLimits_[name] = maxInFlight;
+    }
+}
+
+void CallDispatcher::setCallerCallLimit(std::string const& callerChannelName, uint32_t maxInFlight) {
+    std::lock_guard<std::mutex> lg(impl_->admissionMutex_);
+    if (maxInFlight == 0) {
+        impl_->callerLimits_.erase(callerChannelName);
+    }
+    else {
+        impl_->callerLimits_[callerChannelName] = maxInFlight;
+    }
+}
+
+void CallDispatcher::setCallerWeight(std::string const& callerChannelName, uint32_t weight) {
+    impl_->scheduler_.setCallerWeight(callerChannelName, weight);
 }
 
 void CallDispatcher::unbind(std::string const& name) {
@@ -101,11 +490,15 @@ void CallDispatcher::unbind(std::string const& name) {
     if (it != funcs_.end()) {
         funcs_.erase(it);
     }
+
+    priorities_.erase(name);
+    streamFuncs_.erase(name);
+    deferredFuncs_.erase(name);
 }
 
 Response CallDispatcher::dispatch(veigar_msgpack::object const& msg, std::string& callerChannelName) {
-    // Quickly check
-    if (msg.via.array.size != 5) {
+    // Quickly check, the deadline is optional.
+    if (msg.via.array.size != 5 && msg.via.array.size != 6) {
         return Response::MakeEmptyResponse();
     }
 
@@ -126,17 +519,40 @@ Response CallDispatcher::dispatchCall(veigar_msgpack::object const& msg, std::st
 
     // proper validation of protocol (and responding to it)
     auto&& type = std::get<0>(the_call);
-    assert(type == 0);
+    assert(type == 0 || type == 2 || type == 3 || type == 5);
 
     auto&& callId = std::get<1>(the_call);
 
-    if (type != 0) {
+    if (type != 0 && type != 2 && type != 3 && type != 5) {
         return Response::MakeResponseWithError(callId, std::string("Invalid message flag."));
     }
 
     callerChannelName = std::get<2>(the_call);
     auto&& funcName = std::get<3>(the_call);
     auto&& args = std::get<4>(the_call);
+    const int64_t deadline = std::get<5>(the_call);
+
+    if (type == 2) {
+        dispatchNotification(callId, funcName, args);
+        return Response::MakeEmptyResponse();
+    }
+
+    // The caller has given up, the work would be wasted.
+    if (IsExpired(deadline)) {
+        impl_->expiredNumber_++;
+        return Response::MakeResponseWithError(
+            callId, std::make_tuple((int32_t)ErrorCode::TIMEOUT, StringHelper::StringPrintf("Function '%s' was not run, the call expired.", funcName.c_str())));
+    }
+
+    // The caller has already completed the call, no response is expected.
+    if (impl_->isCancelled(callId, true)) {
+        impl_->cancelledNumber_++;
+        return Response::MakeEmptyResponse();
+    }
+
+    if (type == 5) {
+        return dispatchBatch(callId, callerChannelName, deadline, args);
+    }
 
     std::unordered_map<std::string, AdaptorType>::const_iterator itFunc = funcs_.find(funcName);
     if (itFunc == funcs_.cend()) {
@@ -145,16 +561,50 @@ Response CallDispatcher::dispatchCall(veigar_msgpack::object const& msg, std::st
             StringHelper::StringPrintf("Could not find function '%s' with argument count %d.", funcName.c_str(), args.via.array.size));
     }
 
+    const bool isStreamFunc = streamFuncs_.find(funcName) != streamFuncs_.cend();
+    if (isStreamFunc != (type == 3)) {
+        return Response::MakeResponseWithError(
+            callId,
+            StringHelper::StringPrintf(isStreamFunc ? "Function '%s' is a stream function, it must be called by streamCall."
+                                                    : "Function '%s' is not a stream function.",
+                                       funcName.c_str()));
+    }
+
     try {
+        tlsCallId = &callId;
+        tlsCallerChannelName = &callerChannelName;
+        tlsStreamCall = isStreamFunc;
+        tlsDeadline = deadline;
+        tlsDispatcher = this;
         auto result = (itFunc->second)(args);
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsStreamCall = false;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
+
+        if (!result) {
+            // The functor has been bound by bindDeferred or bindStream and will respond later.
+            return Response::MakeEmptyResponse();
+        }
         return Response::MakeResponseWithResult(callId, std::move(result));
     } catch (std::exception& e) {
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsStreamCall = false;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
         return Response::MakeResponseWithError(
             callId,
             StringHelper::StringPrintf("Function '%s' (called with %d arg(s)) threw an exception. "
                                        "The exception contained this information: %s.",
                                        funcName.c_str(), args.via.array.size, e.what()));
     } catch (...) {
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsStreamCall = false;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
         return Response::MakeResponseWithError(
             callId,
             StringHelper::StringPrintf("Function '%s' (called with %d arg(s)) threw an exception. "
@@ -163,112 +613,617 @@ Response CallDispatcher::dispatchCall(veigar_msgpack::object const& msg, std::st
     }
 }
 
-void CallDispatcher::dispatchThreadProc() {
-    veigar_msgpack::unpacker callPac;
+Response CallDispatcher::dispatchBatch(std::string const& callId,
+                                       std::string const& callerChannelName,
+                                       int64_t deadline,
+                                       veigar_msgpack::object const& args) {
+    // parallel - [[funcName, args], ...]
+    bool parallel = false;
+    veigar_msgpack::object entries;
+    try {
+        std::tuple<bool, veigar_msgpack::object> batch;
+        args.convert(batch);
+        parallel = std::get<0>(batch);
+        entries = std::get<1>(batch);
+    } catch (std::exception&) {
+        return Response::MakeResponseWithError(callId, std::string("Invalid batch message."));
+    }
+
+    if (entries.type != veigar_msgpack::type::ARRAY) {
+        return Response::MakeResponseWithError(callId, std::string("Invalid batch message."));
+    }
+
+    const size_t n = entries.via.array.size;
+    std::vector<Response> responses(n);
+
+    if (!parallel || n < 2) {
+        for (size_t i = 0; i < n; i++) {
+            responses[i] = dispatchBatchEntry(callId, callerChannelName, deadline, entries.via.array.ptr[i]);
+        }
+    }
+    else {
+        // Fork-join: the entries are claimed one by one by this thread and by the helper tasks,
+        // this thread never waits for an entry that no thread has claimed, so it can not starve the pool.
+        struct Join {
+            std::atomic<size_t> next = {0};
+            std::atomic<size_t> done = {0};
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+        std::shared_ptr<Join> join = std::make_shared<Join>();
+
+        std::function<void()> work = [this, join, n, &responses, &entries, &callId, &callerChannelName, deadline]() {
+            size_t i = 0;
+            while ((i = join->next.fetch_add(1)) < n) {
+                responses[i] = dispatchBatchEntry(callId, callerChannelName, deadline, entries.via.array.ptr[i]);
+                if (join->done.fetch_add(1) + 1 == n) {
+                    std::lock_guard<std::mutex> lg(join->mutex);
+                    join->cv.notify_all();
+                }
+            }
+        };
+
+        const size_t helperNum = std::min(n - 1, (size_t)VEIGAR_DISPATCHER_THREAD_NUMBER - 1);
+        for (size_t i = 0; i < helperNum; i++) {
+            if (!impl_->executor_.submit(work)) {
+                break;
+            }
+        }
+
+        work();
+
+        std::unique_lock<std::mutex> ul(join->mutex);
+        join->cv.wait(ul, [join, n]() { return join->done.load() == n; });
+    }
+
+    // error - result of each entry.
+    std::vector<std::tuple<veigar_msgpack::object, veigar_msgpack::object>> results;
+    results.reserve(n);
+    for (const Response& resp : responses) {
+        std::shared_ptr<veigar_msgpack::object_handle> err = resp.getError();
+        std::shared_ptr<veigar_msgpack::object_handle> ret = resp.getResult();
+        results.emplace_back(err ? err->get() : veigar_msgpack::object(), ret ? ret->get() : veigar_msgpack::object());
+    }
+
+    return Response::MakeResponseWithResult(callId, results);
+}
+
+Response CallDispatcher::dispatchBatchEntry(std::string const& callId,
+                                            std::string const& callerChannelName,
+                                            int64_t deadline,
+                                            veigar_msgpack::object const& entry) {
+    std::string funcName;
+    veigar_msgpack::object args;
     try {
-        callPac.reserve_buffer(veigar_->expectedMsgMaxSize());
-    } catch (std::bad_alloc& e) {
-        veigar::log("Veigar: [ERROR] Failed to allocate memory for call buffer (%u bytes): %s.\n", veigar_->expectedMsgMaxSize(), e.what());
+        std::tuple<std::string, veigar_msgpack::object> e;
+        entry.convert(e);
+        funcName = std::get<0>(e);
+        args = std::get<1>(e);
+    } catch (std::exception&) {
+        return Response::MakeResponseWithError(callId, std::string("Invalid batch entry."));
+    }
+
+    std::unordered_map<std::string, AdaptorType>::const_iterator itFunc = funcs_.find(funcName);
+    if (itFunc == funcs_.cend()) {
+        return Response::MakeResponseWithError(
+            callId,
+            StringHelper::StringPrintf("Could not find function '%s' with argument count %d.", funcName.c_str(), args.via.array.size));
+    }
+
+    if (streamFuncs_.find(funcName) != streamFuncs_.cend() || deferredFuncs_.find(funcName) != deferredFuncs_.cend()) {
+        return Response::MakeResponseWithError(
+            callId,
+            StringHelper::StringPrintf("Function '%s' responds later, it can not be called in a batch.", funcName.c_str()));
+    }
+
+    // The remaining entries of a batch that ran past its deadline, or has been cancelled, are skipped.
+    // Like a call that is not run, these entries carry [error code, message].
+    if (IsExpired(deadline)) {
+        return Response::MakeResponseWithError(
+            callId, std::make_tuple((int32_t)ErrorCode::TIMEOUT, StringHelper::StringPrintf("Function '%s' was not run, the call expired.", funcName.c_str())));
+    }
+
+    if (impl_->isCancelled(callId, false)) {
+        return Response::MakeResponseWithError(
+            callId, std::make_tuple((int32_t)ErrorCode::CANCELLED, StringHelper::StringPrintf("Function '%s' was not run, the call has been cancelled.", funcName.c_str())));
+    }
+
+    std::string reason;
+    if (!impl_->admitBatchEntry(funcName, reason)) {
+        impl_->shedNumber_++;
+        return Response::MakeResponseWithError(callId, std::make_tuple((int32_t)ErrorCode::OVERLOADED, reason));
+    }
+
+    try {
+        tlsCallId = &callId;
+        tlsCallerChannelName = &callerChannelName;
+        tlsDeadline = deadline;
+        tlsDispatcher = this;
+        auto result = (itFunc->second)(args);
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
+        impl_->releaseBatchEntry(funcName);
+        if (!result) {
+            result = detail::make_unique<veigar_msgpack::object_handle>();
+        }
+        return Response::MakeResponseWithResult(callId, std::move(result));
+    } catch (std::exception& e) {
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
+        impl_->releaseBatchEntry(funcName);
+        return Response::MakeResponseWithError(
+            callId,
+            StringHelper::StringPrintf("Function '%s' (called with %d arg(s)) threw an exception. "
+                                       "The exception contained this information: %s.",
+                                       funcName.c_str(), args.via.array.size, e.what()));
+    } catch (...) {
+        tlsCallId = nullptr;
+        tlsCallerChannelName = nullptr;
+        tlsDeadline = 0;
+        tlsDispatcher = nullptr;
+        impl_->releaseBatchEntry(funcName);
+        return Response::MakeResponseWithError(
+            callId,
+            StringHelper::StringPrintf("Function '%s' (called with %d arg(s)) threw an exception. "
+                                       "The exception is not derived from std::exception. No further information available.",
+                                       funcName.c_str(), args.via.array.size));
+    }
+}
+
+void CallDispatcher::dispatchNotification(std::string const& callId, std::string const& funcName, veigar_msgpack::object const& args) {
+    std::unordered_map<std::string, AdaptorType>::const_iterator itFunc = funcs_.find(funcName);
+    if (itFunc == funcs_.cend()) {
+        veigar::log("Veigar: [WARNING] Could not find function '%s' of notification.\n", funcName.c_str());
         return;
     }
 
-    int64_t written = 0L;
+    if (streamFuncs_.find(funcName) != streamFuncs_.cend()) {
+        veigar::log("Veigar: [WARNING] Stream function '%s' can not be called by notification.\n", funcName.c_str());
+        return;
+    }
+
+    try {
+        // No responder can respond to a notification.
+        tlsCallId = &callId;
+        tlsCallerChannelName = nullptr;
+        (itFunc->second)(args);
+        tlsCallId = nullptr;
+    } catch (std::exception& e) {
+        tlsCallId = nullptr;
+        veigar::log("Veigar: [WARNING] Function '%s' threw an exception on notification: %s.\n", funcName.c_str(), e.what());
+    } catch (...) {
+        tlsCallId = nullptr;
+        veigar::log("Veigar: [WARNING] Function '%s' threw an exception on notification.\n", funcName.c_str());
+    }
+}
+
+void CallDispatcher::drainThreadProc(uint32_t shard) {
+    Impl::Shard& self = *impl_->shards_[shard];
+
+    std::vector<veigar_msgpack::object_handle> objs;
+    uint32_t lane = 0;
+    int64_t backlog = 0;
     while (!impl_->stop_.load()) {
-        written = 0L;
-        if (!impl_->callMsgQueue_->waitForRead(-1))
+        if (!self.queue->waitForRead(VEIGAR_WORKER_IDLE_TIMEOUT)) {
+            impl_->bufferPool_->trim();
+            if (self.drainWorkers.retire())
+                break;
             continue;
+        }
 
         if (impl_->stop_.load())
             break;
 
-        if (!impl_->callMsgQueue_->processRWLock(veigar_->timeoutOfRWLock())) {
-            veigar::log("Veigar: [WARNING] Timeout while acquiring read-write lock for call queue.\n");
+        if (!popCall(*self.queue, objs, lane, backlog, true)) {
             continue;
         }
 
-        const int64_t msgNum = impl_->callMsgQueue_->msgNumber();
-        if (msgNum <= 0) {
-            if (msgNum < 0) {
-                veigar::log("Veigar: [ERROR] Failed to query message count from call queue.\n");
-            }
-            else {
-                veigar::log("Veigar: [WARNING] Received read signal for empty call queue.\n");
-            }
-            impl_->callMsgQueue_->processRWUnlock();
+        self.drainWorkers.enterBusy();
+        self.drainWorkers.grow(backlog);
+
+        acceptCalls(objs, lane, false);
+
+        self.drainWorkers.leaveBusy();
+    }
+}
+
+bool CallDispatcher::popCall(MessageQueue& queue, std::vector<veigar_msgpack::object_handle>& objs, uint32_t& lane, int64_t& backlog, bool signaled) {
+    int64_t written = 0L;
+    if (!queue.processRWLock(veigar_->timeoutOfRWLock())) {
+        veigar::log("Veigar: [WARNING] Timeout while acquiring read-write lock for call queue.\n");
+        return false;
+    }
+
+    const int64_t msgNum = queue.msgNumber();
+    if (msgNum <= 0) {
+        if (msgNum < 0) {
+            veigar::log("Veigar: [ERROR] Failed to query message count from call queue.\n");
+        }
+        else if (signaled) {
+            veigar::log("Veigar: [WARNING] Received read signal for empty call queue.\n");
+        }
+        queue.processRWUnlock();
+        return false;
+    }
+
+    // Only asks for the size of the front message, so that the buffer fits it.
+    queue.popFront(nullptr, 0, written, &lane);
+    if (written <= 0) {
+        veigar::log("Veigar: [ERROR] Failed to retrieve message from call queue.\n");
+        queue.processRWUnlock();
+        return false;
+    }
+
+    RecvBufferPool::BufferPtr buffer = impl_->bufferPool_->acquire((size_t)written);
+    if (!buffer) {
+        veigar::log("Veigar: [ERROR] Failed to allocate memory for call buffer (%" PRId64 " bytes).\n", written);
+        queue.processRWUnlock();
+        return false;
+    }
+
+    if (!queue.popFront(buffer->data(), (int64_t)buffer->capacity(), written, &lane)) {
+        veigar::log("Veigar: [ERROR] Failed to retrieve message from call queue.\n");
+        queue.processRWUnlock();
+        return false;
+    }
+
+    // The depth remaining in the queue header decides whether another worker is needed.
+    backlog = queue.msgNumber();
+
+    queue.processRWUnlock();
+
+    objs.clear();
+    try {
+        RecvBufferPool::Unpack(buffer, (size_t)written, objs);
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Exception occurred while parsing call data: %s.\n", e.what());
+    } catch (...) {
+        veigar::log(
+            "Veigar: [ERROR] Unknown exception occurred while parsing call data. Exception type not derived from std::exception.\n");
+    }
+    return true;
+}
+
+void CallDispatcher::acceptCalls(std::vector<veigar_msgpack::object_handle>& objs, uint32_t lane, bool polled) {
+    for (veigar_msgpack::object_handle& obj : objs) {
+        if (handleStreamCredit(obj.get()) || handleCancel(obj.get())) {
             continue;
         }
 
-        if (!impl_->callMsgQueue_->popFront(callPac.buffer(), callPac.buffer_capacity(), written)) {
-            if (written <= 0) {
-                veigar::log("Veigar: [ERROR] Failed to retrieve message from call queue.\n");
-                impl_->callMsgQueue_->processRWUnlock();
-                continue;
-            }
+        CallScheduler::PendingCall pc;
+        pc.priority = callPriority(obj.get(), lane);
+        pc.deadline = CallDeadline(obj.get());
+        pc.obj = std::make_shared<veigar_msgpack::object_handle>(std::move(obj));
 
-            try {
-                callPac.reserve_buffer((size_t)written);
-            } catch (std::bad_alloc& e) {
-                veigar::log("Veigar: [ERROR] Failed to allocate memory for call buffer (%u bytes): %s.\n", written, e.what());
-                impl_->callMsgQueue_->processRWUnlock();
-                continue;
-            }
+        // Shed the call before it is queued, so that the caller can retry elsewhere right away.
+        std::string reason;
+        if (!impl_->admitCall(pc, reason)) {
+            impl_->shedNumber_++;
+            rejectCall(pc.obj->get(), ErrorCode::OVERLOADED, reason);
+            continue;
+        }
+
+        if (polled) {
+            // A stream function waits for credits, which only arrive through processReady, so it can not run there.
+            const veigar_msgpack::object& msg = pc.obj->get();
+            if (msg.via.array.size > 0 && msg.via.array.ptr[0].type == veigar_msgpack::type::POSITIVE_INTEGER && msg.via.array.ptr[0].via.u64 == 3) {
+                if (veigar_->threadless()) {
+                    rejectCall(msg, ErrorCode::FAILED, "Stream functions are not supported by a thread-less instance.");
+                    impl_->releaseCall(pc);
+                    continue;
+                }
 
-            if (!impl_->callMsgQueue_->popFront(callPac.buffer(), callPac.buffer_capacity(), written)) {
-                veigar::log("Veigar: [ERROR] Failed to retrieve message from call queue.\n");
-                impl_->callMsgQueue_->processRWUnlock();
+                if (!impl_->executor_.submit([this, pc]() mutable { impl_->runCall(this, pc); })) {
+                    veigar::log("Veigar: [ERROR] Failed to hand over stream call to dispatcher threads.\n");
+                    rejectCall(msg, ErrorCode::FAILED, "Failed to hand over stream call to dispatcher threads.");
+                    impl_->releaseCall(pc);
+                }
                 continue;
             }
+
+            // Run by processReady once the message has been unpacked.
+            impl_->scheduler_.push(pc);
+            continue;
+        }
+
+        impl_->scheduler_.push(pc);
+
+        // Each task dispatches the most urgent pending call at the time it runs,
+        // which is not necessarily the call pushed above.
+        if (!impl_->executor_.submit(std::bind(&CallDispatcher::processNextCall, this))) {
+            veigar::log("Veigar: [ERROR] Failed to hand over call to dispatcher threads.\n");
+        }
+    }
+    objs.clear();
+}
+
+uint32_t CallDispatcher::processReady(uint32_t maxMessages) {
+    if (!init_ || !impl_->pollMode_) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lg(impl_->pollMutex_);
+
+    std::vector<veigar_msgpack::object_handle> objs;
+    uint32_t processed = 0;
+    const size_t shardNumber = impl_->shards_.size();
+    for (size_t n = 0; n < shardNumber; ++n) {
+        // Leaves the wakeups of the shards not visited, so that their poll handles stay ready.
+        if (maxMessages > 0 && processed >= maxMessages) {
+            break;
         }
 
-        callPac.buffer_consumed((size_t)written);
+        // Starts from a different shard each time, so that a limited 'maxMessages' does not starve the last ones.
+        MessageQueue& queue = *impl_->shards_[impl_->pollNextShard_]->queue;
+        impl_->pollNextShard_ = (impl_->pollNextShard_ + 1) % shardNumber;
 
-        impl_->callMsgQueue_->processRWUnlock();
+        // Before popping, a message pushed afterwards wakes up the poll handle again.
+        queue.clearReady();
 
-        do {
-            veigar_msgpack::object_handle obj;
-            bool nextRet = false;
-            try {
-                nextRet = callPac.next(obj);
-            } catch (std::exception& e) {
-                veigar::log("Veigar: [ERROR] Exception occurred while parsing call data: %s.\n", e.what());
-                nextRet = false;
-            } catch (...) {
-                veigar::log(
-                    "Veigar: [ERROR] Unknown exception occurred while parsing call data. Exception type not derived from std::exception.\n");
-                nextRet = false;
+        uint32_t lane = 0;
+        int64_t backlog = 0;
+        while (maxMessages == 0 || processed < maxMessages) {
+            if (!popCall(queue, objs, lane, backlog, false)) {
+                backlog = 0;
+                break;
+            }
+            processed++;
+
+            acceptCalls(objs, lane, true);
+
+            CallScheduler::PendingCall pc;
+            while (impl_->scheduler_.pop(pc)) {
+                impl_->runCall(this, pc);
             }
 
-            if (!nextRet) {
+            if (backlog == 0) {
                 break;
             }
+        }
 
-            try {
-                auto msg = obj.get();
+        // Not all messages were taken, the poll handle has to stay ready.
+        if (backlog > 0) {
+            queue.notifyRead();
+        }
+    }
 
-                std::string callerChannelName;
-                Response resp = dispatch(msg, callerChannelName);
-                if (callerChannelName.empty()) {
-                    veigar::log("Veigar: [WARNING] Failed to parse caller's channel name.\n");
-                    continue;
-                }
+    return processed;
+}
 
-                veigar_msgpack::sbuffer respBuf = resp.getData();
-                if (respBuf.size() == 0) {
-                    veigar::log("Veigar: [WARNING] Response data is empty.\n");
-                    continue;
-                }
+void CallDispatcher::processNextCall() {
+    CallScheduler::PendingCall pc;
+    if (!impl_->scheduler_.pop(pc)) {
+        return;
+    }
 
-                std::string errMsg;
-                if (!veigar_->sendResponse(callerChannelName, (const uint8_t*)respBuf.data(), respBuf.size(), errMsg)) {
-                    veigar::log("Veigar: [ERROR] Failed to send response to caller (%s): %s.\n",
-                                callerChannelName.c_str(), errMsg.c_str());
-                }
-            } catch (std::exception& e) {
-                veigar::log("Veigar: [ERROR] Exception occurred while processing call: %s.\n", e.what());
+    impl_->runCall(this, pc);
+}
+
+void CallDispatcher::rejectCall(veigar_msgpack::object const& msg, ErrorCode ec, std::string const& reason) {
+    // flag - callId - callerChannelName - funcName - args
+    try {
+        const int8_t flag = msg.via.array.ptr[0].as<int8_t>();
+        const std::string callId = msg.via.array.ptr[1].as<std::string>();
+        if (flag == 2) {
+            veigar::log("Veigar: [WARNING] Notification %s has been shed: %s\n", callId.c_str(), reason.c_str());
+            return;
+        }
+
+        const std::string callerChannelName = msg.via.array.ptr[2].as<std::string>();
+        sendResponse(callerChannelName, Response::MakeResponseWithError(callId, std::make_tuple((int32_t)ec, reason)));
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to reject call: %s.\n", e.what());
+    }
+}
+
+void CallDispatcher::processCall(veigar_msgpack::object const& msg) {
+    try {
+        std::string callerChannelName;
+        Response resp = dispatch(msg, callerChannelName);
+        if (callerChannelName.empty()) {
+            veigar::log("Veigar: [WARNING] Failed to parse caller's channel name.\n");
+            return;
+        }
+
+        sendResponse(callerChannelName, resp);
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Exception occurred while processing call: %s.\n", e.what());
+    }
+}
+
+bool CallDispatcher::sendResponse(std::string const& callerChannelName, Response const& resp) {
+    if (resp.isEmpty()) {
+        return false;
+    }
+
+    if (!init_) {
+        veigar::log("Veigar: [WARNING] Discard response of call %s, the channel has been uninitialized.\n", resp.getCallId().c_str());
+        return false;
+    }
+
+    return sendData(callerChannelName, resp.getData());
+}
+
+bool CallDispatcher::sendData(std::string const& callerChannelName, veigar_msgpack::sbuffer const& data) {
+    if (data.size() == 0) {
+        veigar::log("Veigar: [WARNING] Response data is empty.\n");
+        return false;
+    }
+
+    if (!init_) {
+        return false;
+    }
+
+    std::string errMsg;
+    if (!veigar_->sendResponse(callerChannelName, (const uint8_t*)data.data(), data.size(), errMsg)) {
+        veigar::log("Veigar: [ERROR] Failed to send response to caller (%s): %s.\n",
+                    callerChannelName.c_str(), errMsg.c_str());
+        return false;
+    }
+    return true;
+}
+
+CallContext CallDispatcher::currentCallContext() {
+    if (!tlsCallId) {
+        return CallContext();
+    }
+
+    std::weak_ptr<CallDispatcher> dispatcher;
+    if (tlsDispatcher) {
+        dispatcher = tlsDispatcher->shared_from_this();
+    }
+
+    return CallContext(*tlsCallId, tlsCallerChannelName ? *tlsCallerChannelName : std::string(), tlsDeadline, dispatcher);
+}
+
+Responder CallDispatcher::makeResponder() {
+    assert(tlsCallId);
+    if (!tlsCallerChannelName) {
+        // Notification, the responder is created as already responded.
+        return Responder::Create(tlsCallId ? *tlsCallId : std::string(), std::string(), std::weak_ptr<CallDispatcher>(), true, takeAdmissionSlot());
+    }
+
+    return Responder::Create(tlsCallId ? *tlsCallId : std::string(),
+                             *tlsCallerChannelName,
+                             shared_from_this(),
+                             false,
+                             takeAdmissionSlot());
+}
+
+std::function<void()> CallDispatcher::takeAdmissionSlot() {
+    if (!tlsPendingCall || !tlsPendingCall->admitted) {
+        return nullptr;
+    }
+
+    // The slot is released by the responder instead of runCall.
+    CallScheduler::PendingCall slot = *tlsPendingCall;
+    slot.obj.reset();
+    tlsPendingCall->admitted = false;
+
+    std::weak_ptr<CallDispatcher> weak = shared_from_this();
+    return [weak, slot]() {
+        std::shared_ptr<CallDispatcher> dispatcher = weak.lock();
+        if (dispatcher) {
+            dispatcher->impl_->releaseCall(slot);
+        }
+    };
+}
+
+StreamWriter CallDispatcher::makeStreamWriter() {
+    assert(tlsCallId && tlsCallerChannelName && tlsStreamCall);
+    const std::string callId = tlsCallId ? *tlsCallId : std::string();
+    std::shared_ptr<StreamCredit> credit = std::make_shared<StreamCredit>(VEIGAR_STREAM_WINDOW);
+
+    impl_->streamsMutex_.lock();
+    impl_->streams_[callId] = credit;
+    impl_->streamsMutex_.unlock();
+
+    return StreamWriter::Create(callId,
+                                tlsCallerChannelName ? *tlsCallerChannelName : std::string(),
+                                shared_from_this(),
+                                credit);
+}
+
+bool CallDispatcher::handleStreamCredit(veigar_msgpack::object const& msg) {
+    // flag(4) - callId - callerChannelName - funcName - credit
+    if (msg.type != veigar_msgpack::type::ARRAY || msg.via.array.size != 5) {
+        return false;
+    }
+
+    const veigar_msgpack::object& flagObj = msg.via.array.ptr[0];
+    if (flagObj.type != veigar_msgpack::type::POSITIVE_INTEGER || flagObj.via.u64 != 4) {
+        return false;
+    }
+
+    try {
+        const std::string callId = msg.via.array.ptr[1].as<std::string>();
+        const int64_t credit = msg.via.array.ptr[4].as<int64_t>();
+
+        std::shared_ptr<StreamCredit> streamCredit;
+        impl_->streamsMutex_.lock();
+        auto it = impl_->streams_.find(callId);
+        if (it != impl_->streams_.end()) {
+            streamCredit = it->second.lock();
+        }
+        impl_->streamsMutex_.unlock();
+
+        if (streamCredit) {
+            if (credit < 0) {
+                streamCredit->cancel();
             }
+            else {
+                streamCredit->grant(credit);
+            }
+        }
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to parse stream credit: %s.\n", e.what());
+    }
+
+    return true;
+}
+
+bool CallDispatcher::handleCancel(veigar_msgpack::object const& msg) {
+    // flag(6) - callId - callerChannelName - funcName - nil
+    if (msg.type != veigar_msgpack::type::ARRAY || msg.via.array.size != 5) {
+        return false;
+    }
+
+    const veigar_msgpack::object& flagObj = msg.via.array.ptr[0];
+    if (flagObj.type != veigar_msgpack::type::POSITIVE_INTEGER || flagObj.via.u64 != 6) {
+        return false;
+    }
 
-        } while (true);
+    try {
+        const std::string callId = msg.via.array.ptr[1].as<std::string>();
+        impl_->markCancelled(callId);
+
+        // A stream stops at the next item.
+        std::shared_ptr<StreamCredit> streamCredit;
+        impl_->streamsMutex_.lock();
+        auto it = impl_->streams_.find(callId);
+        if (it != impl_->streams_.end()) {
+            streamCredit = it->second.lock();
+        }
+        impl_->streamsMutex_.unlock();
+
+        if (streamCredit) {
+            streamCredit->cancel();
+        }
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to parse cancel: %s.\n", e.what());
     }
+
+    return true;
+}
+
+bool CallDispatcher::isCancelled(std::string const& callId) const {
+    return impl_->isCancelled(callId, false);
+}
+
+void CallDispatcher::removeStream(std::string const& callId) {
+    std::lock_guard<std::mutex> lg(impl_->streamsMutex_);
+    impl_->streams_.erase(callId);
+}
+
+uint32_t CallDispatcher::callPriority(veigar_msgpack::object const& msg, uint32_t lanePriority) const {
+    uint32_t priority = lanePriority;
+
+    // flag - callId - callerChannelName - funcName - args
+    if (msg.type == veigar_msgpack::type::ARRAY && msg.via.array.size >= 4) {
+        const veigar_msgpack::object& funcNameObj = msg.via.array.ptr[3];
+        if (funcNameObj.type == veigar_msgpack::type::STR) {
+            auto it = priorities_.find(std::string(funcNameObj.via.str.ptr, funcNameObj.via.str.size));
+            if (it != priorities_.cend() && (uint32_t)it->second > priority) {
+                priority = (uint32_t)it->second;
+            }
+        }
+    }
+
+    return priority < kCallPriorityNumber ? priority : (uint32_t)CallPriority::NORMAL;
 }
 
 bool CallDispatcher::isFuncNameExist(std::string const& func) {
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "veigar/call_future.h"
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cassert>
+
+namespace veigar {
+namespace {
+void CopyResult(CallResult& dst, const CallResult& src) {
+    dst.errCode = src.errCode;
+    dst.errorMessage = src.errorMessage;
+    dst.obj = veigar_msgpack::clone(src.obj.get());
+}
+
+void CompleteWithError(const std::function<void(const CallResult&)>& complete, const std::string& errorMessage) {
+    CallResult ret;
+    ret.errCode = ErrorCode::FAILED;
+    ret.errorMessage = errorMessage;
+    complete(ret);
+}
+}  // namespace
+
+class CallFuture::State {
+   public:
+    // Only the first completion counts.
+    void complete(const CallResult& ret) {
+        std::vector<std::function<void()>> continuations;
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            if (ready_) {
+                return;
+            }
+
+            CopyResult(result_, ret);
+            ready_ = true;
+            continuations.swap(continuations_);
+            cv_.notify_all();
+        }
+
+        for (auto& c : continuations) {
+            c();
+        }
+    }
+
+    // Runs 'c' once ready, immediately if it already is.
+    void onReady(std::function<void()> c) {
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            if (!ready_) {
+                continuations_.push_back(std::move(c));
+                return;
+            }
+        }
+
+        c();
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool ready_ = false;
+    CallResult result_;
+    std::vector<std::function<void()>> continuations_;
+    std::string callId_;
+};
+
+CallFuture::CallFuture(std::shared_ptr<State> state) noexcept :
+    state_(std::move(state)) {
+}
+
+CallFuture CallFuture::Create() {
+    return CallFuture(std::make_shared<State>());
+}
+
+ResultCallback CallFuture::completer() const {
+    std::shared_ptr<State> state = state_;
+    return [state](const CallResult& ret) { state->complete(ret); };
+}
+
+void CallFuture::setCallId(const std::string& callId) {
+    assert(state_);
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    state_->callId_ = callId;
+}
+
+bool CallFuture::isValid() const {
+    return !!state_;
+}
+
+std::string CallFuture::callId() const {
+    if (!state_) {
+        return std::string();
+    }
+
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->callId_;
+}
+
+bool CallFuture::isReady() const {
+    if (!state_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->ready_;
+}
+
+bool CallFuture::wait(uint32_t timeoutMS) const {
+    if (!state_) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> ul(state_->mutex_);
+    return state_->cv_.wait_for(ul, std::chrono::milliseconds(timeoutMS), [this]() { return state_->ready_; });
+}
+
+const CallResult& CallFuture::result() const {
+    assert(state_);
+    return state_->result_;
+}
+
+CallFuture CallFuture::then(std::function<CallResult(const CallResult&)> func, Executor executor) const {
+    CallFuture next = Create();
+    std::shared_ptr<State> nextState = next.state_;
+    std::function<void(const CallResult&)> complete = [nextState](const CallResult& ret) { nextState->complete(ret); };
+
+    if (!state_ || !func) {
+        CompleteWithError(complete, "Invalid future.");
+        return next;
+    }
+
+    std::shared_ptr<State> state = state_;
+    std::function<void()> run = [state, func, complete]() {
+        try {
+            CallResult ret = func(state->result_);
+            complete(ret);
+        } catch (std::exception& e) {
+            CompleteWithError(complete, e.what());
+        } catch (...) {
+            CompleteWithError(complete, "Unknown exception.");
+        }
+    };
+
+    state_->onReady([run, executor]() {
+        if (executor) {
+            executor(run);
+        }
+        else {
+            run();
+        }
+    });
+
+    return next;
+}
+
+CallFuture CallFuture::then(std::function<CallFuture(const CallResult&)> func, Executor executor) const {
+    CallFuture next = Create();
+    std::shared_ptr<State> nextState = next.state_;
+    std::function<void(const CallResult&)> complete = [nextState](const CallResult& ret) { nextState->complete(ret); };
+
+    if (!state_ || !func) {
+        CompleteWithError(complete, "Invalid future.");
+        return next;
+    }
+
+    std::shared_ptr<State> state = state_;
+    std::function<void()> run = [state, func, complete]() {
+        try {
+            CallFuture inner = func(state->result_);
+            if (!inner.isValid()) {
+                CompleteWithError(complete, "The continuation returned an invalid future.");
+                return;
+            }
+
+            std::shared_ptr<State> innerState = inner.state_;
+            innerState->onReady([innerState, complete]() { complete(innerState->result_); });
+        } catch (std::exception& e) {
+            CompleteWithError(complete, e.what());
+        } catch (...) {
+            CompleteWithError(complete, "Unknown exception.");
+        }
+    };
+
+    state_->onReady([run, executor]() {
+        if (executor) {
+            executor(run);
+        }
+        else {
+            run();
+        }
+    });
+
+    return next;
+}
+
+CallFuture CallFuture::WhenAll(const std::vector<CallFuture>& futures) {
+    CallFuture all = Create();
+    std::shared_ptr<State> allState = all.state_;
+
+    for (const CallFuture& f : futures) {
+        if (!f.isValid()) {
+            CompleteWithError([allState](const CallResult& ret) { allState->complete(ret); }, "Invalid future.");
+            return all;
+        }
+    }
+
+    std::shared_ptr<std::atomic<size_t>> remaining = std::make_shared<std::atomic<size_t>>(futures.size());
+    std::function<void()> onOneReady = [allState, remaining, futures]() {
+        if (remaining->fetch_sub(1) != 1) {
+            return;
+        }
+
+        for (const CallFuture& f : futures) {
+            if (!f.state_->result_.isSuccess()) {
+                allState->complete(f.state_->result_);
+                return;
+            }
+        }
+
+        CallResult ret;
+        ret.errCode = ErrorCode::SUCCESS;
+        allState->complete(ret);
+    };
+
+    if (futures.empty()) {
+        CallResult ret;
+        ret.errCode = ErrorCode::SUCCESS;
+        allState->complete(ret);
+        return all;
+    }
+
+    for (const CallFuture& f : futures) {
+        f.state_->onReady(onOneReady);
+    }
+
+    return all;
+}
+
+CallFuture CallFuture::WhenAny(const std::vector<CallFuture>& futures) {
+    CallFuture any = Create();
+    std::shared_ptr<State> anyState = any.state_;
+
+    if (futures.empty()) {
+        CompleteWithError([anyState](const CallResult& ret) { anyState->complete(ret); }, "No future to wait for.");
+        return any;
+    }
+
+    for (const CallFuture& f : futures) {
+        if (!f.isValid()) {
+            CompleteWithError([anyState](const CallResult& ret) { anyState->complete(ret); }, "Invalid future.");
+            return any;
+        }
+    }
+
+    // State::complete ignores all but the first.
+    for (const CallFuture& f : futures) {
+        std::shared_ptr<State> state = f.state_;
+        state->onReady([anyState, state]() { anyState->complete(state->result_); });
+    }
+
+    return any;
+}
+}  // namespace veigar
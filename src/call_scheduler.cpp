@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "call_scheduler.h"
+#include <assert.h>
+
+namespace veigar {
+CallScheduler::CallScheduler() noexcept :
+    selector_(kCallPriorityNumber) {
+}
+
+void CallScheduler::setPriorityPolicy(PriorityPolicy policy) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    selector_.setPolicy(policy);
+}
+
+void CallScheduler::setSchedulingPolicy(SchedulingPolicy policy) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    schedulingPolicy_ = policy;
+    for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+        lanes_[i].calls.setPolicy(policy);
+    }
+}
+
+void CallScheduler::setFairnessPolicy(FairnessPolicy policy) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    assert(size_ == 0);
+    fairnessPolicy_.store(policy);
+}
+
+FairnessPolicy CallScheduler::fairnessPolicy() const {
+    return fairnessPolicy_.load();
+}
+
+void CallScheduler::setCallerWeight(const std::string& callerChannelName, uint32_t weight) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (weight == 0) {
+        weights_.erase(callerChannelName);
+    }
+    else {
+        weights_[callerChannelName] = weight;
+    }
+}
+
+void CallScheduler::push(const PendingCall& call) {
+    assert(call.priority < kCallPriorityNumber);
+    const uint32_t index = call.priority < kCallPriorityNumber ? call.priority : (uint32_t)CallPriority::NORMAL;
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    Lane& lane = lanes_[index];
+    if (fairnessPolicy_.load() == FairnessPolicy::CALLER) {
+        auto it = lane.flows.find(call.callerChannelName);
+        if (it == lane.flows.end()) {
+            it = lane.flows.emplace(call.callerChannelName, Flow()).first;
+            it->second.calls.setPolicy(schedulingPolicy_);
+            lane.turns.push_back(call.callerChannelName);
+        }
+        it->second.calls.push(call, call.deadline);
+    }
+    else {
+        lane.calls.push(call, call.deadline);
+    }
+    size_++;
+}
+
+bool CallScheduler::pop(PendingCall& call) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    const int32_t index = selector_.select([this](uint32_t l) { return !lanes_[l].empty(); });
+    if (index < 0) {
+        return false;
+    }
+
+    Lane& lane = lanes_[index];
+    if (!lane.turns.empty()) {
+        popFair(lane, call);
+    }
+    else {
+        call = lane.calls.front();
+        lane.calls.pop();
+    }
+    size_--;
+    selector_.served((uint32_t)index);
+    return true;
+}
+
+void CallScheduler::popFair(Lane& lane, PendingCall& call) {
+    assert(!lane.turns.empty());
+    const std::string caller = lane.turns.front();
+    auto it = lane.flows.find(caller);
+    assert(it != lane.flows.end());
+    Flow& flow = it->second;
+
+    // Each call costs one, whatever its size: what the dispatcher threads spend on it is the running time of the function.
+    if (flow.deficit == 0) {
+        flow.deficit = callerWeight(caller);
+    }
+
+    call = flow.calls.front();
+    flow.calls.pop();
+    flow.deficit--;
+
+    if (flow.calls.empty()) {
+        // An idle caller does not keep the rest of its turn.
+        lane.flows.erase(it);
+        lane.turns.pop_front();
+    }
+    else if (flow.deficit == 0) {
+        lane.turns.pop_front();
+        lane.turns.push_back(caller);
+    }
+}
+
+uint32_t CallScheduler::callerWeight(const std::string& callerChannelName) const {
+    auto it = weights_.find(callerChannelName);
+    return it != weights_.end() ? it->second : 1;
+}
+
+size_t CallScheduler::size() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return size_;
+}
+
+void CallScheduler::clear() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+        lanes_[i].calls.clear();
+        lanes_[i].flows.clear();
+        lanes_[i].turns.clear();
+    }
+    size_ = 0;
+}
+
+bool CallScheduler::Lane::empty() const {
+    return calls.empty() && turns.empty();
+}
+}  // namespace veigar
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_CALL_SCHEDULER_H_
+#define VEIGAR_CALL_SCHEDULER_H_
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include "veigar/msgpack.hpp"
+#include "veigar/call_result.h"
+#include "priority_selector.h"
+#include "scheduled_queue.h"
+
+namespace veigar {
+// Holds the calls that have been drained from the call queue but not yet dispatched,
+// and decides which of them is dispatched next.
+class CallScheduler {
+   public:
+    struct PendingCall {
+        std::shared_ptr<veigar_msgpack::object_handle> obj;
+        uint32_t priority = (uint32_t)CallPriority::NORMAL;
+        int64_t deadline = 0;  // monotonic microseconds, 0 = none
+
+        // Set if the call is counted by the admission control of the dispatcher.
+        bool admitted = false;
+        std::string funcName;
+        std::string callerChannelName;
+    };
+
+    CallScheduler() noexcept;
+    ~CallScheduler() = default;
+
+    void setPriorityPolicy(PriorityPolicy policy);
+
+    // Only when there is no pending call.
+    void setSchedulingPolicy(SchedulingPolicy policy);
+
+    // Only when there is no pending call.
+    // With FairnessPolicy::CALLER, PendingCall::callerChannelName must be set.
+    void setFairnessPolicy(FairnessPolicy policy);
+    FairnessPolicy fairnessPolicy() const;
+
+    // The number of calls the caller dispatches in each of its turns, 0 resets it to the default (1).
+    void setCallerWeight(const std::string& callerChannelName, uint32_t weight);
+
+    void push(const PendingCall& call);
+    bool pop(PendingCall& call);
+
+    size_t size() const;
+    void clear();
+
+   private:
+    // The pending calls of one caller in a lane.
+    struct Flow {
+        ScheduledQueue<PendingCall> calls;
+        uint32_t deficit = 0;  // the calls left in its current turn
+    };
+
+    struct Lane {
+        ScheduledQueue<PendingCall> calls;  // FairnessPolicy::NONE
+
+        // FairnessPolicy::CALLER, a flow only exists while it has pending calls.
+        std::unordered_map<std::string, Flow> flows;  // caller -> flow
+        std::deque<std::string> turns;                // the callers with pending calls, the front one is being served
+
+        bool empty() const;
+    };
+
+    void popFair(Lane& lane, PendingCall& call);
+    uint32_t callerWeight(const std::string& callerChannelName) const;
+
+   private:
+    mutable std::mutex mutex_;
+    PrioritySelector selector_;
+    SchedulingPolicy schedulingPolicy_ = SchedulingPolicy::FIFO;
+    std::atomic<FairnessPolicy> fairnessPolicy_ = {FairnessPolicy::NONE};
+    std::unordered_map<std::string, uint32_t> weights_;  // caller -> weight
+    Lane lanes_[kCallPriorityNumber];
+    size_t size_ = 0;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_CALL_SCHEDULER_H_
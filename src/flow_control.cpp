@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "flow_control.h"
+#include "veigar/statistics.h"
+#include "time_util.h"
+
+namespace veigar {
+FlowControl::FlowControl(const FlowControlLimit& limit) noexcept :
+    limit_(limit) {
+}
+
+bool FlowControl::isEnabled() const {
+    return limit_.maxNumber > 0 || limit_.maxBytes > 0;
+}
+
+bool FlowControl::acquire(const std::string& callId, const std::string& channel, int64_t bytes, int64_t waitUntil) {
+    if (!isEnabled()) {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> ul(mutex_);
+    Target& target = targets_[channel];
+
+    // A call larger than maxBytes still goes through when the target has nothing in flight.
+    auto hasCredit = [this, &target, bytes]() {
+        if (target.number == 0) {
+            return true;
+        }
+        if (limit_.maxNumber > 0 && target.number >= (int64_t)limit_.maxNumber) {
+            return false;
+        }
+        return limit_.maxBytes == 0 || (uint64_t)(target.bytes + bytes) <= limit_.maxBytes;
+    };
+
+    if (!stopped_ && !hasCredit()) {
+        if (waitUntil == 0) {
+            return false;
+        }
+
+        waitedNumber_++;
+        while (!stopped_ && !hasCredit()) {
+            const int64_t remain = waitUntil - TimeUtil::GetCurrentTimestamp();
+            if (remain <= 0) {
+                timeoutNumber_++;
+                return false;
+            }
+            cv_.wait_for(ul, std::chrono::microseconds(remain));
+        }
+    }
+
+    if (stopped_) {
+        return false;
+    }
+
+    target.number++;
+    target.bytes += bytes;
+
+    Credit& credit = credits_[callId];
+    credit.channel = channel;
+    credit.bytes = bytes;
+    return true;
+}
+
+void FlowControl::release(const std::string& callId) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    auto it = credits_.find(callId);
+    if (it == credits_.end()) {
+        return;
+    }
+
+    auto itTarget = targets_.find(it->second.channel);
+    if (itTarget != targets_.end()) {
+        itTarget->second.number--;
+        itTarget->second.bytes -= it->second.bytes;
+    }
+    credits_.erase(it);
+
+    cv_.notify_all();
+}
+
+void FlowControl::stop() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    stopped_ = true;
+    targets_.clear();
+    credits_.clear();
+    cv_.notify_all();
+}
+
+void FlowControl::collectStatistics(Statistics& stats) const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    stats.flowControl.number = (int64_t)credits_.size();
+    stats.flowControl.bytes = 0;
+    for (const auto& it : targets_) {
+        stats.flowControl.bytes += it.second.bytes;
+    }
+    stats.flowControl.waitedNumber = waitedNumber_;
+    stats.flowControl.timeoutNumber = timeoutNumber_;
+}
+}  // namespace veigar
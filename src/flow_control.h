@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_FLOW_CONTROL_H_
+#define VEIGAR_FLOW_CONTROL_H_
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "veigar/call_result.h"
+
+namespace veigar {
+struct Statistics;
+
+// The credits of the calls in flight to each target channel, see Veigar::setFlowControl.
+// A call takes a credit before it is queued, and returns it once completed (response, deadline, cancellation or failure).
+// Thread-safe.
+class FlowControl {
+   public:
+    explicit FlowControl(const FlowControlLimit& limit) noexcept;
+    ~FlowControl() = default;
+
+    bool isEnabled() const;
+
+    // Waits until the target has credit for the call, up to 'waitUntil' (see TimeUtil::GetCurrentTimestamp).
+    // Does not wait if 'waitUntil' is 0.
+    // Return false on timeout, or if stopped.
+    bool acquire(const std::string& callId, const std::string& channel, int64_t bytes, int64_t waitUntil);
+
+    // Returns the credit taken by the call, if any.
+    void release(const std::string& callId);
+
+    // Wakes up and fails the waiting calls, and forgets all credits.
+    void stop();
+
+    // Fills the flow control part of the statistics.
+    void collectStatistics(Statistics& stats) const;
+
+   private:
+    struct Target {
+        int64_t number = 0;
+        int64_t bytes = 0;
+    };
+
+    struct Credit {
+        std::string channel;
+        int64_t bytes = 0;
+    };
+
+    const FlowControlLimit limit_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_ = false;
+    std::unordered_map<std::string, Target> targets_;  // channel -> credits in use
+    std::unordered_map<std::string, Credit> credits_;  // call id -> credit
+    int64_t waitedNumber_ = 0;
+    int64_t timeoutNumber_ = 0;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_FLOW_CONTROL_H_
@@ -9,11 +9,53 @@
 #include "log.h"
 #include <assert.h>
 #include <cstring>
+#include <algorithm>
+#ifndef VEIGAR_OS_WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <poll.h>
+#endif
 
 namespace veigar {
-MessageQueue::MessageQueue(int32_t msgMaxNumber, int32_t msgExpectedMaxSize) noexcept :
+/*
+Queue header:
+| Shard Number | Flags | Dropped Number | Rejected Number | Blocked Number |
+|      8       |   8   |       8        |        8        |       8        |
+
+Flags: bit 0 is the pollable flag, bits 8-15 are the QueueFullPolicy.
+
+Each lane:
+| Lane Total Size | Msg Number | Front Free Size | Msg 0 Size | Msg 1 Size | ... | Msg 0 Data | Msg 1 Data | ... |
+|      8          |      8     |       8         |    8       |    8       |     | Msg 0 Size | Msg 1 Size | ... |
+
+Bit 62 of a message size marks a message that DROP_OLDEST never evicts.
+
+Shared memory:
+| Queue Header | Lane 0 | Lane 1 | ... |
+*/
+static constexpr int64_t kQueueHeaderSize = sizeof(int64_t) * 5;
+static constexpr int64_t kPollableFlag = 0x1;
+static constexpr int kFullPolicyShift = 8;
+static constexpr int64_t kFullPolicyMask = 0xff00;
+
+// The indexes of the counters in the queue header.
+static constexpr int kDroppedIndex = 2;
+static constexpr int kRejectedIndex = 3;
+static constexpr int kBlockedIndex = 4;
+
+static constexpr int64_t kKeepFlag = (int64_t)1 << 62;
+
+static int64_t MsgSize(int64_t sizeField) {
+    return sizeField & ~kKeepFlag;
+}
+
+MessageQueue::MessageQueue(int32_t msgMaxNumber, int32_t msgExpectedMaxSize, uint32_t laneNumber) noexcept :
     msgMaxNumber_(msgMaxNumber),
-    msgExpectedMaxSize_(msgExpectedMaxSize) {
+    msgExpectedMaxSize_(msgExpectedMaxSize),
+    laneNumber_(laneNumber > 0 ? laneNumber : 1),
+    selector_(laneNumber > 0 ? laneNumber : 1) {
 }
 
 bool MessageQueue::create(const std::string& path) {
@@ -27,10 +69,11 @@ bool MessageQueue::create(const std::string& path) {
             break;
         }
 
-        int64_t shmSize = sizeof(int64_t) * (msgMaxNumber_ + 3) + msgMaxNumber_ * msgExpectedMaxSize_;
+        const int64_t shmSize = memorySize();
 
         const std::string shmName = path + "_shm";
         shm_ = std::make_shared<SharedMemory>(shmName, shmSize);
+        shm_->setNumaNode(numaNode_);
         if (!shm_->create()) {
             break;
         }
@@ -49,8 +92,18 @@ bool MessageQueue::create(const std::string& path) {
 
         uint8_t* data = shm_->data();
         memset(data, 0, (size_t)shmSize); // clear shared memory
-        int64_t* pDataSize = (int64_t*)data;
-        *pDataSize = shmSize;
+        for (uint32_t i = 0; i < laneNumber_; ++i) {
+            int64_t* pLaneSize = (int64_t*)laneData(i);
+            *pLaneSize = laneSize();
+        }
+
+        if (pollable_) {
+            if (!createPollHandle(path)) {
+                break;
+            }
+            ((int64_t*)data)[1] |= kPollableFlag;
+        }
+        ((int64_t*)data)[1] |= ((int64_t)fullPolicy_ << kFullPolicyShift) & kFullPolicyMask;
 
         result = true;
     } while (false);
@@ -73,6 +126,8 @@ bool MessageQueue::create(const std::string& path) {
                 readSmp_->close();
             readSmp_.reset();
         }
+
+        closePollHandle();
     }
 
     return result;
@@ -85,7 +140,7 @@ bool MessageQueue::open(const std::string& path) {
         close();
 
         const std::string shmName = path + "_shm";
-        int64_t shmSize = sizeof(int64_t) * (msgMaxNumber_ + 3) + msgMaxNumber_ * msgExpectedMaxSize_;
+        const int64_t shmSize = memorySize();
 
         shm_ = std::make_shared<SharedMemory>(shmName, shmSize);
         if (!shm_->open()) {
@@ -104,6 +159,14 @@ bool MessageQueue::open(const std::string& path) {
             break;
         }
 
+        // The reader of a pollable queue is woken up through its poll handle.
+        const int64_t flags = ((const int64_t*)shm_->data())[1];
+        pollable_ = (flags & kPollableFlag) != 0;
+        fullPolicy_ = (QueueFullPolicy)((flags & kFullPolicyMask) >> kFullPolicyShift);
+        if (pollable_ && !openPollHandle(path)) {
+            break;
+        }
+
         result = true;
     } while (false);
 
@@ -125,6 +188,8 @@ bool MessageQueue::open(const std::string& path) {
                 readSmp_->close();
             readSmp_.reset();
         }
+
+        closePollHandle();
     }
 
     return result;
@@ -142,11 +207,62 @@ void MessageQueue::processRWUnlock() {
     rwLock_->release();
 }
 
-/*
-| Shm Total Size | Msg Number | Front Free Size | Msg 0 Size | Msg 1 Size | ... | Msg 0 Data | Msg 1 Data | ... |
-|      8         |      8     |       8         |    8       |    8       |     | Msg 0 Size | Msg 1 Size | ... |
-*/
-bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
+
+int64_t MessageQueue::laneSize() const {
+    return sizeof(int64_t) * (msgMaxNumber_ + 3) + (int64_t)msgMaxNumber_ * msgExpectedMaxSize_;
+}
+
+uint8_t* MessageQueue::laneData(uint32_t lane) const {
+    assert(lane < laneNumber_);
+    if (!shm_ || lane >= laneNumber_) {
+        return nullptr;
+    }
+
+    uint8_t* shmData = shm_->data();
+    if (!shmData) {
+        return nullptr;
+    }
+
+    return shmData + kQueueHeaderSize + laneSize() * lane;
+}
+
+uint32_t MessageQueue::laneNumber() const {
+    return laneNumber_;
+}
+
+void MessageQueue::setNumaNode(int32_t node) {
+    numaNode_ = node;
+}
+
+int32_t MessageQueue::numaNode() const {
+    return shm_ ? shm_->numaNode() : -1;
+}
+
+int64_t MessageQueue::memorySize() const {
+    return kQueueHeaderSize + laneSize() * laneNumber_;
+}
+
+void MessageQueue::setShardNumber(uint32_t number) {
+    assert(shm_ && shm_->data());
+    if (shm_ && shm_->data()) {
+        *(int64_t*)shm_->data() = number;
+    }
+}
+
+uint32_t MessageQueue::shardNumber() const {
+    if (!shm_ || !shm_->data()) {
+        return 1;
+    }
+
+    const int64_t number = *(const int64_t*)shm_->data();
+    return number > 0 ? (uint32_t)number : 1;
+}
+
+void MessageQueue::setPriorityPolicy(PriorityPolicy policy) {
+    selector_.setPolicy(policy);
+}
+
+bool MessageQueue::pushBack(const void* data, int64_t dataSize, uint32_t lane, bool evictable) {
     bool ret = false;
 
     assert(data);
@@ -166,7 +282,7 @@ bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
     }
 
     do {
-        uint8_t* const shmData = shm_->data();
+        uint8_t* const shmData = laneData(lane);
         assert(shmData);
         if (!shmData) {
             break;
@@ -188,11 +304,40 @@ bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
         int64_t msgDataTotalSize = 0L;
         if (*pCurMsgNumber > 0) {
             for (int64_t i = 0; i < *pCurMsgNumber; i++) {
-                msgDataTotalSize += *(pFirstMsgDataSize + i);
+                msgDataTotalSize += MsgSize(*(pFirstMsgDataSize + i));
             }
         }
 
         int64_t totalFree = *pShmSize - msgSizeHeaderTotalSize - sizeof(int64_t) * 3 - msgDataTotalSize;
+
+        // Make room by discarding the oldest evictable messages, their space is reclaimed by the move below.
+        int64_t keptNumber = 0;
+        int64_t keptSize = 0;
+        while (fullPolicy_ == QueueFullPolicy::DROP_OLDEST && (totalFree < dataSize || *pCurMsgNumber == msgMaxNumber_)) {
+            while (keptNumber < *pCurMsgNumber && (pFirstMsgDataSize[keptNumber] & kKeepFlag)) {
+                keptSize += MsgSize(pFirstMsgDataSize[keptNumber]);
+                keptNumber++;
+            }
+            if (keptNumber >= *pCurMsgNumber) {
+                break;
+            }
+
+            // Slide the kept messages in front of the victim over its data.
+            const int64_t victimSize = MsgSize(pFirstMsgDataSize[keptNumber]);
+            uint8_t* const pFront = pFirstMsgData + *pFrontFree;
+            memmove(pFront + victimSize, pFront, (size_t)keptSize);
+            *pFrontFree += victimSize;
+
+            *pCurMsgNumber -= 1;
+            memmove(pFirstMsgDataSize + keptNumber, pFirstMsgDataSize + keptNumber + 1, (size_t)(sizeof(int64_t) * (*pCurMsgNumber - keptNumber)));
+            msgDataTotalSize -= victimSize;
+            totalFree += victimSize;
+            ((int64_t*)shm_->data())[kDroppedIndex] += 1;
+
+            // The victim was announced to the reader, take its wake-up back.
+            consumeReadNotification();
+        }
+
         int64_t tailFree = totalFree - *pFrontFree;
         if (totalFree < dataSize || *pCurMsgNumber == msgMaxNumber_) {
             veigar::log("Veigar: Warning: Message queue is full. Please adjust the parameters of the message queue.\n");
@@ -204,7 +349,7 @@ bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
             *pCurMsgNumber += 1;
 
             // record data size
-            *(pFirstMsgDataSize + (*pCurMsgNumber - 1)) = dataSize;
+            *(pFirstMsgDataSize + (*pCurMsgNumber - 1)) = evictable ? dataSize : (dataSize | kKeepFlag);
 
             pCopyBegin = pFirstMsgData + msgDataTotalSize + *pFrontFree;
         }
@@ -212,11 +357,11 @@ bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
             *pCurMsgNumber += 1;
 
             // record data size
-            *(pFirstMsgDataSize + (*pCurMsgNumber - 1)) = dataSize;
+            *(pFirstMsgDataSize + (*pCurMsgNumber - 1)) = evictable ? dataSize : (dataSize | kKeepFlag);
 
             // move old data to offset zero
             uint8_t* pOldData = pFirstMsgData + *pFrontFree;
-            memcpy(pFirstMsgData, pOldData, (size_t)msgDataTotalSize);
+            memmove(pFirstMsgData, pOldData, (size_t)msgDataTotalSize);
 
             // set front free to 0
             *pFrontFree = 0;
@@ -233,13 +378,22 @@ bool MessageQueue::pushBack(const void* data, int64_t dataSize) {
     return ret;
 }
 
-bool MessageQueue::popFront(void* buf, int64_t bufSize, int64_t& written) {
+bool MessageQueue::popFront(void* buf, int64_t bufSize, int64_t& written, uint32_t* lane) {
     bool ret = false;
 
     do {
         written = 0;
 
-        uint8_t* shmData = shm_->data();
+        const int32_t selected = selector_.select([this](uint32_t l) { return msgNumber(l) > 0; });
+        if (selected < 0) {
+            break;
+        }
+
+        if (lane) {
+            *lane = (uint32_t)selected;
+        }
+
+        uint8_t* shmData = laneData((uint32_t)selected);
         assert(shmData);
         if (!shmData) {
             break;
@@ -258,22 +412,18 @@ bool MessageQueue::popFront(void* buf, int64_t bufSize, int64_t& written) {
         int64_t* const pFrontFree = p64 + 2;
         int64_t* const pFirstMsgDataSize = p64 + 3;
 
-        if (*pFirstMsgDataSize > bufSize || !buf) {
-            written = *pFirstMsgDataSize;
+        const int64_t frontSize = MsgSize(*pFirstMsgDataSize);
+        if (frontSize > bufSize || !buf) {
+            written = frontSize;
             break;
         }
 
         int64_t msgSizeHeaderTotalSize = msgMaxNumber_ * sizeof(int64_t);
         uint8_t* const pFirstMsgData = shmData + sizeof(int64_t) * 3 + msgSizeHeaderTotalSize;
 
-        int64_t msgDataTotalSize = 0L;
-        for (int64_t i = 0; i < *pCurMsgNumber; i++) {
-            msgDataTotalSize += *(pFirstMsgDataSize + i);
-        }
-
         // copy data
         uint8_t* pCopyBegin = pFirstMsgData + *pFrontFree;
-        written = *pFirstMsgDataSize;
+        written = frontSize;
 
         memcpy(buf, pCopyBegin, (size_t)written);
 
@@ -281,10 +431,12 @@ bool MessageQueue::popFront(void* buf, int64_t bufSize, int64_t& written) {
         *pCurMsgNumber -= 1;
 
         // set front free
-        *pFrontFree += *pFirstMsgDataSize;
+        *pFrontFree += frontSize;
 
         // pop a element from data size list
-        memcpy(pFirstMsgDataSize, pFirstMsgDataSize + 1, (size_t)(sizeof(int64_t) * (*pCurMsgNumber)));
+        memmove(pFirstMsgDataSize, pFirstMsgDataSize + 1, (size_t)(sizeof(int64_t) * (*pCurMsgNumber)));
+
+        selector_.served((uint32_t)selected);
 
         ret = true;
     } while (false);
@@ -293,7 +445,19 @@ bool MessageQueue::popFront(void* buf, int64_t bufSize, int64_t& written) {
 }
 
 int64_t MessageQueue::msgNumber() const {
-    uint8_t* shmData = shm_->data();
+    int64_t total = 0;
+    for (uint32_t i = 0; i < laneNumber_; ++i) {
+        const int64_t num = msgNumber(i);
+        if (num < 0) {
+            return -1;
+        }
+        total += num;
+    }
+    return total;
+}
+
+int64_t MessageQueue::msgNumber(uint32_t lane) const {
+    uint8_t* shmData = laneData(lane);
     assert(shmData);
     if (!shmData) {
         return -1;
@@ -310,6 +474,21 @@ int64_t MessageQueue::msgNumber() const {
     return *pCurMsgNumber;
 }
 
+int64_t MessageQueue::msgNumberHint() const {
+    int64_t total = 0;
+    for (uint32_t i = 0; i < laneNumber_; ++i) {
+        const uint8_t* shmData = laneData(i);
+        if (!shmData) {
+            return 0;
+        }
+
+        // A single aligned word, which the writers only change under the lock.
+        const int64_t number = *((const volatile int64_t*)shmData + 1);
+        total += number > 0 ? number : 0;
+    }
+    return total;
+}
+
 bool MessageQueue::waitForRead(int64_t ms) {
     if (readSmp_) {
         return readSmp_->wait(ms);
@@ -317,7 +496,7 @@ bool MessageQueue::waitForRead(int64_t ms) {
     return false;
 }
 
-bool MessageQueue::checkSpaceSufficient(int64_t dataSize, bool& waitable) const {
+bool MessageQueue::checkSpaceSufficient(int64_t dataSize, bool& waitable, uint32_t lane) const {
     assert(msgMaxNumber_ > 0);
     if (msgMaxNumber_ * msgExpectedMaxSize_ < dataSize) {
         waitable = false;
@@ -325,11 +504,17 @@ bool MessageQueue::checkSpaceSufficient(int64_t dataSize, bool& waitable) const
         return false;
     }
 
+    // pushBack makes room.
+    if (fullPolicy_ == QueueFullPolicy::DROP_OLDEST) {
+        waitable = true;
+        return laneData(lane) != nullptr;
+    }
+
     bool result = false;
     waitable = true;
 
     do {
-        uint8_t* const shmData = shm_->data();
+        uint8_t* const shmData = laneData(lane);
         assert(shmData);
         if (!shmData) {
             break;
@@ -354,7 +539,7 @@ bool MessageQueue::checkSpaceSufficient(int64_t dataSize, bool& waitable) const
         int64_t msgDataTotalSize = 0L;
         if (*pCurMsgNumber > 0) {
             for (int64_t i = 0; i < *pCurMsgNumber; i++) {
-                msgDataTotalSize += *(pFirstMsgDataSize + i);
+                msgDataTotalSize += MsgSize(*(pFirstMsgDataSize + i));
             }
         }
 
@@ -387,11 +572,184 @@ void MessageQueue::close() {
             readSmp_->close();
         readSmp_.reset();
     }
+
+    closePollHandle();
 }
 
 void MessageQueue::notifyRead() {
+#ifndef VEIGAR_OS_WINDOWS
+    if (fifoFd_ >= 0) {
+        // A full pipe already wakes up the reader.
+        const char c = 0;
+        ssize_t ret = ::write(fifoFd_, &c, 1);
+        (void)ret;
+        return;
+    }
+#endif
+
     if (readSmp_) {
         readSmp_->release();
     }
 }
-}  // namespace veigar
\ No newline at end of file
+
+void MessageQueue::consumeReadNotification() {
+#ifndef VEIGAR_OS_WINDOWS
+    // The poll handle is drained as a whole by the reader.
+    if (fifoFd_ >= 0) {
+        return;
+    }
+#endif
+
+    if (readSmp_) {
+        readSmp_->wait(0);
+    }
+}
+
+void MessageQueue::setFullPolicy(QueueFullPolicy policy) {
+    fullPolicy_ = policy;
+}
+
+QueueFullPolicy MessageQueue::fullPolicy() const {
+    return fullPolicy_;
+}
+
+void MessageQueue::countFull() {
+    if (!shm_ || fullPolicy_ == QueueFullPolicy::DROP_OLDEST) {
+        return;
+    }
+    ((int64_t*)shm_->data())[fullPolicy_ == QueueFullPolicy::REJECT ? kRejectedIndex : kBlockedIndex] += 1;
+}
+
+MessageQueue::FullCounters MessageQueue::fullCounters() const {
+    FullCounters counters;
+    if (shm_) {
+        const int64_t* header = (const int64_t*)shm_->data();
+        counters.droppedNumber = header[kDroppedIndex];
+        counters.rejectedNumber = header[kRejectedIndex];
+        counters.blockedNumber = header[kBlockedIndex];
+    }
+    return counters;
+}
+
+void MessageQueue::setPollable(bool pollable) {
+    pollable_ = pollable;
+}
+
+bool MessageQueue::isPollable() const {
+    return pollable_;
+}
+
+PollHandle MessageQueue::pollHandle() const {
+#ifdef VEIGAR_OS_WINDOWS
+    return readSmp_ ? readSmp_->nativeHandle() : NULL;
+#else
+    return fifoFd_;
+#endif
+}
+
+void MessageQueue::clearReady() {
+#ifndef VEIGAR_OS_WINDOWS
+    if (fifoFd_ < 0) {
+        return;
+    }
+
+    char buf[256];
+    while (::read(fifoFd_, buf, sizeof(buf)) > 0) {
+    }
+#endif
+}
+
+bool MessageQueue::WaitReady(const std::vector<PollHandle>& handles, int64_t ms) {
+    if (handles.empty()) {
+        return false;
+    }
+
+#ifdef VEIGAR_OS_WINDOWS
+    // The handles past MAXIMUM_WAIT_OBJECTS are only checked by the caller after the timeout.
+    const DWORD count = (DWORD)std::min(handles.size(), (size_t)MAXIMUM_WAIT_OBJECTS);
+    const DWORD ret = ::WaitForMultipleObjects(count, handles.data(), FALSE, ms < 0 ? INFINITE : (DWORD)ms);
+    return ret < WAIT_OBJECT_0 + count;
+#else
+    std::vector<pollfd> fds;
+    fds.reserve(handles.size());
+    for (PollHandle h : handles) {
+        fds.push_back({h, POLLIN, 0});
+    }
+
+    int ret = 0;
+    do {
+        ret = ::poll(fds.data(), (nfds_t)fds.size(), (int)ms);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0;
+#endif
+}
+
+#ifdef VEIGAR_OS_WINDOWS
+// The read semaphore is the poll handle, WaitForMultipleObjects can wait on it.
+bool MessageQueue::createPollHandle(const std::string& /*path*/) {
+    return true;
+}
+
+bool MessageQueue::openPollHandle(const std::string& /*path*/) {
+    return true;
+}
+
+void MessageQueue::closePollHandle() {
+}
+#else
+// The read semaphore can not be waited on by an event loop, the writers write a byte to a FIFO instead.
+// Like the shared memory, the FIFO is bound to the queue a writer opened: once the creator closes the queue,
+// the FIFO is unlinked, and the writer has to open the queue created again to reach the new reader.
+bool MessageQueue::createPollHandle(const std::string& path) {
+    fifoPath_ = std::string(VEIGAR_POLL_FIFO_DIR) + "/" + path + "_fifo";
+
+    // A FIFO left by a crashed process is reused rather than replaced,
+    // so that the writers that still have it open keep waking up this reader.
+    if (::mkfifo(fifoPath_.c_str(), 0666) != 0 && errno != EEXIST) {
+        veigar::log("Veigar: Error: mkfifo failed, path: %s, errno: %d.\n", fifoPath_.c_str(), errno);
+        fifoPath_.clear();
+        return false;
+    }
+
+    // Also opened for writing, so that the FIFO is never at end-of-file while no writer has it open.
+    fifoFd_ = ::open(fifoPath_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fifoFd_ < 0) {
+        veigar::log("Veigar: Error: Open FIFO failed, path: %s, errno: %d.\n", fifoPath_.c_str(), errno);
+        ::unlink(fifoPath_.c_str());
+        fifoPath_.clear();
+        return false;
+    }
+
+    // The wakeups of a previous reader.
+    clearReady();
+
+    fifoCreator_ = true;
+    return true;
+}
+
+bool MessageQueue::openPollHandle(const std::string& path) {
+    const std::string fifoPath = std::string(VEIGAR_POLL_FIFO_DIR) + "/" + path + "_fifo";
+
+    // Also opened for reading, so that a write after the reader is gone fails silently instead of raising SIGPIPE.
+    fifoFd_ = ::open(fifoPath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fifoFd_ < 0) {
+        veigar::log("Veigar: Error: Open FIFO failed, path: %s, errno: %d.\n", fifoPath.c_str(), errno);
+        return false;
+    }
+    return true;
+}
+
+void MessageQueue::closePollHandle() {
+    if (fifoFd_ >= 0) {
+        ::close(fifoFd_);
+        fifoFd_ = -1;
+    }
+
+    if (fifoCreator_) {
+        ::unlink(fifoPath_.c_str());
+        fifoCreator_ = false;
+    }
+    fifoPath_.clear();
+}
+#endif
+}  // namespace veigar
@@ -10,14 +10,19 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <inttypes.h>
 #include "shared_memory.h"
 #include "semaphore.h"
+#include "priority_selector.h"
+#include "veigar/call_result.h"
 
 namespace veigar {
+// A message queue in shared memory, which may be divided into several lanes.
+// Each lane has the full capacity and its own header, the lanes share the rw-lock and the read semaphore.
 class MessageQueue {
    public:
-    MessageQueue(int32_t msgMaxNumber, int32_t msgExpectedMaxSize) noexcept;
+    MessageQueue(int32_t msgMaxNumber, int32_t msgExpectedMaxSize, uint32_t laneNumber = 1) noexcept;
     ~MessageQueue() = default;
 
     bool create(const std::string& path);
@@ -29,27 +34,111 @@ class MessageQueue {
     void processRWUnlock();
 
     // Need protect by process rw-lock
-    bool pushBack(const void* data, int64_t dataSize);
+    // A message that is not evictable is never discarded by QueueFullPolicy::DROP_OLDEST.
+    bool pushBack(const void* data, int64_t dataSize, uint32_t lane = 0, bool evictable = true);
 
     // Need protect by process rw-lock
-    bool popFront(void* buf, int64_t bufSize, int64_t& written);
+    // The lane is chosen by the priority policy, the higher the lane index the higher the priority.
+    bool popFront(void* buf, int64_t bufSize, int64_t& written, uint32_t* lane = nullptr);
 
     // Need protect by process rw-lock
+    // The total number of messages of all lanes.
     int64_t msgNumber() const;
 
     // Need protect by process rw-lock
-    bool checkSpaceSufficient(int64_t dataSize, bool& waitable) const;
+    int64_t msgNumber(uint32_t lane) const;
+
+    // Same as msgNumber, read without the process rw-lock, e.g. to pick the least deep shard.
+    // The number may be stale by the time it is used, never negative.
+    int64_t msgNumberHint() const;
+
+    // Need protect by process rw-lock
+    bool checkSpaceSufficient(int64_t dataSize, bool& waitable, uint32_t lane = 0) const;
+
+    uint32_t laneNumber() const;
+
+    // See SharedMemory::setNumaNode, must be called before create.
+    void setNumaNode(int32_t node);
+
+    // The NUMA node the queue memory is bound to, or -1 if it is not bound.
+    int32_t numaNode() const;
+
+    // The size of the shared memory in bytes.
+    int64_t memorySize() const;
+
+    // The number of call queue shards of the channel, kept in the header of each shard.
+    // Set once by the creator right after create, so it can be read without the process rw-lock.
+    void setShardNumber(uint32_t number);
+    uint32_t shardNumber() const;
+
+    void setPriorityPolicy(PriorityPolicy policy);
 
     bool waitForRead(int64_t ms);
 
     void notifyRead();
 
+    // The messages that found the queue full, counted in the queue header by all writers, see QueueFullPolicy.
+    struct FullCounters {
+        int64_t droppedNumber = 0;
+        int64_t rejectedNumber = 0;
+        int64_t blockedNumber = 0;
+    };
+
+    // Must be called before create, the writers read it from the queue header on open.
+    // With QueueFullPolicy::DROP_OLDEST, pushBack discards the oldest evictable messages of the lane to make room,
+    // together with the read notifications they have posted.
+    void setFullPolicy(QueueFullPolicy policy);
+    QueueFullPolicy fullPolicy() const;
+
+    // Need protect by process rw-lock
+    // Counts a message that found the queue full, as rejected or blocked by the policy. The drops are counted by pushBack.
+    void countFull();
+
+    // Need protect by process rw-lock
+    FullCounters fullCounters() const;
+
+    // See Veigar::setPollMode, must be called before create.
+    // The reader of a pollable queue is woken up through its poll handle instead of waitForRead.
+    // A writer keeps waking up the reader of the queue it opened, it has to open the queue again once re-created.
+    void setPollable(bool pollable);
+    bool isPollable() const;
+
+    // Only for a pollable queue created by this process, ready once messages have been pushed.
+    PollHandle pollHandle() const;
+
+    // Consumes the wakeups of the poll handle, must be called before popping the messages.
+    void clearReady();
+
+    // Waits at most 'ms' milliseconds for one of the poll handles to be ready.
+    // On Windows, the wakeup of the handle that is ready is consumed.
+    static bool WaitReady(const std::vector<PollHandle>& handles, int64_t ms);
+
+   private:
+    bool createPollHandle(const std::string& path);
+    bool openPollHandle(const std::string& path);
+    void closePollHandle();
+
+    // Takes back the read notification of a discarded message, if it is still pending.
+    void consumeReadNotification();
+
+    int64_t laneSize() const;
+    uint8_t* laneData(uint32_t lane) const;
+
    private:
     int32_t msgMaxNumber_ = 0;
     int32_t msgExpectedMaxSize_ = 0;
+    uint32_t laneNumber_ = 1;
+    int32_t numaNode_ = -1;
+    PrioritySelector selector_;
     std::shared_ptr<SharedMemory> shm_ = nullptr;
     std::shared_ptr<Semaphore> rwLock_ = nullptr;
     std::shared_ptr<Semaphore> readSmp_ = nullptr;
+
+    QueueFullPolicy fullPolicy_ = QueueFullPolicy::BLOCK;
+    bool pollable_ = false;
+    int fifoFd_ = -1;  // POSIX only
+    std::string fifoPath_;
+    bool fifoCreator_ = false;
 };
 }  // namespace veigar
-#endif
\ No newline at end of file
+#endif
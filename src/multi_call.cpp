@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "veigar/multi_call.h"
+#include <mutex>
+#include <condition_variable>
+#include <cassert>
+
+namespace veigar {
+class MultiCallResult::State {
+   public:
+    void complete(size_t index, const CallResult& ret) {
+        assert(index < results_.size());
+
+        // The callback runs before the waiters are woken up, so a finished wait means the callbacks have returned.
+        if (cb_) {
+            cb_(index, channels_[index], ret);
+        }
+
+        std::lock_guard<std::mutex> lg(mutex_);
+        assert(!completed_[index]);
+        results_[index].errCode = ret.errCode;
+        results_[index].errorMessage = ret.errorMessage;
+        results_[index].obj = veigar_msgpack::clone(ret.obj.get());
+        completed_[index] = true;
+        order_.push_back(index);
+        cv_.notify_all();
+    }
+
+    std::vector<std::string> channels_;
+    MultiResultCallback cb_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<CallResult> results_;
+    std::vector<bool> completed_;
+    std::vector<size_t> order_;  // the completed indexes
+};
+
+MultiCallResult::MultiCallResult(const std::vector<std::string>& channels, MultiResultCallback cb) noexcept :
+    state_(std::make_shared<State>()) {
+    state_->channels_ = channels;
+    state_->cb_ = cb;
+    state_->results_.resize(channels.size());
+    state_->completed_.resize(channels.size(), false);
+    state_->order_.reserve(channels.size());
+}
+
+size_t MultiCallResult::size() const {
+    return state_->channels_.size();
+}
+
+std::vector<std::string> MultiCallResult::channels() const {
+    return state_->channels_;
+}
+
+size_t MultiCallResult::completedCount() const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->order_.size();
+}
+
+std::vector<size_t> MultiCallResult::completionOrder() const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->order_;
+}
+
+bool MultiCallResult::waitAll(uint32_t timeoutMS) {
+    return waitFirst(state_->channels_.size(), timeoutMS);
+}
+
+bool MultiCallResult::waitFirst(size_t k, uint32_t timeoutMS) {
+    if (k > state_->channels_.size()) {
+        k = state_->channels_.size();
+    }
+
+    std::unique_lock<std::mutex> ul(state_->mutex_);
+    return state_->cv_.wait_for(ul, std::chrono::milliseconds(timeoutMS), [this, k]() { return state_->order_.size() >= k; });
+}
+
+bool MultiCallResult::isCompleted(size_t index) const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return index < state_->completed_.size() && state_->completed_[index];
+}
+
+const CallResult& MultiCallResult::result(size_t index) const {
+    assert(index < state_->results_.size());
+    return state_->results_[index];
+}
+
+void MultiCallResult::bindResultMeta(size_t index, ResultMeta& retMeta) {
+    std::shared_ptr<State> state = state_;
+    retMeta.metaType = 1;
+    retMeta.cb = [state, index](const CallResult& ret) { state->complete(index, ret); };
+}
+
+void MultiCallResult::complete(size_t index, const CallResult& ret) {
+    state_->complete(index, ret);
+}
+}  // namespace veigar
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "priority_selector.h"
+#include <assert.h>
+
+namespace veigar {
+PrioritySelector::PrioritySelector(uint32_t laneNumber) noexcept {
+    credits_.resize(laneNumber, 0);
+    for (uint32_t i = 0; i < laneNumber; ++i) {
+        credits_[i] = weight(i);
+    }
+}
+
+void PrioritySelector::setPolicy(PriorityPolicy policy) {
+    policy_ = policy;
+}
+
+PriorityPolicy PrioritySelector::policy() const {
+    return policy_;
+}
+
+int32_t PrioritySelector::select(const std::function<bool(uint32_t)>& hasMessage) const {
+    int32_t highest = -1;
+    for (int32_t lane = (int32_t)credits_.size() - 1; lane >= 0; --lane) {
+        if (!hasMessage((uint32_t)lane)) {
+            continue;
+        }
+
+        if (policy_ == PriorityPolicy::STRICT) {
+            return lane;
+        }
+
+        if (highest == -1) {
+            highest = lane;
+        }
+
+        if (credits_[lane] > 0) {
+            return lane;
+        }
+    }
+
+    // All lanes that have messages used up their credits, they will be refilled by served().
+    return highest;
+}
+
+void PrioritySelector::served(uint32_t lane) {
+    assert(lane < credits_.size());
+    if (policy_ != PriorityPolicy::WEIGHTED || lane >= credits_.size()) {
+        return;
+    }
+
+    if (credits_[lane] == 0) {
+        for (uint32_t i = 0; i < credits_.size(); ++i) {
+            credits_[i] = weight(i);
+        }
+    }
+
+    credits_[lane]--;
+}
+
+uint32_t PrioritySelector::weight(uint32_t lane) const {
+    return 1u << lane;
+}
+}  // namespace veigar
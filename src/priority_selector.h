@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_PRIORITY_SELECTOR_H_
+#define VEIGAR_PRIORITY_SELECTOR_H_
+#pragma once
+
+#include <inttypes.h>
+#include <functional>
+#include <vector>
+#include "veigar/call_result.h"
+
+namespace veigar {
+// Chooses which priority lane to serve next.
+// The lane index is the priority, the higher the index the more urgent the lane.
+//
+// select() does not change any state, so it returns the same lane until served() is called.
+// This allows the caller to retry a pop (e.g. after growing its buffer) from the same lane.
+class PrioritySelector {
+   public:
+    explicit PrioritySelector(uint32_t laneNumber) noexcept;
+
+    void setPolicy(PriorityPolicy policy);
+    PriorityPolicy policy() const;
+
+    // Return the lane to serve, or -1 if no lane has messages.
+    int32_t select(const std::function<bool(uint32_t)>& hasMessage) const;
+
+    // Tell the selector that one message has been taken from the lane.
+    void served(uint32_t lane);
+
+   private:
+    uint32_t weight(uint32_t lane) const;
+
+   private:
+    PriorityPolicy policy_ = PriorityPolicy::STRICT;
+    std::vector<uint32_t> credits_;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_PRIORITY_SELECTOR_H_
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "recv_buffer_pool.h"
+#include <stdlib.h>
+#include <new>
+#include <algorithm>
+#include "veigar/config.h"
+#include "veigar/statistics.h"
+#include "time_util.h"
+
+namespace veigar {
+namespace {
+bool ReferenceAll(veigar_msgpack::type::object_type /*type*/, std::size_t /*len*/, void* /*userData*/) {
+    return true;
+}
+
+void DropBufferRef(void* ref) {
+    delete static_cast<RecvBufferPool::BufferPtr*>(ref);
+}
+}  // namespace
+
+RecvBufferPool::RecvBufferPool() noexcept {
+    const int32_t classNumber = SizeClass(VEIGAR_RECV_BUFFER_MAX_SIZE) + 1;
+    idle_.resize((size_t)std::max(classNumber, 1));
+}
+
+RecvBufferPool::~RecvBufferPool() {
+    for (std::deque<Idle>& idle : idle_) {
+        for (Idle& i : idle) {
+            free(i.data);
+        }
+        idle.clear();
+    }
+}
+
+RecvBufferPool::BufferPtr RecvBufferPool::acquire(size_t size) {
+    const int32_t sizeClass = SizeClass(size);
+    const size_t capacity = sizeClass >= 0 ? ClassSize(sizeClass) : size;
+
+    uint8_t* data = nullptr;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (sizeClass >= 0 && !idle_[sizeClass].empty()) {
+            // The most recently returned buffer is the most likely to be still in the cache.
+            data = idle_[sizeClass].back().data;
+            idle_[sizeClass].pop_back();
+            pooledBytes_ -= (int64_t)capacity;
+            reusedNumber_++;
+        }
+        usedBytes_ += (int64_t)capacity;
+    }
+
+    if (!data) {
+        data = (uint8_t*)malloc(capacity);
+        if (!data) {
+            std::lock_guard<std::mutex> lg(mutex_);
+            usedBytes_ -= (int64_t)capacity;
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lg(mutex_);
+        allocatedNumber_++;
+    }
+
+    Buffer* buffer = new (std::nothrow) Buffer();
+    if (!buffer) {
+        free(data);
+        std::lock_guard<std::mutex> lg(mutex_);
+        usedBytes_ -= (int64_t)capacity;
+        return nullptr;
+    }
+    buffer->data_ = data;
+    buffer->capacity_ = capacity;
+    buffer->sizeClass_ = sizeClass;
+
+    std::weak_ptr<RecvBufferPool> pool = shared_from_this();
+    return BufferPtr(buffer, [pool](Buffer* b) {
+        std::shared_ptr<RecvBufferPool> p = pool.lock();
+        if (p) {
+            p->release(b);
+        }
+        else {
+            free(b->data_);
+        }
+        delete b;
+    });
+}
+
+void RecvBufferPool::release(Buffer* buffer) {
+    const int64_t now = TimeUtil::GetMonotonicTimestamp();
+    bool keep = false;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        usedBytes_ -= (int64_t)buffer->capacity_;
+
+        keep = buffer->sizeClass_ >= 0 && pooledBytes_ + (int64_t)buffer->capacity_ <= VEIGAR_RECV_BUFFER_POOL_MAX_BYTES;
+        if (keep) {
+            Idle idle;
+            idle.data = buffer->data_;
+            idle.since = now;
+            idle_[buffer->sizeClass_].push_back(idle);
+            pooledBytes_ += (int64_t)buffer->capacity_;
+            nextTrim_ = std::min(nextTrim_, now + (int64_t)VEIGAR_RECV_BUFFER_IDLE_TRIM * 1000);
+        }
+
+        if (now >= nextTrim_) {
+            trimLocked(now);
+        }
+    }
+
+    if (!keep) {
+        free(buffer->data_);
+    }
+    buffer->data_ = nullptr;
+}
+
+void RecvBufferPool::trim() {
+    const int64_t now = TimeUtil::GetMonotonicTimestamp();
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (now >= nextTrim_) {
+        trimLocked(now);
+    }
+}
+
+void RecvBufferPool::trimLocked(int64_t now) {
+    const int64_t idleTimeout = (int64_t)VEIGAR_RECV_BUFFER_IDLE_TRIM * 1000;
+    nextTrim_ = std::numeric_limits<int64_t>::max();
+
+    for (size_t c = 0; c < idle_.size(); ++c) {
+        std::deque<Idle>& idle = idle_[c];
+        while (!idle.empty() && now - idle.front().since >= idleTimeout) {
+            free(idle.front().data);
+            idle.pop_front();
+            pooledBytes_ -= (int64_t)ClassSize((int32_t)c);
+            trimmedNumber_++;
+        }
+
+        if (!idle.empty()) {
+            nextTrim_ = std::min(nextTrim_, idle.front().since + idleTimeout);
+        }
+    }
+}
+
+void RecvBufferPool::Unpack(const BufferPtr& buffer, size_t size, std::vector<veigar_msgpack::object_handle>& objs) {
+    std::size_t off = 0;
+    while (off < size) {
+        bool referenced = false;
+        veigar_msgpack::object_handle obj = veigar_msgpack::unpack((const char*)buffer->data(), size, off, referenced, &ReferenceAll);
+        if (referenced) {
+            std::unique_ptr<BufferPtr> ref(new BufferPtr(buffer));
+            obj.zone()->push_finalizer(&DropBufferRef, ref.get());
+            ref.release();
+        }
+        objs.push_back(std::move(obj));
+    }
+}
+
+void RecvBufferPool::collectStatistics(Statistics& stats) const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    stats.recvBuffers.usedBytes = usedBytes_;
+    stats.recvBuffers.pooledBytes = pooledBytes_;
+    stats.recvBuffers.allocatedNumber = allocatedNumber_;
+    stats.recvBuffers.reusedNumber = reusedNumber_;
+    stats.recvBuffers.trimmedNumber = trimmedNumber_;
+}
+
+int32_t RecvBufferPool::SizeClass(size_t size) {
+    int32_t sizeClass = 0;
+    size_t classSize = VEIGAR_RECV_BUFFER_MIN_SIZE;
+    while (classSize < size) {
+        classSize <<= 1;
+        sizeClass++;
+    }
+    return classSize <= VEIGAR_RECV_BUFFER_MAX_SIZE ? sizeClass : -1;
+}
+
+size_t RecvBufferPool::ClassSize(int32_t sizeClass) {
+    return (size_t)VEIGAR_RECV_BUFFER_MIN_SIZE << sizeClass;
+}
+}  // namespace veigar
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_RECV_BUFFER_POOL_H_
+#define VEIGAR_RECV_BUFFER_POOL_H_
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <limits>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include "veigar/msgpack.hpp"
+
+namespace veigar {
+struct Statistics;
+
+// The buffers the call and response dispatchers of an instance receive the messages into, see VEIGAR_RECV_BUFFER_MIN_SIZE.
+// A buffer goes back to the pool once the last object unpacked from it is released,
+// so the memory follows the messages being processed instead of the largest message ever received.
+// Thread-safe.
+class RecvBufferPool : public std::enable_shared_from_this<RecvBufferPool> {
+   public:
+    class Buffer {
+       public:
+        uint8_t* data() const { return data_; }
+        size_t capacity() const { return capacity_; }
+
+       private:
+        friend class RecvBufferPool;
+        uint8_t* data_ = nullptr;
+        size_t capacity_ = 0;
+        int32_t sizeClass_ = -1;  // -1 for a buffer larger than VEIGAR_RECV_BUFFER_MAX_SIZE
+    };
+    using BufferPtr = std::shared_ptr<Buffer>;
+
+    RecvBufferPool() noexcept;
+    ~RecvBufferPool();
+
+    // Must be owned by a std::shared_ptr, a buffer still used after the pool is gone is freed.
+    // Return nullptr if out of memory.
+    BufferPtr acquire(size_t size);
+
+    // Frees the idle buffers unused for VEIGAR_RECV_BUFFER_IDLE_TRIM, called by the dispatchers while they are idle.
+    void trim();
+
+    // Unpacks all objects of the message received into the first 'size' bytes of 'buffer'.
+    // The objects reference the buffer instead of copying the strings, and keep it until they are released.
+    // Throws on malformed data, 'objs' then has the objects unpacked before.
+    static void Unpack(const BufferPtr& buffer, size_t size, std::vector<veigar_msgpack::object_handle>& objs);
+
+    // Fills the receive buffer part of the statistics.
+    void collectStatistics(Statistics& stats) const;
+
+   private:
+    struct Idle {
+        uint8_t* data = nullptr;
+        int64_t since = 0;  // monotonic microseconds
+    };
+
+    void release(Buffer* buffer);
+
+    // The mutex must be held.
+    void trimLocked(int64_t now);
+
+    static int32_t SizeClass(size_t size);
+    static size_t ClassSize(int32_t sizeClass);
+
+   private:
+    mutable std::mutex mutex_;
+    std::vector<std::deque<Idle>> idle_;  // by size class, the most recently returned last
+    int64_t nextTrim_ = std::numeric_limits<int64_t>::max();
+
+    int64_t usedBytes_ = 0;
+    int64_t pooledBytes_ = 0;
+    int64_t allocatedNumber_ = 0;
+    int64_t reusedNumber_ = 0;
+    int64_t trimmedNumber_ = 0;
+};
+}  // namespace veigar
+
+#endif  // !VEIGAR_RECV_BUFFER_POOL_H_
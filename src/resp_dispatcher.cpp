@@ -10,6 +10,7 @@
 #include "log.h"
 #include "string_helper.h"
 #include "message_queue.h"
+#include "time_util.h"
 #include "run_time_recorder.h"
 
 namespace veigar {
@@ -17,21 +18,49 @@ RespDispatcher::RespDispatcher(Veigar* veigar) noexcept :
     veigar_(veigar) {
 }
 
-bool RespDispatcher::init() {
+bool RespDispatcher::init(std::shared_ptr<FlowControl> flowControl, std::shared_ptr<RecvBufferPool> bufferPool) {
     if (init_) {
         return true;
     }
 
     stop_.store(false);
+    flowControl_ = flowControl;
+    bufferPool_ = bufferPool;
 
     respMsgQueue_ = std::make_shared<MessageQueue>(veigar_->msgQueueCapacity(), veigar_->expectedMsgMaxSize());
+    respMsgQueue_->setNumaNode(veigar_->numaNode());
+    pollMode_ = veigar_->pollMode();
+    respMsgQueue_->setPollable(pollMode_);
+    respMsgQueue_->setFullPolicy(veigar_->responseQueueFullPolicy());
     if (!respMsgQueue_->create(veigar_->channelName() + VEIGAR_RESPONSE_QUEUE_NAME_SUFFIX)) {
         veigar::log("Veigar: [ERROR] Failed to create response message queue for channel: %s.\n", veigar_->channelName().c_str());
         return false;
     }
 
-    for (size_t i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER; ++i) {
-        workers_.emplace_back(std::thread(&RespDispatcher::dispatchRespThreadProc, this));
+    callbackPolicy_ = veigar_->callbackPolicy();
+    threadless_ = veigar_->threadless();
+    if (threadless_ && callbackPolicy_ == CallbackPolicy::POOL) {
+        callbackPolicy_ = CallbackPolicy::INLINE;
+    }
+    callbackExecutor_ = veigar_->callbackExecutor();
+    callbackBacklog_ = std::make_shared<CallbackBacklog>();
+    if (callbackPolicy_ == CallbackPolicy::POOL) {
+        callbackPool_ = std::make_shared<WorkStealingPool>();
+        callbackPool_->setPlacement("veigar-cb", veigar_->cpuAffinity(ThreadRole::RESULT_CALLBACK));
+        if (!callbackPool_->start(VEIGAR_CALLBACK_MIN_THREAD_NUMBER, VEIGAR_CALLBACK_THREAD_NUMBER)) {
+            veigar::log("Veigar: [ERROR] Failed to start callback thread pool.\n");
+            respMsgQueue_->close();
+            respMsgQueue_.reset();
+            return false;
+        }
+    }
+
+    // In poll mode, the responses are dispatched by processReady.
+    if (!pollMode_) {
+        workers_.setPlacement("veigar-resp", veigar_->cpuAffinity(ThreadRole::RESPONSE_DISPATCHER));
+        workers_.start(VEIGAR_DISPATCHER_MIN_THREAD_NUMBER,
+                       VEIGAR_DISPATCHER_THREAD_NUMBER,
+                       std::bind(&RespDispatcher::dispatchRespThreadProc, this));
     }
 
     init_ = true;
@@ -50,14 +79,43 @@ void RespDispatcher::uninit() {
 
     stop_.store(true);
 
-    for (std::thread& worker : workers_) {
-        respMsgQueue_->notifyRead();
+    workers_.stop([this]() { respMsgQueue_->notifyRead(); });
+
+    // The deadline thread is started by addOngoingCall under the same lock, which no longer starts it once stopped.
+    std::thread deadlineThread;
+    ongoingCallsMutex_.lock();
+    deadlineCV_.notify_all();
+    deadlineThread.swap(deadlineThread_);
+    ongoingCallsMutex_.unlock();
+
+    if (deadlineThread.joinable()) {
+        deadlineThread.join();
     }
 
-    for (std::thread& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    // The callbacks already posted to the pool still run, the ones posted to a user executor are left to it.
+    if (callbackPolicy_ == CallbackPolicy::POOL && callbackPool_) {
+        // Called from a result callback, the backlog can not drain before it returns.
+        bool drained = false;
+        if (!callbackPool_->isWorkerThread()) {
+            std::unique_lock<std::mutex> ul(callbackBacklog_->mutex);
+            drained = callbackBacklog_->cv.wait_for(ul, std::chrono::milliseconds(VEIGAR_CALLBACK_DRAIN_TIMEOUT), [this]() {
+                return callbackBacklog_->count == 0;
+            });
+            if (!drained) {
+                veigar::log("Veigar: [WARNING] %" PRId64 " result callbacks have not returned, they are left to finish on their own.\n",
+                            callbackBacklog_->count);
+            }
+        }
+
+        if (drained) {
+            callbackPool_->stop();
+        }
+        else {
+            // The pool can not join the threads still in a callback, it is stopped by another thread once they return.
+            std::shared_ptr<WorkStealingPool> pool = callbackPool_;
+            std::thread([pool]() { pool->stop(); }).detach();
         }
+        callbackPool_.reset();
     }
 
     if (respMsgQueue_) {
@@ -67,8 +125,11 @@ void RespDispatcher::uninit() {
 
     ongoingCallsMutex_.lock();
     ongoingCalls_.clear();
+    deadlines_.clear();
     ongoingCallsMutex_.unlock();
 
+    bufferPool_.reset();
+
     init_ = false;
 }
 
@@ -76,20 +137,82 @@ std::shared_ptr<veigar::MessageQueue> RespDispatcher::messageQueue() {
     return respMsgQueue_;
 }
 
-void RespDispatcher::dispatchRespThreadProc() {
-    veigar_msgpack::unpacker respPac;
+PollHandle RespDispatcher::pollHandle() const {
+    return respMsgQueue_ ? respMsgQueue_->pollHandle() : PollHandle();
+}
 
-    try {
-        respPac.reserve_buffer(veigar_->expectedMsgMaxSize());
-    } catch (std::bad_alloc& e) {
-        veigar::log("Veigar: [ERROR] Failed to allocate memory for response buffer (%d bytes): %s.\n", veigar_->expectedMsgMaxSize(), e.what());
-        return;
+uint32_t RespDispatcher::processReady(uint32_t maxMessages) {
+    if (!init_ || !pollMode_) {
+        return 0;
     }
 
-    int64_t written = 0L;
+    std::lock_guard<std::mutex> lg(pollMutex_);
+
+    // Before popping, a message pushed afterwards wakes up the poll handle again.
+    respMsgQueue_->clearReady();
+
+    std::vector<veigar_msgpack::object_handle> objs;
+    uint32_t processed = 0;
+    int64_t backlog = 0;
+    while (maxMessages == 0 || processed < maxMessages) {
+        if (!popResp(objs, backlog, false)) {
+            backlog = 0;
+            break;
+        }
+        processed++;
+
+        dispatchResps(objs);
+
+        if (backlog == 0) {
+            break;
+        }
+    }
+
+    // Not all messages were taken, the poll handle has to stay ready.
+    if (backlog > 0) {
+        respMsgQueue_->notifyRead();
+    }
+
+    return processed;
+}
+
+void RespDispatcher::collectStatistics(Statistics& stats) const {
+    ThreadStatistics& ts = stats.threads[(uint32_t)ThreadRole::RESPONSE_DISPATCHER];
+    ts.threadNumber = workers_.size();
+    ts.busyThreadNumber = workers_.busy();
+    ts.cpus = workers_.cpus();
+    ts.pinFailedThreadNumber = workers_.pinFailed();
+
+    if (callbackPolicy_ == CallbackPolicy::POOL) {
+        ThreadStatistics& cbts = stats.threads[(uint32_t)ThreadRole::RESULT_CALLBACK];
+        cbts.threadNumber = callbackPool_ ? callbackPool_->threadNumber() : 0;
+        cbts.busyThreadNumber = callbackPool_ ? callbackPool_->busyThreadNumber() : 0;
+        cbts.cpus = veigar_->cpuAffinity(ThreadRole::RESULT_CALLBACK);
+        cbts.pinFailedThreadNumber = callbackPool_ ? callbackPool_->pinFailedThreadNumber() : 0;
+    }
+
+    if (respMsgQueue_) {
+        stats.responseQueue.memorySize = respMsgQueue_->memorySize();
+        stats.responseQueue.numaNode = respMsgQueue_->numaNode();
+
+        if (respMsgQueue_->processRWLock(veigar_->timeoutOfRWLock())) {
+            const MessageQueue::FullCounters counters = respMsgQueue_->fullCounters();
+            respMsgQueue_->processRWUnlock();
+            stats.responseQueue.droppedNumber = counters.droppedNumber;
+            stats.responseQueue.rejectedNumber = counters.rejectedNumber;
+            stats.responseQueue.blockedNumber = counters.blockedNumber;
+        }
+    }
+}
+
+void RespDispatcher::dispatchRespThreadProc() {
+    std::vector<veigar_msgpack::object_handle> objs;
     while (!stop_.load()) {
-        written = 0L;
-        if (!respMsgQueue_->waitForRead(-1)) {
+        if (!respMsgQueue_->waitForRead(VEIGAR_WORKER_IDLE_TIMEOUT)) {
+            bufferPool_->trim();
+            if (workers_.retire()) {
+                break;
+            }
             continue;
         }
 
@@ -97,148 +220,408 @@ void RespDispatcher::dispatchRespThreadProc() {
             break;
         }
 
-        if (!respMsgQueue_->processRWLock(veigar_->timeoutOfRWLock())) {
-            veigar::log("Veigar: [WARNING] Timeout while acquiring read-write lock for response queue.\n");
+        int64_t backlog = 0;
+        if (!popResp(objs, backlog, true)) {
             continue;
         }
 
-        const int64_t msgNum = respMsgQueue_->msgNumber();
-        if (msgNum <= 0) {
-            if (msgNum < 0) {
-                veigar::log("Veigar: [ERROR] Failed to query message count from response queue.\n");
+        workers_.enterBusy();
+        workers_.grow(backlog);
+
+        dispatchResps(objs);
+
+        workers_.leaveBusy();
+    }
+}
+
+bool RespDispatcher::popResp(std::vector<veigar_msgpack::object_handle>& objs, int64_t& backlog, bool signaled) {
+    int64_t written = 0L;
+    if (!respMsgQueue_->processRWLock(veigar_->timeoutOfRWLock())) {
+        veigar::log("Veigar: [WARNING] Timeout while acquiring read-write lock for response queue.\n");
+        return false;
+    }
+
+    const int64_t msgNum = respMsgQueue_->msgNumber();
+    if (msgNum <= 0) {
+        if (msgNum < 0) {
+            veigar::log("Veigar: [ERROR] Failed to query message count from response queue.\n");
+        }
+        else if (signaled) {
+            veigar::log("Veigar: [WARNING] Received read signal for empty response queue.\n");
+        }
+        respMsgQueue_->processRWUnlock();
+        return false;
+    }
+
+    // Only asks for the size of the front message, so that the buffer fits it.
+    respMsgQueue_->popFront(nullptr, 0, written);
+    if (written <= 0) {
+        veigar::log("Veigar: [ERROR] Failed to retrieve message from response queue.\n");
+        respMsgQueue_->processRWUnlock();
+        return false;
+    }
+
+    RecvBufferPool::BufferPtr buffer = bufferPool_->acquire((size_t)written);
+    if (!buffer) {
+        veigar::log("Veigar: [ERROR] Failed to allocate memory for response buffer (%" PRId64 " bytes).\n", written);
+        respMsgQueue_->processRWUnlock();
+        return false;
+    }
+
+    if (!respMsgQueue_->popFront(buffer->data(), (int64_t)buffer->capacity(), written)) {
+        veigar::log("Veigar: [ERROR] Failed to retrieve message from response queue.\n");
+        respMsgQueue_->processRWUnlock();
+        return false;
+    }
+
+    // The depth remaining in the queue header decides whether another worker is needed.
+    backlog = respMsgQueue_->msgNumber();
+
+    respMsgQueue_->processRWUnlock();
+
+    objs.clear();
+    try {
+        RecvBufferPool::Unpack(buffer, (size_t)written, objs);
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Exception occurred while parsing response data: %s.\n", e.what());
+    } catch (...) {
+        veigar::log(
+            "Veigar: [ERROR] Unknown exception occurred while parsing response data. Exception type not derived from std::exception.\n");
+    }
+    return true;
+}
+
+void RespDispatcher::dispatchResps(std::vector<veigar_msgpack::object_handle>& objs) {
+    for (veigar_msgpack::object_handle& obj : objs) {
+        ResultMeta retMeta;
+        CallResult callRet;
+        std::string callId;
+        try {
+            detail::Response::ResponseMsg r;
+            obj.get().convert(r);
+
+            // Check protocol
+            uint32_t msgFlag = std::get<0>(r);
+            if (msgFlag != 1 && msgFlag != 3) {
+                veigar::log("Veigar: [ERROR] Invalid response message flag: %d.\n", msgFlag);
+                continue;
             }
-            else {
-                veigar::log("Veigar: [WARNING] Received read signal for empty response queue.\n");
+
+            callId = std::get<1>(r);
+            if (callId.empty()) {
+                veigar::log("Veigar: [WARNING] Call ID is empty.\n");
+                continue;
             }
-            respMsgQueue_->processRWUnlock();
-            continue;
-        }
 
-        if (!respMsgQueue_->popFront(respPac.buffer(), respPac.buffer_capacity(), written)) {
-            if (written <= 0) {
-                veigar::log("Veigar: [ERROR] Failed to retrieve message from response queue.\n");
-                respMsgQueue_->processRWUnlock();
+            if (msgFlag == 3) {
+                dispatchStreamItem(callId, std::get<2>(r), std::get<3>(r));
                 continue;
             }
 
-            try {
-                respPac.reserve_buffer((size_t)written);
-            } catch (std::bad_alloc& e) {
-                veigar::log("Veigar: [ERROR] Failed to allocate memory for response buffer (%d bytes): %s.\n", written, e.what());
-                respMsgQueue_->processRWUnlock();
+            ongoingCallsMutex_.lock();
+            auto it = ongoingCalls_.find(callId);
+            if (it != ongoingCalls_.end()) {
+                retMeta = it->second;
+
+                // Claim the callback, so that it can not be completed again by the deadline timer.
+                if (retMeta.metaType == 1) {
+                    ongoingCalls_.erase(it);
+                }
+                else if (retMeta.metaType == 3) {
+                    // The items sent before the end may still be on the way through other threads,
+                    // so the stream is kept until its reader releases it, only the end is claimed.
+                    it->second.cb = nullptr;
+                }
+
+                if (retMeta.deadline > 0) {
+                    removeDeadline(callId, retMeta.deadline);
+                }
+
+                flowControl_->release(callId);
+            }
+            else {
+                veigar::log("Veigar: [WARNING] Call not found: %s (Active calls: %d).\n", callId.c_str(), ongoingCalls_.size());
+                ongoingCallsMutex_.unlock();
                 continue;
             }
+            ongoingCallsMutex_.unlock();
 
-            if (!respMsgQueue_->popFront(respPac.buffer(), respPac.buffer_capacity(), written)) {
-                veigar::log("Veigar: [ERROR] Failed to retrieve message from response queue.\n");
-                respMsgQueue_->processRWUnlock();
+            if (retMeta.metaType != 0 && retMeta.metaType != 1 && retMeta.metaType != 3) {
+                veigar::log("Veigar: [WARNING] Invalid result meta type: %d.\n", retMeta.metaType);
                 continue;
             }
+
+            // The error is either a message, or [error code, message] when the target did not run the call.
+            ErrorCode errCode = ErrorCode::SUCCESS;
+            auto&& error_obj = std::get<2>(r);
+            if (error_obj.type == veigar_msgpack::type::ARRAY) {
+                std::tuple<int32_t, std::string> typedError;
+                error_obj.convert(typedError);
+                errCode = (ErrorCode)std::get<0>(typedError);
+                callRet.errorMessage = std::get<1>(typedError);
+            }
+            else if (!error_obj.is_nil()) {
+                veigar_msgpack::object_handle errObjHandle = veigar_msgpack::clone(error_obj);
+                callRet.errorMessage = errObjHandle.get().as<std::string>();
+            }
+
+            callRet.obj = std::move(veigar_msgpack::clone(std::get<3>(r)));
+
+            // Last set error code.
+            callRet.errCode = errCode;
+        } catch (std::exception& e) {
+            callRet.errorMessage = StringHelper::StringPrintf("An exception occurred during parsing response message: %s.", e.what());
+        } catch (...) {
+            callRet.errorMessage = "An exception occurred during parsing response message.";
         }
 
-        respPac.buffer_consumed((size_t)written);
+        if (retMeta.metaType == 0) {
+            assert(retMeta.p);
+            if (retMeta.p) {
+                retMeta.p->set_value(std::move(callRet));
+            }
+        }
+        else if (retMeta.metaType == 1 || retMeta.metaType == 3) {
+            assert(retMeta.cb);
+            if (retMeta.cb) {
+                runCallback(retMeta.cb, callRet);
+            }
+        }
+    }
+    objs.clear();
+}
 
-        respMsgQueue_->processRWUnlock();
+void RespDispatcher::dispatchStreamItem(const std::string& callId, const veigar_msgpack::object& seqObj, const veigar_msgpack::object& item) {
+    ResultMeta retMeta;
+    {
+        std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
+        auto it = ongoingCalls_.find(callId);
+        if (it == ongoingCalls_.end()) {
+            // The stream has been cancelled by the caller, the items already sent are discarded.
+            return;
+        }
+        retMeta = it->second;
+    }
 
-        do {
-            veigar_msgpack::object_handle obj;
-            bool nextRet = false;
-            try {
-                nextRet = respPac.next(obj);
-            } catch (std::exception& e) {
-                veigar::log("Veigar: [ERROR] Exception occurred while parsing response data: %s.\n", e.what());
-                nextRet = false;
-            } catch (...) {
-                veigar::log(
-                    "Veigar: [ERROR] Unknown exception occurred while parsing response data. Exception type not derived from std::exception.\n");
-                nextRet = false;
-            }
-
-            if (!nextRet) {
-                break;
+    if (retMeta.metaType != 3 || !retMeta.itemCb) {
+        veigar::log("Veigar: [WARNING] Received stream item for call %s which is not a stream.\n", callId.c_str());
+        return;
+    }
+
+    uint64_t seq = 0;
+    try {
+        seq = seqObj.as<uint64_t>();
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Invalid sequence of stream item for call %s: %s.\n", callId.c_str(), e.what());
+        return;
+    }
+
+    veigar_msgpack::object_handle itemHandle = veigar_msgpack::clone(item);
+    retMeta.itemCb(seq, itemHandle);
+}
+
+void RespDispatcher::runCallback(const ResultCallback& cb, CallResult& ret) {
+    if (callbackPolicy_ == CallbackPolicy::INLINE) {
+        cb(ret);
+        return;
+    }
+
+    std::shared_ptr<CallbackBacklog> backlog = callbackBacklog_;
+    {
+        std::unique_lock<std::mutex> ul(backlog->mutex);
+        while (backlog->count >= VEIGAR_CALLBACK_BACKLOG_LIMIT && !stop_.load()) {
+            backlog->cv.wait_for(ul, std::chrono::milliseconds(100));
+        }
+        backlog->count++;
+    }
+
+    std::shared_ptr<CallResult> retPtr = std::make_shared<CallResult>(std::move(ret));
+    std::function<void()> task = [cb, retPtr, backlog]() {
+        cb(*retPtr);
+
+        std::lock_guard<std::mutex> lg(backlog->mutex);
+        backlog->count--;
+        backlog->cv.notify_all();
+    };
+
+    if (callbackPolicy_ == CallbackPolicy::POOL) {
+        if (!callbackPool_ || !callbackPool_->submit(task)) {
+            task();
+        }
+    }
+    else {
+        callbackExecutor_(task);
+    }
+}
+
+void RespDispatcher::addOngoingCall(const std::string& callId, const ResultMeta& retMeta) {
+    std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
+    ongoingCalls_[callId] = retMeta;
+
+    if (retMeta.deadline > 0) {
+        const bool earliest = deadlines_.empty() || retMeta.deadline < deadlines_.begin()->first;
+        deadlines_.emplace(retMeta.deadline, callId);
+
+        // A thread-less instance expires the calls from Veigar::poll.
+        if (!threadless_ && !stop_.load()) {
+            if (!deadlineThread_.joinable()) {
+                deadlineThread_ = std::thread(&RespDispatcher::deadlineThreadProc, this);
+            }
+            else if (earliest) {
+                deadlineCV_.notify_one();
             }
+        }
+    }
+}
 
-            ResultMeta retMeta;
-            CallResult callRet;
-            std::string callId;
-            try {
-                detail::Response::ResponseMsg r;
-                obj.get().convert(r);
+bool RespDispatcher::releaseCall(const std::string& callId) {
+    std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
+    auto it = ongoingCalls_.find(callId);
+    if (it == ongoingCalls_.cend()) {
+        return false;
+    }
 
-                // Check protocol
-                uint32_t msgFlag = std::get<0>(r);
-                if (msgFlag != 1) {
-                    veigar::log("Veigar: [ERROR] Invalid response message flag: %d.\n", msgFlag);
-                    continue;
-                }
+    if (it->second.deadline > 0) {
+        removeDeadline(callId, it->second.deadline);
+    }
+    ongoingCalls_.erase(it);
+    flowControl_->release(callId);
+    return true;
+}
 
-                callId = std::get<1>(r);
-                if (callId.empty()) {
-                    veigar::log("Veigar: [WARNING] Call ID is empty.\n");
-                    continue;
-                }
+bool RespDispatcher::cancelCall(const std::string& callId, std::string& channel) {
+    ResultMeta retMeta;
+    {
+        std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
+        auto it = ongoingCalls_.find(callId);
+        if (it == ongoingCalls_.cend()) {
+            return false;
+        }
 
-                ongoingCallsMutex_.lock();
-                if (ongoingCalls_.find(callId) != ongoingCalls_.end()) {
-                    retMeta = ongoingCalls_[callId];
-                }
-                else {
-                    veigar::log("Veigar: [WARNING] Call not found: %s (Active calls: %d).\n", callId.c_str(), ongoingCalls_.size());
-                    ongoingCallsMutex_.unlock();
-                    continue;
-                }
-                ongoingCallsMutex_.unlock();
+        retMeta = it->second;
+        if (retMeta.deadline > 0) {
+            removeDeadline(callId, retMeta.deadline);
+        }
+        ongoingCalls_.erase(it);
+        flowControl_->release(callId);
 
-                if (retMeta.metaType != 0 && retMeta.metaType != 1) {
-                    veigar::log("Veigar: [WARNING] Invalid result meta type: %d.\n", retMeta.metaType);
-                    continue;
-                }
+        // A stream that has already ended.
+        if (retMeta.metaType == 3 && !retMeta.cb) {
+            return false;
+        }
+    }
 
-                auto&& error_obj = std::get<2>(r);
-                if (!error_obj.is_nil()) {
-                    veigar_msgpack::object_handle errObjHandle = veigar_msgpack::clone(error_obj);
-                    callRet.errorMessage = errObjHandle.get().as<std::string>();
-                }
+    channel = retMeta.channel;
+
+    CallResult cancelledRet;
+    cancelledRet.errCode = ErrorCode::CANCELLED;
+    cancelledRet.errorMessage = "The call has been cancelled.";
 
-                callRet.obj = std::move(veigar_msgpack::clone(std::get<3>(r)));
+    if (retMeta.metaType == 0) {
+        if (!retMeta.p) {
+            return false;
+        }
 
-                // Last set success.
-                callRet.errCode = ErrorCode::SUCCESS;
-            } catch (std::exception& e) {
-                callRet.errorMessage = StringHelper::StringPrintf("An exception occurred during parsing response message: %s.", e.what());
-            } catch (...) {
-                callRet.errorMessage = "An exception occurred during parsing response message.";
+        // The promise stays ongoing after the response until releaseCall, it may have been fulfilled already.
+        try {
+            retMeta.p->set_value(std::move(cancelledRet));
+        } catch (std::future_error&) {
+            return false;
+        }
+    }
+    else if (retMeta.metaType == 1 || retMeta.metaType == 3) {
+        if (retMeta.cb) {
+            runCallback(retMeta.cb, cancelledRet);
+        }
+    }
+
+    return true;
+}
+
+void RespDispatcher::removeDeadline(const std::string& callId, int64_t deadline) {
+    // ongoingCallsMutex_ must be locked by caller.
+    auto range = deadlines_.equal_range(deadline);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == callId) {
+            deadlines_.erase(it);
+            break;
+        }
+    }
+}
+
+void RespDispatcher::deadlineThreadProc() {
+    std::vector<ResultMeta> expired;
+    while (!stop_.load()) {
+        expired.clear();
+        {
+            std::unique_lock<std::mutex> ul(ongoingCallsMutex_);
+            if (stop_.load()) {
+                break;
             }
 
-            if (retMeta.metaType == 0) {
-                assert(retMeta.p);
-                if (retMeta.p) {
-                    retMeta.p->set_value(std::move(callRet));
-                }
+            if (deadlines_.empty()) {
+                deadlineCV_.wait_for(ul, std::chrono::milliseconds(VEIGAR_WORKER_IDLE_TIMEOUT));
+                continue;
             }
-            else if (retMeta.metaType == 1) {
-                assert(retMeta.cb);
-                if (retMeta.cb) {
-                    retMeta.cb(callRet);
-                }
 
-                releaseCall(callId);
+            const int64_t now = TimeUtil::GetMonotonicTimestamp();
+            const int64_t earliest = deadlines_.begin()->first;
+            if (earliest > now) {
+                deadlineCV_.wait_for(ul, std::chrono::microseconds(earliest - now));
+                continue;
             }
-        } while (true);  // msgpack unpack while
+
+            takeExpired(now, expired);
+        }
+
+        completeExpired(expired);
     }
 }
 
-void RespDispatcher::addOngoingCall(const std::string& callId, const ResultMeta& retMeta) {
-    ongoingCallsMutex_.lock();
-    ongoingCalls_[callId] = retMeta;
-    ongoingCallsMutex_.unlock();
+uint32_t RespDispatcher::expireDeadlines() {
+    std::vector<ResultMeta> expired;
+    {
+        std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
+        takeExpired(TimeUtil::GetMonotonicTimestamp(), expired);
+    }
+
+    completeExpired(expired);
+    return (uint32_t)expired.size();
 }
 
-void RespDispatcher::releaseCall(const std::string& callId) {
+int64_t RespDispatcher::earliestDeadline() {
     std::lock_guard<std::mutex> lg(ongoingCallsMutex_);
-    auto it = ongoingCalls_.find(callId);
-    if (it != ongoingCalls_.cend()) {
-        ongoingCalls_.erase(it);
+    return deadlines_.empty() ? 0 : deadlines_.begin()->first;
+}
+
+void RespDispatcher::takeExpired(int64_t now, std::vector<ResultMeta>& expired) {
+    while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+        auto it = ongoingCalls_.find(deadlines_.begin()->second);
+        if (it != ongoingCalls_.end()) {
+            flowControl_->release(it->first);
+            expired.push_back(it->second);
+            ongoingCalls_.erase(it);
+        }
+        deadlines_.erase(deadlines_.begin());
+    }
+}
+
+void RespDispatcher::completeExpired(std::vector<ResultMeta>& expired) {
+    for (ResultMeta& retMeta : expired) {
+        CallResult timeoutRet;
+        timeoutRet.errCode = ErrorCode::TIMEOUT;
+        timeoutRet.errorMessage = "The response has not arrived before the deadline.";
+
+        if (retMeta.metaType == 0) {
+            if (retMeta.p) {
+                retMeta.p->set_value(std::move(timeoutRet));
+            }
+        }
+        else if (retMeta.metaType == 1 || retMeta.metaType == 3) {
+            if (retMeta.cb) {
+                runCallback(retMeta.cb, timeoutRet);
+            }
+        }
     }
 }
 }  // namespace veigar
\ No newline at end of file
@@ -16,14 +16,23 @@
 #include <thread>
 #include <queue>
 #include <mutex>
+#include <map>
+#include <vector>
+#include <condition_variable>
 #include "veigar/config.h"
 #include "veigar/msgpack.hpp"
 #include "veigar/call_result.h"
+#include "veigar/executor.h"
 #include "semaphore.h"
+#include "worker_group.h"
+#include "work_stealing_pool.h"
+#include "flow_control.h"
+#include "recv_buffer_pool.h"
 
 namespace veigar {
 class Veigar;
 class MessageQueue;
+struct Statistics;
 
 // Return the response message to the corresponding caller.
 class RespDispatcher {
@@ -31,18 +40,63 @@ class RespDispatcher {
     RespDispatcher(Veigar* veigar) noexcept;
     ~RespDispatcher() = default;
 
-    bool init();
+    // The credits of the calls are returned to 'flowControl' as they complete.
+    // The messages are received into buffers of 'bufferPool', shared with the call dispatcher.
+    bool init(std::shared_ptr<FlowControl> flowControl, std::shared_ptr<RecvBufferPool> bufferPool);
     bool isInit() const;
     void uninit();
 
     std::shared_ptr<MessageQueue> messageQueue();
 
+    // See Veigar::pollHandles and Veigar::processReady.
+    PollHandle pollHandle() const;
+    uint32_t processReady(uint32_t maxMessages);
+
+    // Completes the calls past their deadline with ErrorCode::TIMEOUT, for a thread-less instance (see Veigar::poll).
+    // Return the number of calls completed.
+    uint32_t expireDeadlines();
+
+    // The earliest deadline of the ongoing calls, monotonic microseconds, 0 = none.
+    int64_t earliestDeadline();
+
+    // Fills the response dispatcher part of the statistics.
+    void collectStatistics(Statistics& stats) const;
+
     void addOngoingCall(const std::string& callId, const ResultMeta& retMeta);
-    void releaseCall(const std::string& callId);
+
+    // Return false if the call is not ongoing, e.g. it has expired.
+    bool releaseCall(const std::string& callId);
+
+    // Completes the ongoing call with ErrorCode::CANCELLED, 'channel' is set to the channel the call was sent to.
+    // Return false if the call is not ongoing or has already completed.
+    bool cancelCall(const std::string& callId, std::string& channel);
 
    private:
     void dispatchRespThreadProc();
 
+    // Pops a message of the response queue and unpacks it into 'objs', 'backlog' is the number of messages left.
+    // Return false if the queue is empty, 'signaled' tells whether the queue was expected to have messages.
+    bool popResp(std::vector<veigar_msgpack::object_handle>& objs, int64_t& backlog, bool signaled);
+
+    // Completes the calls of the responses unpacked from a message.
+    void dispatchResps(std::vector<veigar_msgpack::object_handle>& objs);
+
+    // Hands a stream item (flag 3) over to the stream of the call.
+    void dispatchStreamItem(const std::string& callId, const veigar_msgpack::object& seqObj, const veigar_msgpack::object& item);
+
+    // Runs a result callback according to the callback policy.
+    // Waits while VEIGAR_CALLBACK_BACKLOG_LIMIT callbacks are pending, so that a slow callback slows down the responses
+    // instead of piling them up.
+    void runCallback(const ResultCallback& cb, CallResult& ret);
+
+    // Completes the calls that have passed their deadline.
+    void deadlineThreadProc();
+
+    // Moves the calls whose deadline is not after 'now' to 'expired'. The ongoing calls mutex must be held.
+    void takeExpired(int64_t now, std::vector<ResultMeta>& expired);
+    void completeExpired(std::vector<ResultMeta>& expired);
+    void removeDeadline(const std::string& callId, int64_t deadline);
+
    private:
     Veigar* veigar_ = nullptr;
     bool init_ = false;
@@ -50,10 +104,35 @@ class RespDispatcher {
     std::mutex ongoingCallsMutex_;
     std::unordered_map<std::string, ResultMeta> ongoingCalls_;  // call id -> ResultMeta
 
-    std::vector<std::thread> workers_;
+    WorkerGroup workers_;
+
+    // Guarded by ongoingCallsMutex_, the timer thread is started when the first call with deadline is added.
+    std::multimap<int64_t, std::string> deadlines_;  // deadline -> call id
+    std::condition_variable deadlineCV_;
+    std::thread deadlineThread_;
+
+    // The callbacks posted but not finished, shared with the posted tasks since a user executor may outlive the dispatcher.
+    struct CallbackBacklog {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int64_t count = 0;
+    };
+
+    CallbackPolicy callbackPolicy_ = CallbackPolicy::INLINE;
+    Executor callbackExecutor_;
+    std::shared_ptr<WorkStealingPool> callbackPool_;
+    std::shared_ptr<CallbackBacklog> callbackBacklog_;
+
+    std::shared_ptr<FlowControl> flowControl_;
+    std::shared_ptr<RecvBufferPool> bufferPool_;
 
     std::atomic_bool stop_ = { false };
     std::shared_ptr<MessageQueue> respMsgQueue_;
+
+    // See Veigar::setPollMode.
+    bool pollMode_ = false;
+    bool threadless_ = false;
+    std::mutex pollMutex_;
 };
 }  // namespace veigar
 
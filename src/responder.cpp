@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "veigar/responder.h"
+#include <atomic>
+#include "veigar/call_dispatcher.h"
+#include "log.h"
+
+namespace veigar {
+class Responder::State {
+   public:
+    State(const std::string& callId,
+          const std::string& callerChannelName,
+          std::weak_ptr<detail::CallDispatcher> dispatcher,
+          bool responded,
+          std::function<void()> onDone) noexcept :
+        callId_(callId),
+        callerChannelName_(callerChannelName),
+        dispatcher_(dispatcher),
+        responded_(responded),
+        onDone_(std::move(onDone)) {
+    }
+
+    ~State() {
+        if (responded_.exchange(true)) {
+            done();
+            return;
+        }
+
+        std::shared_ptr<detail::CallDispatcher> dispatcher = dispatcher_.lock();
+        if (dispatcher) {
+            veigar::log("Veigar: [WARNING] Responder of call %s has been destroyed without responding.\n", callId_.c_str());
+            dispatcher->sendResponse(callerChannelName_,
+                                     detail::Response::MakeResponseWithError(callId_, std::string("The function did not respond.")));
+        }
+        done();
+    }
+
+    void done() {
+        if (!done_.exchange(true) && onDone_) {
+            onDone_();
+        }
+    }
+
+    std::string callId_;
+    std::string callerChannelName_;
+    std::weak_ptr<detail::CallDispatcher> dispatcher_;
+    std::atomic_bool responded_;
+    std::function<void()> onDone_;
+    std::atomic_bool done_ = {false};
+};
+
+Responder::Responder(std::shared_ptr<State> state) noexcept :
+    state_(state) {
+}
+
+Responder Responder::Create(const std::string& callId,
+                            const std::string& callerChannelName,
+                            std::weak_ptr<detail::CallDispatcher> dispatcher,
+                            bool responded,
+                            std::function<void()> onDone) {
+    return Responder(std::make_shared<State>(callId, callerChannelName, dispatcher, responded, std::move(onDone)));
+}
+
+bool Responder::isValid() const {
+    return !!state_;
+}
+
+std::string Responder::callId() const {
+    return state_ ? state_->callId_ : std::string();
+}
+
+std::string Responder::callerChannelName() const {
+    return state_ ? state_->callerChannelName_ : std::string();
+}
+
+bool Responder::isResponded() const {
+    return state_ ? state_->responded_.load() : false;
+}
+
+bool Responder::respond() {
+    if (!claim()) {
+        return false;
+    }
+
+    return send(detail::Response::MakeResponseWithResult(callId(), detail::make_unique<veigar_msgpack::object_handle>()));
+}
+
+bool Responder::respondError(const std::string& errorMessage) {
+    if (!claim()) {
+        return false;
+    }
+
+    return send(detail::Response::MakeResponseWithError(callId(), errorMessage));
+}
+
+bool Responder::claim() {
+    if (!state_ || state_->responded_.exchange(true)) {
+        return false;
+    }
+
+    state_->done();
+    return true;
+}
+
+bool Responder::send(const detail::Response& resp) {
+    assert(state_);
+    std::shared_ptr<detail::CallDispatcher> dispatcher = state_->dispatcher_.lock();
+    if (!dispatcher) {
+        return false;
+    }
+
+    return dispatcher->sendResponse(state_->callerChannelName_, resp);
+}
+}  // namespace veigar
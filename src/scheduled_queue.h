@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_SCHEDULED_QUEUE_H_
+#define VEIGAR_SCHEDULED_QUEUE_H_
+#pragma once
+
+#include <deque>
+#include <map>
+#include <limits>
+#include <assert.h>
+#include "veigar/call_result.h"
+
+namespace veigar {
+// A queue of one priority lane, ordered by the SchedulingPolicy.
+// With SchedulingPolicy::EDF, the items without a deadline go last, the items with kImmediate first,
+// and the items with the same deadline are in FIFO order.
+// Not thread-safe.
+template <typename T>
+class ScheduledQueue {
+   public:
+    // A deadline that is served before all the others, e.g. for a message that must overtake the calls.
+    static constexpr int64_t kImmediate = -1;
+
+    // Only when the queue is empty.
+    void setPolicy(SchedulingPolicy policy) {
+        assert(empty());
+        policy_ = policy;
+    }
+
+    SchedulingPolicy policy() const {
+        return policy_;
+    }
+
+    // 'deadline' is the monotonic time in microseconds, 0 means none.
+    void push(const T& item, int64_t deadline) {
+        if (policy_ == SchedulingPolicy::EDF) {
+            // multimap inserts at the end of the range of equal keys.
+            edf_.emplace(Key(deadline), item);
+        }
+        else {
+            fifo_.push_back(item);
+        }
+    }
+
+    // Puts the item back in front of the items of the same deadline, e.g. one that could not be served yet.
+    void pushFront(const T& item, int64_t deadline) {
+        if (policy_ == SchedulingPolicy::EDF) {
+            const int64_t key = Key(deadline);
+            edf_.emplace_hint(edf_.lower_bound(key), key, item);
+        }
+        else {
+            fifo_.push_front(item);
+        }
+    }
+
+    bool empty() const {
+        return policy_ == SchedulingPolicy::EDF ? edf_.empty() : fifo_.empty();
+    }
+
+    size_t size() const {
+        return policy_ == SchedulingPolicy::EDF ? edf_.size() : fifo_.size();
+    }
+
+    // The item served first.
+    T& front() {
+        assert(!empty());
+        return policy_ == SchedulingPolicy::EDF ? edf_.begin()->second : fifo_.front();
+    }
+
+    void pop() {
+        assert(!empty());
+        if (policy_ == SchedulingPolicy::EDF) {
+            edf_.erase(edf_.begin());
+        }
+        else {
+            fifo_.pop_front();
+        }
+    }
+
+    // The item served last.
+    T& back() {
+        assert(!empty());
+        return policy_ == SchedulingPolicy::EDF ? std::prev(edf_.end())->second : fifo_.back();
+    }
+
+    void popBack() {
+        assert(!empty());
+        if (policy_ == SchedulingPolicy::EDF) {
+            edf_.erase(std::prev(edf_.end()));
+        }
+        else {
+            fifo_.pop_back();
+        }
+    }
+
+    // Removes the first item (in serving order) that matches 'pred'.
+    template <typename Pred>
+    bool removeIf(Pred pred, T& removed) {
+        if (policy_ == SchedulingPolicy::EDF) {
+            for (auto it = edf_.begin(); it != edf_.end(); ++it) {
+                if (pred(it->second)) {
+                    removed = it->second;
+                    edf_.erase(it);
+                    return true;
+                }
+            }
+        }
+        else {
+            for (auto it = fifo_.begin(); it != fifo_.end(); ++it) {
+                if (pred(*it)) {
+                    removed = *it;
+                    fifo_.erase(it);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void clear() {
+        fifo_.clear();
+        edf_.clear();
+    }
+
+   private:
+    static int64_t Key(int64_t deadline) {
+        if (deadline == kImmediate) {
+            return std::numeric_limits<int64_t>::min();
+        }
+        return deadline > 0 ? deadline : std::numeric_limits<int64_t>::max();
+    }
+
+    SchedulingPolicy policy_ = SchedulingPolicy::FIFO;
+    std::deque<T> fifo_;
+    std::multimap<int64_t, T> edf_;  // deadline -> item
+};
+}  // namespace veigar
+#endif  // !VEIGAR_SCHEDULED_QUEUE_H_
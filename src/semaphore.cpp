@@ -164,4 +164,9 @@ void Semaphore::release() {
     }
 }
 
+#ifdef VEIGAR_OS_WINDOWS
+HANDLE Semaphore::nativeHandle() const {
+    return sh_ ? sh_->h_ : NULL;
+}
+#endif
 }  // namespace veigar
\ No newline at end of file
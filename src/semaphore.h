@@ -52,6 +52,10 @@ class Semaphore {
     bool wait(const int64_t& ms);  // semaphore - 1 , timeout ms
     void release();                // semaphore + 1
 
+#ifdef VEIGAR_OS_WINDOWS
+    HANDLE nativeHandle() const;
+#endif
+
    private:
     bool creator_ = false;
     SemaphoreHandle* sh_ = nullptr;
@@ -6,6 +6,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 #include "sender.h"
+#include <assert.h>
+#include <algorithm>
+#include <future>
+#include <random>
+#include <thread>
 #include "log.h"
 #include "string_helper.h"
 #include "veigar/veigar.h"
@@ -13,12 +18,28 @@
 #include "run_time_recorder.h"
 
 namespace veigar {
+// Stream credits (4) and cancellations (6) are packed as a msgpack array of 5 with the flag first.
+// Losing them stalls a stream or loses a cancellation, so QueueFullPolicy::DROP_OLDEST must keep them.
+static bool IsControlMessage(const uint8_t* data, size_t dataSize) {
+    return data && dataSize >= 2 && data[0] == 0x95 && (data[1] == 4 || data[1] == 6);
+}
+
+// The control messages carry no deadline, under SchedulingPolicy::EDF they still go before the calls of their lane.
+static int64_t ScheduledDeadline(const Sender::CallMeta& cm) {
+    if (IsControlMessage(cm.data, cm.dataSize)) {
+        return ScheduledQueue<Sender::CallMeta>::kImmediate;
+    }
+    return cm.deadline;
+}
+
 Sender::Sender(Veigar* v) noexcept :
-    veigar_(v) {
+    veigar_(v),
+    callSelector_(kCallPriorityNumber) {
 }
 
 bool Sender::init(std::shared_ptr<RespDispatcher> respDisp,
-                  std::shared_ptr<MessageQueue> selfCallMQ,
+                  std::shared_ptr<FlowControl> flowControl,
+                  const std::vector<std::shared_ptr<MessageQueue>>& selfCallMQs,
                   std::shared_ptr<MessageQueue> selfRespMQ) {
     if (isInit_)
         return true;
@@ -26,15 +47,32 @@ bool Sender::init(std::shared_ptr<RespDispatcher> respDisp,
     stopEvent_.reset();
 
     respDisp_ = respDisp;
-    selfCallMQ_ = selfCallMQ;
+    flowControl_ = flowControl;
+    selfCallMQs_ = std::make_shared<const CallQueueShards>(selfCallMQs);
     selfRespMQ_ = selfRespMQ;
 
-    for (size_t i = 0; i < VEIGAR_SEND_CALL_THREAD_NUMBER; ++i) {
-        callWorkers_.emplace_back(std::thread(&Sender::sendCallThreadProc, this));
+    callSelector_.setPolicy(veigar_->priorityPolicy());
+    for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+        callList_[i].setPolicy(veigar_->schedulingPolicy());
     }
-
-    for (size_t i = 0; i < VEIGAR_SEND_RESPONSE_THREAD_NUMBER; ++i) {
-        respWorkers_.emplace_back(std::thread(&Sender::sendRespThreadProc, this));
+    limit_ = veigar_->sendQueueLimit();
+    shardPolicy_ = veigar_->shardPolicy();
+    callerHash_ = std::hash<std::string>()(veigar_->channelName());
+
+    const std::vector<uint32_t> cpus = veigar_->cpuAffinity(ThreadRole::SENDER);
+    callWorkers_.setPlacement("veigar-snd-call", cpus);
+    respWorkers_.setPlacement("veigar-snd-resp", cpus);
+
+    // A thread-less instance sends from Veigar::poll.
+    threadless_ = veigar_->threadless();
+    if (!threadless_) {
+        callWorkers_.start(VEIGAR_SEND_CALL_MIN_THREAD_NUMBER,
+                           VEIGAR_SEND_CALL_THREAD_NUMBER,
+                           std::bind(&Sender::sendCallThreadProc, this));
+
+        respWorkers_.start(VEIGAR_SEND_RESPONSE_MIN_THREAD_NUMBER,
+                           VEIGAR_SEND_RESPONSE_THREAD_NUMBER,
+                           std::bind(&Sender::sendRespThreadProc, this));
     }
 
     isInit_ = true;
@@ -44,26 +82,26 @@ bool Sender::init(std::shared_ptr<RespDispatcher> respDisp,
 
 void Sender::uninit() {
     stopEvent_.set();
+    flowControl_->stop();
+
+    callListMutex_.lock();
+    callListSpaceCV_.notify_all();
+    callListMutex_.unlock();
+
+    respListMutex_.lock();
+    respListSpaceCV_.notify_all();
+    respListMutex_.unlock();
 
     callListSetEvent_.cancel();
     respListSetEvent_.cancel();
 
-    for (std::thread& w : callWorkers_) {
-        if (w.joinable()) {
-            w.join();
-        }
-    }
-
-    for (std::thread& w : respWorkers_) {
-        if (w.joinable()) {
-            w.join();
-        }
-    }
+    callWorkers_.stop();
+    respWorkers_.stop();
 
     targetCallMQsMutex_.lock();
     for (auto it : targetCallMsgQueues_) {
-        if (it.second) {
-            it.second->close();
+        for (const std::shared_ptr<MessageQueue>& queue : *it.second) {
+            queue->close();
         }
     }
     targetCallMsgQueues_.clear();
@@ -80,28 +118,35 @@ void Sender::uninit() {
 
     // release all calls memory
     callListMutex_.lock();
-    while (!callList_.empty()) {
-        CallMeta cm = callList_.front();
-        if (cm.data) {
-            free(cm.data);
+    for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+        while (!callList_[i].empty()) {
+            CallMeta cm = callList_[i].front();
+            if (cm.data) {
+                free(cm.data);
+            }
+            callList_[i].pop();
         }
-        callList_.pop();
     }
+    callListNumber_ = 0;
+    callListBytes_ = 0;
+    sendingCalls_.clear();
+    cancelledSendingCalls_.clear();
     callListMutex_.unlock();
 
     // release all responses memory
     respListMutex_.lock();
-    while (!callList_.empty()) {
+    while (!respList_.empty()) {
         RespMeta rm = respList_.front();
         if (rm.data) {
             free(rm.data);
         }
-        respList_.pop();
+        respList_.pop_front();
     }
+    respListBytes_ = 0;
     respListMutex_.unlock();
 
     respDisp_.reset();
-    selfCallMQ_.reset();
+    selfCallMQs_.reset();
     selfRespMQ_.reset();
 
     isInit_ = false;
@@ -111,39 +156,299 @@ bool Sender::isInit() const {
     return isInit_;
 }
 
-void Sender::addCall(const Sender::CallMeta& cm) {
-    callListMutex_.lock();
-    callList_.emplace(cm);
-    callListMutex_.unlock();
+ErrorCode Sender::addCall(const Sender::CallMeta& cm, std::string& errMsg) {
+    assert((uint32_t)cm.priority < kCallPriorityNumber);
+
+    // Notifications have no response to return the credit.
+    // A thread-less instance does not wait, the credits are only returned by Veigar::poll, likely on this very thread.
+    if (cm.resultMeta.metaType != 2) {
+        if (!flowControl_->acquire(cm.callId, cm.channel, (int64_t)cm.dataSize, threadless_ ? 0 : cm.startCallTimePoint + cm.timeout)) {
+            if (threadless_) {
+                errMsg = "The target has no credit left.";
+                return ErrorCode::BUSY;
+            }
+            errMsg = "Waiting for credit of the target timeout.";
+            return ErrorCode::TIMEOUT;
+        }
+    }
+
+    std::vector<CallMeta> dropped;
+    {
+        std::unique_lock<std::mutex> ul(callListMutex_);
+        while (isListFull(callListNumber_, callListBytes_, cm.dataSize)) {
+            // Like the credits, the send queue of a thread-less instance is only drained by Veigar::poll.
+            if (limit_.policy == SendQueuePolicy::FAIL_FAST || (limit_.policy == SendQueuePolicy::BLOCK && threadless_)) {
+                rejectedCallNumber_++;
+                flowControl_->release(cm.callId);
+                errMsg = "The send queue is full.";
+                return ErrorCode::BUSY;
+            }
+
+            if (limit_.policy == SendQueuePolicy::DROP_OLDEST) {
+                for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+                    if (!callList_[i].empty()) {
+                        // Under EDF the oldest call may be the most urgent one, drop the one that would be sent last.
+                        if (callList_[i].policy() == SchedulingPolicy::EDF) {
+                            dropped.push_back(callList_[i].back());
+                            callList_[i].popBack();
+                        }
+                        else {
+                            dropped.push_back(callList_[i].front());
+                            callList_[i].pop();
+                        }
+                        callListNumber_--;
+                        callListBytes_ -= (int64_t)dropped.back().dataSize;
+                        droppedCallNumber_++;
+                        break;
+                    }
+                }
+                continue;
+            }
+
+            const int64_t remain = cm.startCallTimePoint + cm.timeout - TimeUtil::GetCurrentTimestamp();
+            if (remain <= 0 || stopEvent_.isSet()) {
+                rejectedCallNumber_++;
+                flowControl_->release(cm.callId);
+                errMsg = "Waiting for send queue space timeout.";
+                return ErrorCode::TIMEOUT;
+            }
+            callListSpaceCV_.wait_for(ul, std::chrono::microseconds(remain));
+        }
+
+        callList_[(uint32_t)cm.priority].push(cm, ScheduledDeadline(cm));
+        callListNumber_++;
+        callListBytes_ += (int64_t)cm.dataSize;
+    }
 
     callListSetEvent_.set();
+
+    for (CallMeta& d : dropped) {
+        flowControl_->release(d.callId);
+        failCall(d, ErrorCode::BUSY, "Dropped from the full send queue for a newer call.");
+        if (d.data) {
+            free(d.data);
+        }
+    }
+
+    return ErrorCode::SUCCESS;
 }
 
-void Sender::addResp(const Sender::RespMeta& rm) {
-    respListMutex_.lock();
-    respList_.emplace(rm);
-    respListMutex_.unlock();
+bool Sender::addResp(const Sender::RespMeta& rm, std::string& errMsg) {
+    std::vector<RespMeta> dropped;
+    {
+        std::unique_lock<std::mutex> ul(respListMutex_);
+        while (isListFull((int64_t)respList_.size(), respListBytes_, rm.dataSize)) {
+            if (limit_.policy == SendQueuePolicy::FAIL_FAST || (limit_.policy == SendQueuePolicy::BLOCK && threadless_)) {
+                rejectedRespNumber_++;
+                errMsg = "The send queue is full.";
+                return false;
+            }
+
+            if (limit_.policy == SendQueuePolicy::DROP_OLDEST) {
+                dropped.push_back(respList_.front());
+                respList_.pop_front();
+                respListBytes_ -= (int64_t)dropped.back().dataSize;
+                droppedRespNumber_++;
+                continue;
+            }
+
+            const int64_t remain = rm.startCallTimePoint + rm.timeout - TimeUtil::GetCurrentTimestamp();
+            if (remain <= 0 || stopEvent_.isSet()) {
+                rejectedRespNumber_++;
+                errMsg = "Waiting for send queue space timeout.";
+                return false;
+            }
+            respListSpaceCV_.wait_for(ul, std::chrono::microseconds(remain));
+        }
+
+        respList_.emplace_back(rm);
+        respListBytes_ += (int64_t)rm.dataSize;
+    }
 
     respListSetEvent_.set();
+
+    if (!dropped.empty()) {
+        veigar::log("Veigar: [WARNING] %d responses have been dropped from the full send queue.\n", (int)dropped.size());
+        for (RespMeta& d : dropped) {
+            if (d.data) {
+                free(d.data);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool Sender::cancelCall(const std::string& callId) {
+    CallMeta cm;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lg(callListMutex_);
+        for (uint32_t i = 0; i < kCallPriorityNumber && !found; ++i) {
+            // Not a notification, which would also match the cancel message of the call itself.
+            found = callList_[i].removeIf([&callId](const CallMeta& c) { return c.callId == callId && c.resultMeta.metaType != 2; }, cm);
+        }
+
+        if (found) {
+            callListNumber_--;
+            callListBytes_ -= (int64_t)cm.dataSize;
+            callListSpaceCV_.notify_one();
+        }
+        else if (sendingCalls_.count(callId) > 0) {
+            // Its sender completes it in claimCall or requeueCall.
+            return cancelledSendingCalls_.insert(callId).second;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    completeCancelled(cm);
+    return true;
+}
+
+bool Sender::claimCall(const CallMeta& cm) {
+    std::lock_guard<std::mutex> lg(callListMutex_);
+    sendingCalls_.erase(cm.callId);
+    if (cancelledSendingCalls_.erase(cm.callId) > 0) {
+        return false;
+    }
+
+    // Under the list mutex, so that Veigar::cancel finds the call either here or in the RespDispatcher.
+    if (cm.resultMeta.metaType != 2) {
+        respDisp_->addOngoingCall(cm.callId, cm.resultMeta);
+    }
+    return true;
+}
+
+bool Sender::forgetSendingCall(const std::string& callId) {
+    std::lock_guard<std::mutex> lg(callListMutex_);
+    sendingCalls_.erase(callId);
+    return cancelledSendingCalls_.erase(callId) > 0;
+}
+
+void Sender::completeCancelled(CallMeta& cm) {
+    flowControl_->release(cm.callId);
+    failCall(cm, ErrorCode::CANCELLED, "The call has been cancelled.");
+    if (cm.data) {
+        free(cm.data);
+        cm.data = nullptr;
+    }
+}
+
+bool Sender::isListFull(int64_t number, int64_t bytes, size_t needSize) const {
+    // A message larger than maxBytes is still accepted by an empty queue.
+    if (number == 0) {
+        return false;
+    }
+
+    if (limit_.maxNumber > 0 && number >= (int64_t)limit_.maxNumber) {
+        return true;
+    }
+
+    return limit_.maxBytes > 0 && (uint64_t)bytes + needSize > limit_.maxBytes;
+}
+
+void Sender::failCall(CallMeta& cm, ErrorCode ec, const std::string& errMsg) {
+    if (cm.resultMeta.metaType == 2) {
+        veigar::log("Veigar: [WARNING] Send notification %s failed: %s\n", cm.callId.c_str(), errMsg.c_str());
+        return;
+    }
+
+    CallResult failedRet;
+    failedRet.errCode = ec;
+    failedRet.errorMessage = errMsg;
+
+    if (cm.resultMeta.metaType == 0) {
+        if (cm.resultMeta.p) {
+            // The caller may have completed it already, e.g. by cancelling it.
+            try {
+                cm.resultMeta.p->set_value(std::move(failedRet));
+            } catch (std::future_error&) {
+            }
+        }
+    }
+    else if (cm.resultMeta.metaType == 1 || cm.resultMeta.metaType == 3) {
+        if (cm.resultMeta.cb) {
+            cm.resultMeta.cb(failedRet);
+        }
+    }
+}
+
+void Sender::collectStatistics(Statistics& stats) const {
+    ThreadStatistics& ts = stats.threads[(uint32_t)ThreadRole::SENDER];
+    ts.threadNumber = callWorkers_.size() + respWorkers_.size();
+    ts.busyThreadNumber = callWorkers_.busy() + respWorkers_.busy();
+    ts.cpus = callWorkers_.cpus();
+    ts.pinFailedThreadNumber = callWorkers_.pinFailed() + respWorkers_.pinFailed();
+
+    if (flowControl_) {
+        flowControl_->collectStatistics(stats);
+    }
+
+    std::lock_guard<std::mutex> clg(callListMutex_);
+    stats.callSendQueue.number = callListNumber_;
+    stats.callSendQueue.bytes = callListBytes_;
+    stats.callSendQueue.rejectedNumber = rejectedCallNumber_.load();
+    stats.callSendQueue.droppedNumber = droppedCallNumber_.load();
+
+    std::lock_guard<std::mutex> rlg(respListMutex_);
+    stats.responseSendQueue.number = (int64_t)respList_.size();
+    stats.responseSendQueue.bytes = respListBytes_;
+    stats.responseSendQueue.rejectedNumber = rejectedRespNumber_.load();
+    stats.responseSendQueue.droppedNumber = droppedRespNumber_.load();
 }
 
-std::shared_ptr<MessageQueue> Sender::getTargetCallMessageQueue(const std::string& channelName) {
+std::shared_ptr<const Sender::CallQueueShards> Sender::getTargetCallMessageQueues(const std::string& channelName) {
     std::lock_guard<std::mutex> lg(targetCallMQsMutex_);
-    std::shared_ptr<MessageQueue> queue = nullptr;
     auto it = targetCallMsgQueues_.find(channelName);
     if (it != targetCallMsgQueues_.cend()) {
         return it->second;
     }
 
-    queue = std::make_shared<MessageQueue>(veigar_->msgQueueCapacity(), veigar_->expectedMsgMaxSize());
-    if (!queue->open(channelName + VEIGAR_CALL_QUEUE_NAME_SUFFIX)) {
-        queue.reset();
-        veigar::log("Veigar: Error: Open call message queue(%s) failed.\n", channelName.c_str());
+    std::shared_ptr<CallQueueShards> shards = std::make_shared<CallQueueShards>();
+    uint32_t shardNumber = 1;
+    for (uint32_t i = 0; i < shardNumber; ++i) {
+        std::shared_ptr<MessageQueue> queue = std::make_shared<MessageQueue>(veigar_->msgQueueCapacity(), veigar_->expectedMsgMaxSize(), kCallPriorityNumber);
+        if (!queue->open(detail::CallDispatcher::CallQueueName(channelName, i))) {
+            veigar::log("Veigar: Error: Open call message queue(%s, shard %u) failed.\n", channelName.c_str(), i);
+            return nullptr;
+        }
+
+        // The first shard tells how many there are.
+        if (i == 0) {
+            shardNumber = std::min(queue->shardNumber(), (uint32_t)VEIGAR_CALL_QUEUE_MAX_SHARD_NUMBER);
+        }
+        shards->push_back(queue);
+    }
+
+    targetCallMsgQueues_[channelName] = shards;
+    return shards;
+}
+
+std::shared_ptr<MessageQueue> Sender::pickShard(const CallQueueShards& shards) {
+    if (shards.empty()) {
         return nullptr;
     }
 
-    targetCallMsgQueues_[channelName] = queue;
-    return queue;
+    if (shards.size() == 1) {
+        return shards[0];
+    }
+
+    if (shardPolicy_ == ShardPolicy::CALLER_HASH) {
+        return shards[callerHash_ % shards.size()];
+    }
+
+    // Two random choices are nearly as good as the least deep of all shards.
+    // The depths are read without the locks of the shards, a stale depth only makes the choice a bit worse.
+    thread_local std::minstd_rand rng((uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()));
+    const size_t first = rng() % shards.size();
+    const size_t second = (first + 1 + rng() % (shards.size() - 1)) % shards.size();
+
+    auto depth = [](const std::shared_ptr<MessageQueue>& mq) { return mq->msgNumberHint(); };
+
+    return depth(shards[second]) < depth(shards[first]) ? shards[second] : shards[first];
 }
 
 std::shared_ptr<MessageQueue> Sender::getTargetRespMessageQueue(const std::string& channelName) {
@@ -166,204 +471,408 @@ std::shared_ptr<MessageQueue> Sender::getTargetRespMessageQueue(const std::strin
 }
 
 void Sender::sendCallThreadProc() {
-    std::string errMsg;
+    int64_t idleSince = TimeUtil::GetCurrentTimestamp();
     while (true) {
-        if (!callListSetEvent_.wait(30))
+        if (!callListSetEvent_.wait(30)) {
+            if (TimeUtil::GetCurrentTimestamp() - idleSince >= (int64_t)VEIGAR_WORKER_IDLE_TIMEOUT * 1000) {
+                if (callWorkers_.retire())
+                    break;
+                idleSince = TimeUtil::GetCurrentTimestamp();
+            }
             continue;
+        }
 
         if (callListSetEvent_.isCancelled())
             break;
 
         callListSetEvent_.unset();
 
+        callWorkers_.enterBusy();
+
         for (;;) {
             if (callListSetEvent_.isCancelled())
                 break;
 
             CallMeta cm;
-            callListMutex_.lock();
-            if (callList_.empty()) {
-                callListMutex_.unlock();
+            int64_t backlog = 0;
+            if (!popCall(cm, backlog)) {
                 break;
             }
-            cm = callList_.front();
-            callList_.pop();
-            callListMutex_.unlock();
-
-            respDisp_->addOngoingCall(cm.callId, cm.resultMeta);
-
-            ErrorCode ec = ErrorCode::FAILED;
-            std::shared_ptr<MessageQueue> mq = nullptr;
-            try {
-                errMsg.clear();
-
-                if (cm.channel == veigar_->channelName()) {
-                    mq = selfCallMQ_;
-                }
-                else {
-                    mq = getTargetCallMessageQueue(cm.channel);
-                }
-
-                if (mq) {
-                    if (mq->processRWLock(veigar_->timeoutOfRWLock())) {
-                        if (checkSpaceAndWait(mq, cm.dataSize, cm.startCallTimePoint, cm.timeout)) {
-                            if (mq->pushBack(cm.data, cm.dataSize)) {
-                                mq->notifyRead();
-                                ec = ErrorCode::SUCCESS;
-                            }
-                            else {
-                                errMsg = "Unable to push message to queue.";
-                            }
-                        }
-                        else {
-                            ec = ErrorCode::TIMEOUT;
-                            errMsg = "Waiting for call queue availability timeout.";
-                        }
-                        mq->processRWUnlock();
-                    }
-                    else {
-                        ec = ErrorCode::TIMEOUT;
-                        errMsg = "Get rw-lock timeout when push call.";
-                    }
-                }
-                else {
-                    errMsg = "Unable to get target message queue. It seems that the channel not started.";
-                }
-
-            } catch (std::exception& e) {
-                if (mq) {
-                    mq->processRWUnlock();  // always try to unlock again
-                }
-                veigar::log("Veigar: Error: An exception occurred during pushing message to call queue: %s.\n", e.what());
-                errMsg = StringHelper::StringPrintf("An exception occurred during pushing message to call queue: %s.", e.what());
-            } catch (...) {
-                if (mq) {
-                    mq->processRWUnlock();  // always try to unlock again
-                }
-                veigar::log("Veigar: Error: An exception occurred during pushing message to call queue.\n");
-                errMsg = "An exception occurred during pushing message to call queue.";
-            }
 
-            if (ec != ErrorCode::SUCCESS) {
-                respDisp_->releaseCall(cm.callId);
-
-                CallResult failedRet;
-                failedRet.errCode = ec;
-                failedRet.errorMessage = errMsg;
-
-                if (cm.resultMeta.metaType == 0) {
-                    if (cm.resultMeta.p) {
-                        cm.resultMeta.p->set_value(std::move(failedRet));
-                    }
-                }
-                else if (cm.resultMeta.metaType == 1) {
-                    if (cm.resultMeta.cb) {
-                        cm.resultMeta.cb(failedRet);
-                    }
-                }
+            if (callWorkers_.grow(backlog)) {
+                callListSetEvent_.set();  // let the new worker see the backlog
             }
 
-            if (cm.data) {
-                free(cm.data);
-            }
+            sendCall(cm, true);
         }
+
+        callWorkers_.leaveBusy();
+        idleSince = TimeUtil::GetCurrentTimestamp();
     }
 }
 
 void Sender::sendRespThreadProc() {
-    std::string errMsg;
+    int64_t idleSince = TimeUtil::GetCurrentTimestamp();
     while (true) {
-        if (!respListSetEvent_.wait(30))
+        if (!respListSetEvent_.wait(30)) {
+            if (TimeUtil::GetCurrentTimestamp() - idleSince >= (int64_t)VEIGAR_WORKER_IDLE_TIMEOUT * 1000) {
+                if (respWorkers_.retire())
+                    break;
+                idleSince = TimeUtil::GetCurrentTimestamp();
+            }
             continue;
+        }
 
         if (respListSetEvent_.isCancelled())
             break;
 
         respListSetEvent_.unset();
 
+        respWorkers_.enterBusy();
+
         for (;;) {
             if (respListSetEvent_.isCancelled())
                 break;
 
             RespMeta rm;
-            respListMutex_.lock();
-            if (respList_.empty()) {
-                respListMutex_.unlock();
+            int64_t backlog = 0;
+            if (!popResp(rm, backlog)) {
                 break;
             }
-            rm = respList_.front();
-            respList_.pop();
-            respListMutex_.unlock();
 
-            ErrorCode ec = ErrorCode::FAILED;
-            std::shared_ptr<MessageQueue> mq = nullptr;
-            try {
-                errMsg.clear();
+            if (respWorkers_.grow(backlog)) {
+                respListSetEvent_.set();  // let the new worker see the backlog
+            }
 
-                if (rm.channel == veigar_->channelName()) {
-                    mq = selfRespMQ_;
-                }
-                else {
-                    mq = getTargetRespMessageQueue(rm.channel);
-                }
+            sendResp(rm, true);
+        }
+
+        respWorkers_.leaveBusy();
+        idleSince = TimeUtil::GetCurrentTimestamp();
+    }
+}
+
+uint32_t Sender::flush(uint32_t maxMessages) {
+    if (!isInit_ || stopEvent_.isSet()) {
+        return 0;
+    }
+
+    uint32_t sent = 0;
+    int64_t backlog = 0;
+    while (maxMessages == 0 || sent < maxMessages) {
+        CallMeta cm;
+        if (!popCall(cm, backlog)) {
+            break;
+        }
+
+        // The target call queue is full, the call and the ones behind it wait for the next flush.
+        if (!sendCall(cm, false)) {
+            if (requeueCall(cm)) {
+                break;
+            }
+            completeCancelled(cm);
+        }
+        sent++;
+    }
+
+    while (maxMessages == 0 || sent < maxMessages) {
+        RespMeta rm;
+        if (!popResp(rm, backlog)) {
+            break;
+        }
+
+        if (!sendResp(rm, false)) {
+            requeueResp(rm);
+            break;
+        }
+        sent++;
+    }
+
+    return sent;
+}
+
+bool Sender::hasPending() const {
+    {
+        std::lock_guard<std::mutex> lg(callListMutex_);
+        if (callListNumber_ > 0) {
+            return true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lg(respListMutex_);
+    return !respList_.empty();
+}
+
+bool Sender::popCall(CallMeta& cm, int64_t& backlog) {
+    std::lock_guard<std::mutex> lg(callListMutex_);
+    const int32_t lane = callSelector_.select([this](uint32_t l) { return !callList_[l].empty(); });
+    if (lane < 0) {
+        return false;
+    }
+
+    cm = callList_[lane].front();
+    callList_[lane].pop();
+    if (cm.resultMeta.metaType != 2) {
+        sendingCalls_.insert(cm.callId);
+    }
+    callListNumber_--;
+    callListBytes_ -= (int64_t)cm.dataSize;
+    callListSpaceCV_.notify_one();
+    callSelector_.served((uint32_t)lane);
+
+    backlog = 0;
+    for (uint32_t i = 0; i < kCallPriorityNumber; ++i) {
+        backlog += (int64_t)callList_[i].size();
+    }
+    return true;
+}
+
+bool Sender::requeueCall(const CallMeta& cm) {
+    std::lock_guard<std::mutex> lg(callListMutex_);
+    sendingCalls_.erase(cm.callId);
+    if (cancelledSendingCalls_.erase(cm.callId) > 0) {
+        return false;
+    }
+
+    callList_[(uint32_t)cm.priority].pushFront(cm, ScheduledDeadline(cm));
+    callListNumber_++;
+    callListBytes_ += (int64_t)cm.dataSize;
+    return true;
+}
+
+bool Sender::popResp(RespMeta& rm, int64_t& backlog) {
+    std::lock_guard<std::mutex> lg(respListMutex_);
+    if (respList_.empty()) {
+        return false;
+    }
 
-                if (mq) {
-                    if (mq->processRWLock(veigar_->timeoutOfRWLock())) {
-                        if (checkSpaceAndWait(mq, rm.dataSize, rm.startCallTimePoint, rm.timeout)) {
-                            if (mq->pushBack(rm.data, rm.dataSize)) {
-                                mq->notifyRead();
-                                ec = ErrorCode::SUCCESS;
-                            }
-                            else {
-                                errMsg = "Unable to push message to response queue.";
-                            }
+    rm = respList_.front();
+    respList_.pop_front();
+    respListBytes_ -= (int64_t)rm.dataSize;
+    respListSpaceCV_.notify_one();
+    backlog = (int64_t)respList_.size();
+    return true;
+}
+
+void Sender::requeueResp(const RespMeta& rm) {
+    std::lock_guard<std::mutex> lg(respListMutex_);
+    respList_.push_front(rm);
+    respListBytes_ += (int64_t)rm.dataSize;
+}
+
+bool Sender::sendCall(CallMeta& cm, bool wait) {
+    std::string errMsg;
+    ErrorCode ec = ErrorCode::FAILED;
+    bool registered = false;
+    bool claimed = false;
+
+    // Notifications have no response to wait for.
+    // Without waiting, the call is only registered once it is sure to be pushed, since it may be kept for the next flush.
+    if (wait) {
+        claimed = true;
+        if (!claimCall(cm)) {
+            completeCancelled(cm);
+            return true;
+        }
+        registered = cm.resultMeta.metaType != 2;
+    }
+
+    std::shared_ptr<MessageQueue> mq = nullptr;
+    try {
+        std::shared_ptr<const CallQueueShards> shards =
+            cm.channel == veigar_->channelName() ? selfCallMQs_ : getTargetCallMessageQueues(cm.channel);
+        if (shards) {
+            mq = pickShard(*shards);
+        }
+
+        if (mq) {
+            if (mq->processRWLock(veigar_->timeoutOfRWLock())) {
+                bool full = false;
+                bool rejected = false;
+                if (wait ? checkSpaceAndWait(mq, cm.dataSize, cm.startCallTimePoint, cm.timeout, rejected, (uint32_t)cm.priority)
+                         : checkSpace(mq, cm.dataSize, cm.startCallTimePoint, cm.timeout, full, rejected, (uint32_t)cm.priority)) {
+                    const bool cancelled = !claimed && !claimCall(cm);
+                    claimed = true;
+                    if (cancelled) {
+                        ec = ErrorCode::CANCELLED;
+                        errMsg = "The call has been cancelled.";
+                    }
+                    else {
+                        registered = cm.resultMeta.metaType != 2;
+                        if (mq->pushBack(cm.data, cm.dataSize, (uint32_t)cm.priority, !IsControlMessage(cm.data, cm.dataSize))) {
+                            mq->notifyRead();
+                            ec = ErrorCode::SUCCESS;
                         }
                         else {
-                            ec = ErrorCode::TIMEOUT;
-                            errMsg = "Waiting for response queue availability timeout.";
+                            errMsg = "Unable to push message to queue.";
                         }
-                        mq->processRWUnlock();
-                    }
-                    else {
-                        ec = ErrorCode::TIMEOUT;
-                        errMsg = "Get rw-lock timeout when push response.";
                     }
                 }
+                else if (full) {
+                    mq->processRWUnlock();
+                    return false;
+                }
+                else if (rejected) {
+                    ec = ErrorCode::OVERLOADED;
+                    errMsg = "The call queue of the target is full.";
+                }
                 else {
-                    errMsg = "Unable to get target message queue. It seems that the channel not started.";
+                    ec = ErrorCode::TIMEOUT;
+                    errMsg = "Waiting for call queue availability timeout.";
                 }
+                mq->processRWUnlock();
+            }
+            else {
+                ec = ErrorCode::TIMEOUT;
+                errMsg = "Get rw-lock timeout when push call.";
+            }
+        }
+        else {
+            errMsg = "Unable to get target message queue. It seems that the channel not started.";
+        }
+
+    } catch (std::exception& e) {
+        if (mq) {
+            mq->processRWUnlock();  // always try to unlock again
+        }
+        veigar::log("Veigar: Error: An exception occurred during pushing message to call queue: %s.\n", e.what());
+        errMsg = StringHelper::StringPrintf("An exception occurred during pushing message to call queue: %s.", e.what());
+    } catch (...) {
+        if (mq) {
+            mq->processRWUnlock();  // always try to unlock again
+        }
+        veigar::log("Veigar: Error: An exception occurred during pushing message to call queue.\n");
+        errMsg = "An exception occurred during pushing message to call queue.";
+    }
+
+    if (ec != ErrorCode::SUCCESS && !claimed && forgetSendingCall(cm.callId)) {
+        ec = ErrorCode::CANCELLED;
+        errMsg = "The call has been cancelled.";
+    }
+
+    if (ec != ErrorCode::SUCCESS && cm.resultMeta.metaType == 2) {
+        failCall(cm, ec, errMsg);
+    }
+    else if (ec != ErrorCode::SUCCESS) {
+        flowControl_->release(cm.callId);
+
+        // The call may have been completed by its deadline or cancelled while waiting for the queue,
+        // only the thread that takes it out of the ongoing calls completes it.
+        const bool ongoing = registered ? respDisp_->releaseCall(cm.callId) : true;
+        if (ongoing) {
+            failCall(cm, ec, errMsg);
+        }
+    }
+
+    if (cm.data) {
+        free(cm.data);
+    }
+    return true;
+}
 
-            } catch (std::exception& e) {
-                if (mq) {
-                    mq->processRWUnlock();  // always try to unlock again
+bool Sender::sendResp(RespMeta& rm, bool wait) {
+    std::string errMsg;
+    ErrorCode ec = ErrorCode::FAILED;
+    std::shared_ptr<MessageQueue> mq = nullptr;
+    try {
+        if (rm.channel == veigar_->channelName()) {
+            mq = selfRespMQ_;
+        }
+        else {
+            mq = getTargetRespMessageQueue(rm.channel);
+        }
+
+        if (mq) {
+            if (mq->processRWLock(veigar_->timeoutOfRWLock())) {
+                bool full = false;
+                bool rejected = false;
+                if (wait ? checkSpaceAndWait(mq, rm.dataSize, rm.startCallTimePoint, rm.timeout, rejected)
+                         : checkSpace(mq, rm.dataSize, rm.startCallTimePoint, rm.timeout, full, rejected)) {
+                    if (mq->pushBack(rm.data, rm.dataSize)) {
+                        mq->notifyRead();
+                        ec = ErrorCode::SUCCESS;
+                    }
+                    else {
+                        errMsg = "Unable to push message to response queue.";
+                    }
                 }
-                errMsg = StringHelper::StringPrintf("An exception occurred during pushing message to response queue: %s.", e.what());
-            } catch (...) {
-                if (mq) {
-                    mq->processRWUnlock();  // always try to unlock again
+                else if (full) {
+                    mq->processRWUnlock();
+                    return false;
                 }
-                errMsg = "An exception occurred during parsing pushing message to response queue.";
+                else if (rejected) {
+                    ec = ErrorCode::OVERLOADED;
+                    errMsg = "The response queue of the target is full.";
+                }
+                else {
+                    ec = ErrorCode::TIMEOUT;
+                    errMsg = "Waiting for response queue availability timeout.";
+                }
+                mq->processRWUnlock();
             }
-
-            if (ec != ErrorCode::SUCCESS) {
-                veigar::log("Veigar: Error: Send response failed: %s\n", errMsg.c_str());
+            else {
+                ec = ErrorCode::TIMEOUT;
+                errMsg = "Get rw-lock timeout when push response.";
             }
+        }
+        else {
+            errMsg = "Unable to get target message queue. It seems that the channel not started.";
+        }
 
-            if (rm.data) {
-                free(rm.data);
-            }
+    } catch (std::exception& e) {
+        if (mq) {
+            mq->processRWUnlock();  // always try to unlock again
+        }
+        errMsg = StringHelper::StringPrintf("An exception occurred during pushing message to response queue: %s.", e.what());
+    } catch (...) {
+        if (mq) {
+            mq->processRWUnlock();  // always try to unlock again
         }
+        errMsg = "An exception occurred during parsing pushing message to response queue.";
     }
+
+    if (ec != ErrorCode::SUCCESS) {
+        veigar::log("Veigar: Error: Send response failed: %s\n", errMsg.c_str());
+    }
+
+    if (rm.data) {
+        free(rm.data);
+    }
+    return true;
+}
+
+bool Sender::checkSpace(std::shared_ptr<MessageQueue> mq,
+                        int64_t needSize,
+                        int64_t startCallTimePoint,
+                        int64_t timeout,
+                        bool& full,
+                        bool& rejected,
+                        uint32_t lane) {
+    bool waitable = false;
+    if (mq->checkSpaceSufficient(needSize, waitable, lane)) {
+        return true;
+    }
+
+    if (waitable) {
+        mq->countFull();
+        rejected = mq->fullPolicy() == QueueFullPolicy::REJECT;
+    }
+
+    full = waitable && !rejected && TimeUtil::GetCurrentTimestamp() - startCallTimePoint < timeout;
+    return false;
 }
 
 bool Sender::checkSpaceAndWait(std::shared_ptr<MessageQueue> mq,
                                int64_t needSize,
                                int64_t startCallTimePoint,
-                               int64_t timeout) {
+                               int64_t timeout,
+                               bool& rejected,
+                               uint32_t lane) {
     bool result = false;
+    bool counted = false;
     do {
         bool waitable = false;
-        if (mq->checkSpaceSufficient(needSize, waitable)) {
+        if (mq->checkSpaceSufficient(needSize, waitable, lane)) {
             result = true;
             break;
         }
@@ -372,6 +881,16 @@ bool Sender::checkSpaceAndWait(std::shared_ptr<MessageQueue> mq,
             break;
         }
 
+        if (!counted) {
+            mq->countFull();
+            counted = true;
+        }
+
+        if (mq->fullPolicy() == QueueFullPolicy::REJECT) {
+            rejected = true;
+            break;
+        }
+
         int64_t used = TimeUtil::GetCurrentTimestamp() - startCallTimePoint;
         if (used >= timeout) {
             break;
@@ -9,27 +9,39 @@
 #define VEIGAR_SENDER_H_
 #pragma once
 
-#include <queue>
+#include <deque>
+#include <unordered_set>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <vector>
 #include <string>
 #include "event.h"
 #include "resp_dispatcher.h"
 #include "message_queue.h"
 #include "semaphore.h"
+#include "worker_group.h"
+#include "priority_selector.h"
+#include "scheduled_queue.h"
+#include "flow_control.h"
+#include "veigar/call_result.h"
 
 namespace veigar {
 class Veigar;
+struct Statistics;
+
 class Sender {
    public:
     struct CallMeta {
         std::string channel;
         std::string callId;
+        CallPriority priority = CallPriority::NORMAL;
         ResultMeta resultMeta;
         uint8_t* data = nullptr;
         size_t dataSize = 0;
         int64_t startCallTimePoint;  // microseconds
         int64_t timeout = 0;         // the timeout for waiting call queue availability, microseconds
+        int64_t deadline = 0;        // the deadline carried by the call, monotonic microseconds, 0 = none
     };
     struct RespMeta {
         std::string channel;
@@ -42,27 +54,96 @@ class Sender {
     ~Sender() = default;
 
     bool init(std::shared_ptr<RespDispatcher> respDisp,
-              std::shared_ptr<MessageQueue> selfCallMQ,
+              std::shared_ptr<FlowControl> flowControl,
+              const std::vector<std::shared_ptr<MessageQueue>>& selfCallMQs,
               std::shared_ptr<MessageQueue> selfRespMQ);
 
     void uninit();
 
     bool isInit() const;
 
-    void addCall(const Sender::CallMeta& cm);
-    void addResp(const Sender::RespMeta& rm);
+    // Takes a credit for the call (see FlowControl), then queues it and applies the policy of the SendQueueLimit if the queue is full.
+    // The data of a call that is not queued is not freed.
+    ErrorCode addCall(const Sender::CallMeta& cm, std::string& errMsg);
+    bool addResp(const Sender::RespMeta& rm, std::string& errMsg);
+
+    // Removes the call from the queue if it has not been sent, and completes it with ErrorCode::CANCELLED.
+    // A call taken from the queue but not yet registered with the RespDispatcher is completed by its sender instead.
+    // Return false if the call is neither in the queue nor being sent.
+    bool cancelCall(const std::string& callId);
+
+    // Sends the queued calls, then the queued responses, on the calling thread (see Veigar::poll).
+    // Never waits for the space of a target queue, the messages that do not fit are kept for the next flush.
+    // Return the number of messages sent or failed.
+    uint32_t flush(uint32_t maxMessages);
+
+    // Whether calls or responses are waiting to be sent.
+    bool hasPending() const;
+
+    // Fills the sender part of the statistics.
+    void collectStatistics(Statistics& stats) const;
 
    private:
-    std::shared_ptr<MessageQueue> getTargetCallMessageQueue(const std::string& channelName);
+    using CallQueueShards = std::vector<std::shared_ptr<MessageQueue>>;
+
+    // All shards of the call queue of the target, opened on first use.
+    std::shared_ptr<const CallQueueShards> getTargetCallMessageQueues(const std::string& channelName);
+
+    // Picks the shard to push a call to by the ShardPolicy.
+    std::shared_ptr<MessageQueue> pickShard(const CallQueueShards& shards);
+
     std::shared_ptr<MessageQueue> getTargetRespMessageQueue(const std::string& channelName);
 
     void sendCallThreadProc();
     void sendRespThreadProc();
 
+    // Takes the next message to send, 'backlog' is the number of messages left.
+    bool popCall(CallMeta& cm, int64_t& backlog);
+    bool popResp(RespMeta& rm, int64_t& backlog);
+
+    // Puts back a message that did not fit into the target queue, in front of the others.
+    // Return false if the call has been cancelled meanwhile, it is not queued then.
+    bool requeueCall(const CallMeta& cm);
+
+    // Registers a call taken by popCall with the RespDispatcher, unless it has been cancelled meanwhile.
+    // Return false if it has been cancelled, see cancelCall.
+    bool claimCall(const CallMeta& cm);
+
+    // Forgets a call taken by popCall that is not sent, return true if it has been cancelled meanwhile.
+    bool forgetSendingCall(const std::string& callId);
+
+    // Completes a call that has been cancelled before being sent, then frees its data.
+    void completeCancelled(CallMeta& cm);
+    void requeueResp(const RespMeta& rm);
+
+    // Pushes the message to the target queue, then frees its data.
+    // Without 'wait', return false and keep the message if the target queue is full and it has not timed out yet.
+    bool sendCall(CallMeta& cm, bool wait);
+    bool sendResp(RespMeta& rm, bool wait);
+
+    // The list mutex must be held.
+    bool isListFull(int64_t number, int64_t bytes, size_t needSize) const;
+
+    // Completes a call that has not been sent, e.g. dropped from the queue.
+    void failCall(CallMeta& cm, ErrorCode ec, const std::string& errMsg);
+
+    // The process rw-lock of 'mq' must be held.
+    // 'rejected' is set if the queue is full and its QueueFullPolicy is REJECT.
     bool checkSpaceAndWait(std::shared_ptr<MessageQueue> mq,
                            int64_t needSize,
                            int64_t startCallTimePoint,
-                           int64_t timeout);
+                           int64_t timeout,
+                           bool& rejected,
+                           uint32_t lane = 0);
+
+    // Like checkSpaceAndWait without waiting, 'full' tells whether the space may still become available in time.
+    bool checkSpace(std::shared_ptr<MessageQueue> mq,
+                    int64_t needSize,
+                    int64_t startCallTimePoint,
+                    int64_t timeout,
+                    bool& full,
+                    bool& rejected,
+                    uint32_t lane = 0);
 
    private:
     bool isInit_ = false;
@@ -71,21 +152,41 @@ class Sender {
     Veigar* veigar_ = nullptr;
 
     std::shared_ptr<RespDispatcher> respDisp_ = nullptr;
-    std::shared_ptr<MessageQueue> selfCallMQ_ = nullptr;
+    std::shared_ptr<FlowControl> flowControl_ = nullptr;
+    std::shared_ptr<const CallQueueShards> selfCallMQs_ = nullptr;
     std::shared_ptr<MessageQueue> selfRespMQ_ = nullptr;
 
-    std::mutex callListMutex_;
-    std::queue<CallMeta> callList_;
+    SendQueueLimit limit_;
+    bool threadless_ = false;  // See Veigar::setThreadless, the sender never waits for space or credits.
+    ShardPolicy shardPolicy_ = ShardPolicy::CALLER_HASH;
+    size_t callerHash_ = 0;
+
+    mutable std::mutex callListMutex_;
+    ScheduledQueue<CallMeta> callList_[kCallPriorityNumber];  // index is CallPriority
+    int64_t callListNumber_ = 0;
+    int64_t callListBytes_ = 0;
+    std::condition_variable callListSpaceCV_;
+    std::atomic<int64_t> rejectedCallNumber_ = {0};
+    std::atomic<int64_t> droppedCallNumber_ = {0};
+    PrioritySelector callSelector_;
     Event callListSetEvent_;
-    std::vector<std::thread> callWorkers_;
-
-    std::mutex respListMutex_;
-    std::queue<RespMeta> respList_;
+    WorkerGroup callWorkers_;
+
+    // Guarded by callListMutex_, the calls taken by popCall until claimCall, and those of them cancelled.
+    std::unordered_set<std::string> sendingCalls_;
+    std::unordered_set<std::string> cancelledSendingCalls_;
+
+    mutable std::mutex respListMutex_;
+    std::deque<RespMeta> respList_;
+    int64_t respListBytes_ = 0;
+    std::condition_variable respListSpaceCV_;
+    std::atomic<int64_t> rejectedRespNumber_ = {0};
+    std::atomic<int64_t> droppedRespNumber_ = {0};
     Event respListSetEvent_;
-    std::vector<std::thread> respWorkers_;
+    WorkerGroup respWorkers_;
 
     std::mutex targetCallMQsMutex_;
-    std::unordered_map<std::string, std::shared_ptr<MessageQueue>> targetCallMsgQueues_;
+    std::unordered_map<std::string, std::shared_ptr<const CallQueueShards>> targetCallMsgQueues_;
 
     std::mutex targetRespMQsMutex_;
     std::unordered_map<std::string, std::shared_ptr<MessageQueue>> targetRespMsgQueues_;
@@ -22,10 +22,24 @@
 #include <errno.h>
 #endif  // VEIGAR_OS_MACOS
 
+#ifdef VEIGAR_OS_LINUX
+#include <errno.h>
+#include <sys/syscall.h>  // SYS_mbind
+#endif                    // VEIGAR_OS_LINUX
+
 #include <stdexcept>
 #endif  // VEIGAR_OS_WINDOWS
 
 namespace veigar {
+void SharedMemory::setNumaNode(int32_t node) {
+    assert(!valid());
+    numaNode_ = node;
+}
+
+int32_t SharedMemory::numaNode() const {
+    return boundNumaNode_;
+}
+
 #ifdef VEIGAR_OS_WINDOWS
 SharedMemory::SharedMemory(const std::string& path, int64_t size) noexcept :
     path_(path),
@@ -69,6 +83,8 @@ bool SharedMemory::open() {
 }
 
 void SharedMemory::close() {
+    boundNumaNode_ = -1;
+
     if (data_) {
         UnmapViewOfFile(data_);
         data_ = nullptr;
@@ -104,7 +120,19 @@ bool SharedMemory::create() {
         return false;
     }
 
-    data_ = static_cast<uint8_t*>(MapViewOfFile(handle_, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    if (numaNode_ >= 0) {
+        data_ = static_cast<uint8_t*>(MapViewOfFileExNuma(handle_, FILE_MAP_ALL_ACCESS, 0, 0, 0, NULL, (DWORD)numaNode_));
+        if (data_) {
+            boundNumaNode_ = numaNode_;
+        }
+        else {
+            veigar::log("Veigar: [WARNING] MapViewOfFileExNuma failed, name: %s, node: %d, gle: %d.\n", path_.c_str(), numaNode_, GetLastError());
+        }
+    }
+
+    if (!data_) {
+        data_ = static_cast<uint8_t*>(MapViewOfFile(handle_, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    }
 
     if (!data_) {
         veigar::log("Veigar: Error: MapViewOfFile failed, name: %s, gle: %d.\n", path_.c_str(), GetLastError());
@@ -178,6 +206,10 @@ bool SharedMemory::create() {
         return false;
     }
 
+    if (numaNode_ >= 0) {
+        bindNumaNode();
+    }
+
     // veigar::log("Veigar: Create shared memory success, fd: %d.\n", fd_);
     return true;
 }
@@ -229,7 +261,37 @@ bool SharedMemory::valid() const {
     return fd_ != -1;
 }
 
+void SharedMemory::bindNumaNode() {
+#if defined(VEIGAR_OS_LINUX) && defined(SYS_mbind)
+    // Avoid depending on libnuma, the values are from linux/mempolicy.h.
+    const int kMpolBind = 2;
+    const unsigned kMpolMfMove = (1 << 1);
+    const unsigned long kBitsPerLong = sizeof(unsigned long) * 8;
+
+    if ((unsigned long)numaNode_ >= kBitsPerLong * 16) {
+        veigar::log("Veigar: [WARNING] Invalid NUMA node: %d.\n", numaNode_);
+        return;
+    }
+
+    unsigned long nodeMask[16] = {0};
+    nodeMask[numaNode_ / kBitsPerLong] = 1UL << (numaNode_ % kBitsPerLong);
+
+    // The pages have not been touched yet, so they will be allocated on the node.
+    if (syscall(SYS_mbind, data_, (unsigned long)size_, kMpolBind, nodeMask, kBitsPerLong * 16 + 1, kMpolMfMove) != 0) {
+        int err = errno;
+        veigar::log("Veigar: [WARNING] mbind failed, node: %d, err: %d.\n", numaNode_, err);
+        return;
+    }
+
+    boundNumaNode_ = numaNode_;
+#else
+    veigar::log("Veigar: [WARNING] NUMA placement is not supported on this platform.\n");
+#endif
+}
+
 void SharedMemory::close() {
+    boundNumaNode_ = -1;
+
     if (fd_ != -1) {
         //veigar::log("Veigar: Close fd: %d.\n", fd_);
         if (data_) {
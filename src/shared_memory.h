@@ -26,6 +26,13 @@ class SharedMemory {
     // path should only contain alpha-numeric characters, and is normalized on linux/macOS.
     explicit SharedMemory(const std::string& path, int64_t size) noexcept;
 
+    // Place the pages on the NUMA node, -1 means no placement.
+    // Only takes effect when called before create, the pages are placed by the creator.
+    void setNumaNode(int32_t node);
+
+    // The NUMA node the pages are bound to, or -1 if they are not bound.
+    int32_t numaNode() const;
+
     bool create();
     bool open();
     bool valid() const;
@@ -45,7 +52,14 @@ class SharedMemory {
 
     ~SharedMemory() noexcept = default;
    private:
+#ifndef VEIGAR_OS_WINDOWS
+    void bindNumaNode();
+#endif
+
+   private:
     bool creator_ = false;
+    int32_t numaNode_ = -1;
+    int32_t boundNumaNode_ = -1;
     std::string path_;
     uint8_t* data_ = nullptr;
     int64_t size_ = 0;
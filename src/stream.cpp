@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "veigar/stream.h"
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include "veigar/call_dispatcher.h"
+#include "stream_credit.h"
+#include "log.h"
+
+namespace veigar {
+class StreamWriter::State {
+   public:
+    State(const std::string& callId,
+          const std::string& callerChannelName,
+          std::weak_ptr<detail::CallDispatcher> dispatcher,
+          std::shared_ptr<StreamCredit> credit) noexcept :
+        callId_(callId),
+        callerChannelName_(callerChannelName),
+        dispatcher_(dispatcher),
+        credit_(credit),
+        closed_(false) {
+    }
+
+    ~State() {
+        std::shared_ptr<detail::CallDispatcher> dispatcher = dispatcher_.lock();
+        if (!dispatcher) {
+            return;
+        }
+
+        // A cancelled stream needs no end.
+        if (!closed_.exchange(true) && !credit_->isCancelled()) {
+            veigar::log("Veigar: [WARNING] Stream of call %s has been destroyed without closing.\n", callId_.c_str());
+            sendEnd(std::string("The function did not close the stream."));
+        }
+
+        dispatcher->removeStream(callId_);
+    }
+
+    // 'errorMessage' is empty for a successful end.
+    bool sendEnd(const std::string& errorMessage) {
+        if (credit_->isCancelled()) {
+            return false;
+        }
+
+        std::shared_ptr<detail::CallDispatcher> dispatcher = dispatcher_.lock();
+        if (!dispatcher) {
+            return false;
+        }
+
+        // The end carries the number of items, so that the caller can wait for the items still on the way.
+        const uint64_t count = credit_->taken();
+        if (errorMessage.empty()) {
+            return dispatcher->sendResponse(callerChannelName_, detail::Response::MakeResponseWithResult(callId_, count));
+        }
+
+        detail::Response resp = detail::Response::MakeResponseWithError(callId_, errorMessage);
+        veigar_msgpack::object countValue(count);
+        veigar_msgpack::object_handle countObj(countValue, veigar_msgpack::unique_ptr<veigar_msgpack::zone>());
+        resp.setResult(countObj);
+        return dispatcher->sendResponse(callerChannelName_, resp);
+    }
+
+    std::string callId_;
+    std::string callerChannelName_;
+    std::weak_ptr<detail::CallDispatcher> dispatcher_;
+    std::shared_ptr<StreamCredit> credit_;
+    std::atomic_bool closed_;
+};
+
+StreamWriter::StreamWriter(std::shared_ptr<State> state) noexcept :
+    state_(state) {
+}
+
+StreamWriter StreamWriter::Create(const std::string& callId,
+                                  const std::string& callerChannelName,
+                                  std::weak_ptr<detail::CallDispatcher> dispatcher,
+                                  std::shared_ptr<StreamCredit> credit) {
+    return StreamWriter(std::make_shared<State>(callId, callerChannelName, dispatcher, credit));
+}
+
+bool StreamWriter::isValid() const {
+    return !!state_;
+}
+
+std::string StreamWriter::callId() const {
+    return state_ ? state_->callId_ : std::string();
+}
+
+std::string StreamWriter::callerChannelName() const {
+    return state_ ? state_->callerChannelName_ : std::string();
+}
+
+bool StreamWriter::isClosed() const {
+    return state_ ? state_->closed_.load() : false;
+}
+
+bool StreamWriter::isCancelled() const {
+    return state_ ? state_->credit_->isCancelled() : false;
+}
+
+bool StreamWriter::close() {
+    if (!claim()) {
+        return false;
+    }
+
+    return state_->sendEnd(std::string());
+}
+
+bool StreamWriter::closeWithError(const std::string& errorMessage) {
+    if (!claim()) {
+        return false;
+    }
+
+    return state_->sendEnd(errorMessage.empty() ? std::string("Unknown error.") : errorMessage);
+}
+
+bool StreamWriter::claim() {
+    return state_ && !state_->closed_.exchange(true);
+}
+
+bool StreamWriter::writeObject(const veigar_msgpack::object& item) {
+    if (!state_ || state_->closed_.load()) {
+        return false;
+    }
+
+    uint64_t seq = 0;
+    if (!state_->credit_->acquire(VEIGAR_STREAM_WRITE_TIMEOUT, seq)) {
+        if (!state_->credit_->isCancelled()) {
+            veigar::log("Veigar: [WARNING] The caller of stream %s has not consumed any item in %d ms.\n",
+                        state_->callId_.c_str(), VEIGAR_STREAM_WRITE_TIMEOUT);
+        }
+        return false;
+    }
+
+    std::shared_ptr<detail::CallDispatcher> dispatcher = state_->dispatcher_.lock();
+    if (!dispatcher) {
+        return false;
+    }
+
+    // flag(3) - callId - seq - item
+    veigar_msgpack::sbuffer buf;
+    veigar_msgpack::pack(buf, std::make_tuple((int8_t)3, state_->callId_, seq, item));
+    return dispatcher->sendData(state_->callerChannelName_, buf);
+}
+
+class StreamReader::State {
+   public:
+    void onItem(uint64_t seq, veigar_msgpack::object_handle& item) {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (cancelled_ || seq < nextSeq_) {
+            return;
+        }
+
+        pending_.emplace(seq, std::move(item));
+        cv_.notify_all();
+    }
+
+    void onEnd(const CallResult& ret) {
+        std::lock_guard<std::mutex> lg(mutex_);
+        ended_ = true;
+        errCode_ = ret.errCode;
+        errorMessage_ = ret.errorMessage;
+
+        const veigar_msgpack::object& countObj = ret.obj.get();
+        if (countObj.type == veigar_msgpack::type::POSITIVE_INTEGER) {
+            countKnown_ = true;
+            count_ = countObj.via.u64;
+        }
+        cv_.notify_all();
+    }
+
+    // The mutex must be held.
+    bool isFinished() const {
+        if (cancelled_) {
+            return true;
+        }
+
+        if (!ended_) {
+            return false;
+        }
+
+        // Without the number of items (e.g. the function threw), the stream ends at the first missing item.
+        return countKnown_ ? nextSeq_ >= count_ : pending_.find(nextSeq_) == pending_.end();
+    }
+
+    std::string callId_;
+    std::function<void(int64_t)> granter_;
+    std::function<void()> releaser_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<uint64_t, veigar_msgpack::object_handle> pending_;  // seq -> item
+    uint64_t nextSeq_ = 0;
+    int64_t consumed_ = 0;  // the items read but not granted back yet
+    bool ended_ = false;
+    bool cancelled_ = false;
+    bool countKnown_ = false;
+    uint64_t count_ = 0;
+    ErrorCode errCode_ = ErrorCode::SUCCESS;
+    std::string errorMessage_;
+};
+
+StreamReader::StreamReader(const std::string& callId,
+                           std::function<void(int64_t)> granter,
+                           std::function<void()> releaser) noexcept :
+    state_(std::make_shared<State>()) {
+    state_->callId_ = callId;
+    state_->granter_ = granter;
+    state_->releaser_ = releaser;
+}
+
+StreamReader::~StreamReader() {
+    cancel();
+}
+
+std::string StreamReader::callId() const {
+    return state_->callId_;
+}
+
+void StreamReader::bindResultMeta(ResultMeta& retMeta) {
+    std::shared_ptr<State> state = state_;
+    retMeta.metaType = 3;
+    retMeta.itemCb = [state](uint64_t seq, veigar_msgpack::object_handle& item) { state->onItem(seq, item); };
+    retMeta.cb = [state](const CallResult& ret) { state->onEnd(ret); };
+}
+
+bool StreamReader::next(CallResult& item, uint32_t timeoutMS) {
+    int64_t grant = 0;
+    {
+        std::unique_lock<std::mutex> ul(state_->mutex_);
+        const bool arrived = state_->cv_.wait_for(ul, std::chrono::milliseconds(timeoutMS), [this]() {
+            return state_->isFinished() || state_->pending_.find(state_->nextSeq_) != state_->pending_.end();
+        });
+
+        if (!arrived) {
+            return false;
+        }
+
+        if (state_->isFinished()) {
+            ul.unlock();
+
+            // All items have arrived, the caller no longer needs to keep the stream.
+            if (state_->releaser_) {
+                state_->releaser_();
+            }
+            return false;
+        }
+
+        auto it = state_->pending_.find(state_->nextSeq_);
+        item.errCode = ErrorCode::SUCCESS;
+        item.errorMessage.clear();
+        item.obj = std::move(it->second);
+        state_->pending_.erase(it);
+        state_->nextSeq_++;
+
+        // Grant in batches, an item with each grant would double the messages.
+        if (!state_->ended_ && ++state_->consumed_ >= (VEIGAR_STREAM_WINDOW + 1) / 2) {
+            grant = state_->consumed_;
+            state_->consumed_ = 0;
+        }
+    }
+
+    if (grant > 0 && state_->granter_) {
+        state_->granter_(grant);
+    }
+
+    return true;
+}
+
+bool StreamReader::isEnded() const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->isFinished();
+}
+
+ErrorCode StreamReader::errorCode() const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->errCode_;
+}
+
+std::string StreamReader::errorMessage() const {
+    std::lock_guard<std::mutex> lg(state_->mutex_);
+    return state_->errorMessage_;
+}
+
+void StreamReader::cancel() {
+    bool notifyCallee = false;
+    {
+        std::lock_guard<std::mutex> lg(state_->mutex_);
+        if (state_->cancelled_) {
+            return;
+        }
+
+        state_->cancelled_ = true;
+        state_->pending_.clear();
+        state_->cv_.notify_all();
+
+        notifyCallee = !state_->ended_;
+    }
+
+    // After the end, the stream is only kept by the caller for the items still on the way.
+    if (state_->releaser_) {
+        state_->releaser_();
+    }
+
+    if (notifyCallee) {
+        // A negative credit cancels the stream.
+        if (state_->granter_) {
+            state_->granter_(-1);
+        }
+    }
+}
+}  // namespace veigar
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "stream_credit.h"
+#include <chrono>
+
+namespace veigar {
+StreamCredit::StreamCredit(int64_t initial) noexcept :
+    credit_(initial) {
+}
+
+bool StreamCredit::acquire(int64_t ms, uint64_t& seq) {
+    std::unique_lock<std::mutex> ul(mutex_);
+    if (!cv_.wait_for(ul, std::chrono::milliseconds(ms), [this]() { return cancelled_ || credit_ > 0; })) {
+        return false;
+    }
+
+    if (cancelled_) {
+        return false;
+    }
+
+    credit_--;
+    seq = taken_++;
+    return true;
+}
+
+void StreamCredit::grant(int64_t credit) {
+    if (credit <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    credit_ += credit;
+    cv_.notify_all();
+}
+
+void StreamCredit::cancel() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    cancelled_ = true;
+    cv_.notify_all();
+}
+
+bool StreamCredit::isCancelled() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return cancelled_;
+}
+
+uint64_t StreamCredit::taken() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return taken_;
+}
+}  // namespace veigar
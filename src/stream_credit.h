@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_STREAM_CREDIT_H_
+#define VEIGAR_STREAM_CREDIT_H_
+#pragma once
+
+#include <inttypes.h>
+#include <mutex>
+#include <condition_variable>
+
+namespace veigar {
+// The flow control of a stream on the function side.
+// Each item takes a credit, the caller grants credits back as it consumes the items.
+class StreamCredit {
+   public:
+    explicit StreamCredit(int64_t initial) noexcept;
+    ~StreamCredit() = default;
+
+    // Takes a credit and the sequence number of the next item, waits up to 'ms' for a grant.
+    // Return false on timeout, or if the stream has been cancelled.
+    bool acquire(int64_t ms, uint64_t& seq);
+
+    void grant(int64_t credit);
+
+    // Wakes up and fails the waiting writers, no more credit can be acquired.
+    void cancel();
+    bool isCancelled() const;
+
+    // The number of credits taken, which is also the number of items.
+    uint64_t taken() const;
+
+   private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    int64_t credit_ = 0;
+    uint64_t taken_ = 0;
+    bool cancelled_ = false;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_STREAM_CREDIT_H_
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "thread_util.h"
+#include "os_platform.h"
+
+#ifdef VEIGAR_OS_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#undef WIN32_LEAN_AND_MEAN
+#else
+#include <pthread.h>
+#endif
+
+namespace veigar {
+#ifdef VEIGAR_OS_WINDOWS
+bool ThreadUtil::SetCurrentThreadName(const std::string& name) {
+    // SetThreadDescription is available since Windows 10 1607.
+    typedef HRESULT(WINAPI * SetThreadDescriptionFunc)(HANDLE, PCWSTR);
+    static SetThreadDescriptionFunc setThreadDescription =
+        (SetThreadDescriptionFunc)GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "SetThreadDescription");
+    if (!setThreadDescription) {
+        return false;
+    }
+
+    const std::wstring wname(name.begin(), name.end());
+    return SUCCEEDED(setThreadDescription(GetCurrentThread(), wname.c_str()));
+}
+
+bool ThreadUtil::SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus) {
+    DWORD_PTR mask = 0;
+    for (uint32_t cpu : cpus) {
+        if (cpu < sizeof(DWORD_PTR) * 8) {
+            mask |= ((DWORD_PTR)1 << cpu);
+        }
+    }
+
+    if (mask == 0) {
+        return false;
+    }
+
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+}
+#elif defined(VEIGAR_OS_MACOS)
+bool ThreadUtil::SetCurrentThreadName(const std::string& name) {
+    return pthread_setname_np(name.c_str()) == 0;
+}
+
+bool ThreadUtil::SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus) {
+    // macOS only supports affinity tags, which are hints rather than CPU sets.
+    return false;
+}
+#elif defined(VEIGAR_OS_LINUX)
+bool ThreadUtil::SetCurrentThreadName(const std::string& name) {
+    return pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()) == 0;
+}
+
+bool ThreadUtil::SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    bool empty = true;
+    for (uint32_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpuSet);
+            empty = false;
+        }
+    }
+
+    if (empty) {
+        return false;
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+}
+#else
+bool ThreadUtil::SetCurrentThreadName(const std::string& name) {
+    return false;
+}
+
+bool ThreadUtil::SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus) {
+    return false;
+}
+#endif
+}  // namespace veigar
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_THREAD_UTIL_H_
+#define VEIGAR_THREAD_UTIL_H_
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace veigar {
+class ThreadUtil {
+   public:
+    // The name is truncated to 15 characters on Linux.
+    static bool SetCurrentThreadName(const std::string& name);
+
+    // Restrict the current thread to the given CPUs.
+    // Not supported on macOS, where the function always returns false.
+    static bool SetCurrentThreadAffinity(const std::vector<uint32_t>& cpus);
+};
+}  // namespace veigar
+#endif  // !VEIGAR_THREAD_UTIL_H_
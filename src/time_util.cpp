@@ -22,6 +22,7 @@
 #pragma warning(disable : 4995)
 #else
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 namespace veigar {
@@ -44,4 +45,23 @@ int64_t TimeUtil::GetCurrentTimestamp() {
     return lNowMicroMS;
 #endif
 }
+
+int64_t TimeUtil::GetMonotonicTimestamp() {
+#ifdef VEIGAR_OS_WINDOWS
+    static LARGE_INTEGER frequency = []() {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f;
+    }();
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (int64_t)(counter.QuadPart / frequency.QuadPart * 1000000LL +
+                     counter.QuadPart % frequency.QuadPart * 1000000LL / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
 }  // namespace veigar
\ No newline at end of file
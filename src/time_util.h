@@ -16,6 +16,10 @@ class TimeUtil {
    public:
     // The microseconds that since 1970-01-01 00:00:00(UTC)
     static int64_t GetCurrentTimestamp();
+
+    // The microseconds of a monotonic clock, which is not affected by system time changes.
+    // The clock is system-wide, so the values can be compared between processes on the same host.
+    static int64_t GetMonotonicTimestamp();
 };
 }  // namespace veigar
 #endif  // !VEIGAR_TIME_UTIL_H_
\ No newline at end of file
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "topic_hub.h"
+#include <assert.h>
+#include <vector>
+#include "veigar/config.h"
+#include "log.h"
+#include "thread_util.h"
+
+namespace veigar {
+namespace {
+// The subscription thread also checks the stop flag on this interval,
+// in case the publisher process exited without signaling.
+const int64_t kSubscriptionWaitTimeout = 500;  // ms
+}  // namespace
+
+TopicHub::~TopicHub() {
+    clear();
+}
+
+std::string TopicHub::RingName(const std::string& topic) {
+    return topic + VEIGAR_TOPIC_NAME_SUFFIX;
+}
+
+bool TopicHub::createTopic(const std::string& topic, TopicPolicy policy, uint32_t capacity, uint32_t maxSubscriberNumber) {
+    if (topic.empty()) {
+        veigar::log("Veigar: [ERROR] Topic name cannot be empty.\n");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (topics_.find(topic) != topics_.end()) {
+        veigar::log("Veigar: [WARNING] Topic already created: %s.\n", topic.c_str());
+        return false;
+    }
+
+    std::shared_ptr<BroadcastRing> ring = std::make_shared<BroadcastRing>();
+    if (!ring->create(RingName(topic), capacity, (int32_t)maxSubscriberNumber, policy)) {
+        veigar::log("Veigar: [ERROR] Failed to create topic: %s.\n", topic.c_str());
+        return false;
+    }
+
+    topics_[topic] = ring;
+    return true;
+}
+
+void TopicHub::destroyTopic(const std::string& topic) {
+    std::shared_ptr<BroadcastRing> ring;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        auto it = topics_.find(topic);
+        if (it == topics_.end()) {
+            return;
+        }
+        ring = it->second;
+        topics_.erase(it);
+    }
+    // The ring is closed when the last publish on it has returned.
+}
+
+bool TopicHub::publish(const std::string& topic, const uint8_t* data, size_t size, uint32_t timeoutMS) {
+    std::shared_ptr<BroadcastRing> ring;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        auto it = topics_.find(topic);
+        if (it == topics_.end()) {
+            veigar::log("Veigar: [ERROR] Topic has not been created: %s.\n", topic.c_str());
+            return false;
+        }
+        ring = it->second;
+    }
+
+    return ring->write(data, (int64_t)size, timeoutMS);
+}
+
+bool TopicHub::subscribe(const std::string& topic, TopicCallback cb) {
+    if (topic.empty() || !cb) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (subscriptions_.find(topic) != subscriptions_.end()) {
+        veigar::log("Veigar: [WARNING] Topic already subscribed: %s.\n", topic.c_str());
+        return false;
+    }
+
+    std::shared_ptr<Subscription> sub = std::make_shared<Subscription>();
+    sub->topic = topic;
+    sub->cb = cb;
+    sub->ring = std::make_shared<BroadcastRing>();
+    if (!sub->ring->open(RingName(topic))) {
+        veigar::log("Veigar: [ERROR] Failed to open topic: %s.\n", topic.c_str());
+        return false;
+    }
+
+    sub->slot = sub->ring->attach();
+    if (sub->slot < 0) {
+        veigar::log("Veigar: [ERROR] Topic has reached the maximum number of subscribers: %s.\n", topic.c_str());
+        return false;
+    }
+
+    sub->thread = std::thread(&TopicHub::SubscriptionProc, sub.get());
+    subscriptions_[topic] = sub;
+    return true;
+}
+
+void TopicHub::unsubscribe(const std::string& topic) {
+    std::shared_ptr<Subscription> sub;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        auto it = subscriptions_.find(topic);
+        if (it == subscriptions_.end()) {
+            return;
+        }
+        sub = it->second;
+        subscriptions_.erase(it);
+    }
+
+    StopSubscription(sub);
+}
+
+void TopicHub::clear() {
+    std::unordered_map<std::string, std::shared_ptr<Subscription>> subs;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        subs.swap(subscriptions_);
+        topics_.clear();
+    }
+
+    for (auto& it : subs) {
+        StopSubscription(it.second);
+    }
+}
+
+void TopicHub::StopSubscription(const std::shared_ptr<Subscription>& sub) {
+    assert(sub);
+    sub->stop.store(true);
+    sub->ring->notifyRead(sub->slot);
+
+    if (sub->thread.joinable()) {
+        sub->thread.join();
+    }
+
+    sub->ring->detach(sub->slot);
+    sub->ring->close();
+}
+
+void TopicHub::SubscriptionProc(Subscription* sub) {
+    ThreadUtil::SetCurrentThreadName("veigar-topic");
+
+    std::vector<uint8_t> buf;
+    while (!sub->stop.load()) {
+        TopicEvent event;
+        if (!sub->ring->read(sub->slot, buf, event.seq, event.missed)) {
+            sub->ring->waitForRead(sub->slot, kSubscriptionWaitTimeout);
+            continue;
+        }
+
+        try {
+            event.obj = veigar_msgpack::unpack((const char*)buf.data(), buf.size());
+            sub->cb(event);
+        } catch (std::exception& e) {
+            veigar::log("Veigar: [ERROR] An exception occurred while handling event %" PRIu64 " of topic %s: %s.\n",
+                        event.seq, sub->topic.c_str(), e.what());
+        }
+    }
+}
+}  // namespace veigar
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_TOPIC_HUB_H_
+#define VEIGAR_TOPIC_HUB_H_
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "veigar/topic.h"
+#include "broadcast_ring.h"
+
+namespace veigar {
+// The topics published and subscribed by a Veigar instance.
+// Each topic is a BroadcastRing, each subscription reads its slot of the ring on its own thread.
+class TopicHub {
+   public:
+    TopicHub() noexcept = default;
+    ~TopicHub();
+
+    bool createTopic(const std::string& topic, TopicPolicy policy, uint32_t capacity, uint32_t maxSubscriberNumber);
+    void destroyTopic(const std::string& topic);
+
+    bool publish(const std::string& topic, const uint8_t* data, size_t size, uint32_t timeoutMS);
+
+    bool subscribe(const std::string& topic, TopicCallback cb);
+    void unsubscribe(const std::string& topic);
+
+    // Destroy all topics and subscriptions.
+    void clear();
+
+   private:
+    struct Subscription {
+        std::string topic;
+        std::shared_ptr<BroadcastRing> ring;
+        int32_t slot = -1;
+        TopicCallback cb;
+        std::atomic<bool> stop = {false};
+        std::thread thread;
+    };
+
+    static std::string RingName(const std::string& topic);
+    static void SubscriptionProc(Subscription* sub);
+    static void StopSubscription(const std::shared_ptr<Subscription>& sub);
+
+   private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<BroadcastRing>> topics_;
+    std::unordered_map<std::string, std::shared_ptr<Subscription>> subscriptions_;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_TOPIC_HUB_H_
@@ -7,16 +7,72 @@
  */
 #include "veigar/veigar.h"
 #include <cstdlib>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
 #include "uuid.h"
 #include "log.h"
+#include "string_helper.h"
 #include "message_queue.h"
 #include "time_util.h"
 #include "resp_dispatcher.h"
 #include "sender.h"
+#include "topic_hub.h"
+#include "recv_buffer_pool.h"
 #include "time_util.h"
 #include "run_time_recorder.h"
 
 namespace veigar {
+namespace {
+// A weak handle to the instance, for the objects that may outlive it, e.g. a StreamReader.
+// Once detached, the callbacks run through it are no-ops.
+class InstanceHandle {
+   public:
+    void attach(Veigar* veigar) {
+        std::lock_guard<std::mutex> lg(mutex_);
+        veigar_ = veigar;
+    }
+
+    // Waits for the callbacks in progress.
+    void detach() {
+        std::unique_lock<std::mutex> ul(mutex_);
+        veigar_ = nullptr;
+        cv_.wait(ul, [this]() { return users_ == 0; });
+    }
+
+    // Runs 'fn' with the instance if it is still attached.
+    static void Run(const std::weak_ptr<InstanceHandle>& weak, const std::function<void(Veigar*)>& fn) {
+        std::shared_ptr<InstanceHandle> handle = weak.lock();
+        if (!handle) {
+            return;
+        }
+
+        Veigar* veigar = nullptr;
+        {
+            std::lock_guard<std::mutex> lg(handle->mutex_);
+            veigar = handle->veigar_;
+            if (!veigar) {
+                return;
+            }
+            handle->users_++;
+        }
+
+        fn(veigar);
+
+        std::lock_guard<std::mutex> lg(handle->mutex_);
+        if (--handle->users_ == 0) {
+            handle->cv_.notify_all();
+        }
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Veigar* veigar_ = nullptr;
+    int32_t users_ = 0;
+};
+}  // namespace
+
 class Veigar::Impl {
    public:
     Impl(Veigar* veigar) noexcept :
@@ -53,28 +109,41 @@ class Veigar::Impl {
             respDispatcher_ = std::make_shared<RespDispatcher>(veigar_);
             sender_ = std::make_shared<Sender>(veigar_);
 
+            // The responses are sent through the handle from now on, the call dispatcher may send one as soon as it starts.
+            handle_->attach(veigar_);
+
+            // Shared by the call and response dispatchers, so that a burst on one side is reused by the other.
+            recvBufferPool_ = std::make_shared<RecvBufferPool>();
+
             assert(veigar_->callDisp_);
-            if (!veigar_->callDisp_->init()) {
+            if (!veigar_->callDisp_->init(recvBufferPool_)) {
                 veigar::log("Veigar: [ERROR] Failed to initialize call dispatcher.\n");
                 break;
             }
 
+            // Shared by the sender that takes the credits and the response dispatcher that returns them.
+            std::shared_ptr<FlowControl> flowControl = std::make_shared<FlowControl>(flowControlLimit_);
+
             assert(respDispatcher_);
-            if (!respDispatcher_->init()) {
+            if (!respDispatcher_->init(flowControl, recvBufferPool_)) {
                 veigar::log("Veigar: [ERROR] Failed to initialize response dispatcher.\n");
                 break;
             }
 
             assert(sender_);
-            if (!sender_->init(respDispatcher_, veigar_->callDisp_->messageQueue(), respDispatcher_->messageQueue())) {
+            if (!sender_->init(respDispatcher_, flowControl, veigar_->callDisp_->messageQueues(), respDispatcher_->messageQueue())) {
                 veigar::log("Veigar: [ERROR] Failed to initialize message sender.\n");
                 break;
             }
 
+            topicHub_ = std::make_shared<TopicHub>();
+
             isInit_ = true;
         } while (false);
 
         if (!isInit_) {
+            handle_->detach();
+
             if (veigar_->callDisp_->isInit()) {
                 veigar_->callDisp_->uninit();
             }
@@ -92,6 +161,7 @@ class Veigar::Impl {
 
             sender_.reset();
             respDispatcher_.reset();
+            recvBufferPool_.reset();
         }
         else {
             veigar::log("Veigar: [INFO] Successfully initialized instance - Channel: %s, UUID: %s.\n", channelName_.c_str(), uuid_.c_str());
@@ -100,11 +170,23 @@ class Veigar::Impl {
         return isInit_;
     }
 
+    // Sends a response, only called through the handle, see Veigar::sendResponse.
+    bool sendResponse(const std::string& targetChannel, const uint8_t* buf, size_t bufSize, std::string& errMsg);
+
     void uninit() {
         if (!isInit_) {
             return;
         }
 
+        // The stream readers still alive no longer call back into this instance,
+        // and the responses sent by Responders and StreamWriters on other threads are finished before the sender is reset.
+        handle_->detach();
+
+        if (topicHub_) {
+            topicHub_->clear();
+            topicHub_.reset();
+        }
+
         assert(sender_);
         if (sender_) {
             if (sender_->isInit()) {
@@ -126,6 +208,9 @@ class Veigar::Impl {
             respDispatcher_.reset();
         }
 
+        // The buffers still referenced by results are freed once released.
+        recvBufferPool_.reset();
+
         isInit_ = false;
     }
 
@@ -135,6 +220,22 @@ class Veigar::Impl {
     uint32_t expectedMsgMaxSize_ = 0;
 
     std::atomic<uint32_t> processRWTimeout_ = { 30 };  // ms
+    PriorityPolicy priorityPolicy_ = PriorityPolicy::STRICT;
+    SchedulingPolicy schedulingPolicy_ = SchedulingPolicy::FIFO;
+    FairnessPolicy fairnessPolicy_ = FairnessPolicy::NONE;
+    uint32_t callQueueShards_ = 1;
+    ShardPolicy shardPolicy_ = ShardPolicy::CALLER_HASH;
+    QueueFullPolicy callQueueFullPolicy_ = QueueFullPolicy::BLOCK;
+    QueueFullPolicy responseQueueFullPolicy_ = QueueFullPolicy::BLOCK;
+    bool pollMode_ = false;
+    bool threadless_ = false;
+    bool deadlinePropagation_ = false;
+    SendQueueLimit sendQueueLimit_;
+    FlowControlLimit flowControlLimit_;
+    CallbackPolicy callbackPolicy_ = CallbackPolicy::INLINE;
+    Executor callbackExecutor_;
+    std::vector<uint32_t> cpus_[kThreadRoleNumber];
+    int32_t numaNode_ = -1;
 
     std::atomic<uint32_t> callIndex_ = { 0 };
     std::string channelName_;
@@ -146,6 +247,11 @@ class Veigar::Impl {
     //
     std::shared_ptr<RespDispatcher> respDispatcher_;
     std::shared_ptr<Sender> sender_;
+    std::shared_ptr<RecvBufferPool> recvBufferPool_;
+    std::shared_ptr<InstanceHandle> handle_ = std::make_shared<InstanceHandle>();
+
+    // The topics are not tied to the channel, they are only owned by the instance.
+    std::shared_ptr<TopicHub> topicHub_;
 };
 
 Veigar::Veigar() noexcept :
@@ -234,6 +340,565 @@ uint32_t Veigar::timeoutOfRWLock() const {
     return impl_->processRWTimeout_.load();
 }
 
+void Veigar::setPriorityPolicy(PriorityPolicy policy) {
+    assert(impl_);
+    impl_->priorityPolicy_ = policy;
+}
+
+PriorityPolicy Veigar::priorityPolicy() const {
+    assert(impl_);
+    return impl_->priorityPolicy_;
+}
+
+void Veigar::setSchedulingPolicy(SchedulingPolicy policy) {
+    assert(impl_);
+    impl_->schedulingPolicy_ = policy;
+}
+
+SchedulingPolicy Veigar::schedulingPolicy() const {
+    assert(impl_);
+    return impl_->schedulingPolicy_;
+}
+
+void Veigar::setDeadlinePropagation(bool enable) {
+    assert(impl_);
+    impl_->deadlinePropagation_ = enable;
+}
+
+bool Veigar::deadlinePropagation() const {
+    assert(impl_);
+    return impl_->deadlinePropagation_;
+}
+
+void Veigar::setFairnessPolicy(FairnessPolicy policy) {
+    assert(impl_);
+    impl_->fairnessPolicy_ = policy;
+}
+
+FairnessPolicy Veigar::fairnessPolicy() const {
+    assert(impl_);
+    return impl_->fairnessPolicy_;
+}
+
+void Veigar::setCallerWeight(const std::string& callerChannelName, uint32_t weight) {
+    assert(callDisp_);
+    callDisp_->setCallerWeight(callerChannelName, weight);
+}
+
+void Veigar::setCallQueueShards(uint32_t shardNumber) {
+    assert(impl_);
+    impl_->callQueueShards_ = std::min(std::max(shardNumber, 1u), (uint32_t)VEIGAR_CALL_QUEUE_MAX_SHARD_NUMBER);
+}
+
+uint32_t Veigar::callQueueShards() const {
+    assert(impl_);
+    return impl_->callQueueShards_;
+}
+
+void Veigar::setShardPolicy(ShardPolicy policy) {
+    assert(impl_);
+    impl_->shardPolicy_ = policy;
+}
+
+ShardPolicy Veigar::shardPolicy() const {
+    assert(impl_);
+    return impl_->shardPolicy_;
+}
+
+void Veigar::setCallQueueFullPolicy(QueueFullPolicy policy) {
+    assert(impl_);
+    impl_->callQueueFullPolicy_ = policy;
+}
+
+QueueFullPolicy Veigar::callQueueFullPolicy() const {
+    assert(impl_);
+    return impl_->callQueueFullPolicy_;
+}
+
+void Veigar::setResponseQueueFullPolicy(QueueFullPolicy policy) {
+    assert(impl_);
+    impl_->responseQueueFullPolicy_ = policy;
+}
+
+QueueFullPolicy Veigar::responseQueueFullPolicy() const {
+    assert(impl_);
+    return impl_->responseQueueFullPolicy_;
+}
+
+void Veigar::setPollMode(bool enable) {
+    assert(impl_);
+    impl_->pollMode_ = enable;
+}
+
+bool Veigar::pollMode() const {
+    assert(impl_);
+    return impl_->pollMode_ || impl_->threadless_;
+}
+
+void Veigar::setThreadless(bool enable) {
+    assert(impl_);
+    impl_->threadless_ = enable;
+}
+
+bool Veigar::threadless() const {
+    assert(impl_);
+    return impl_->threadless_;
+}
+
+std::vector<PollHandle> Veigar::pollHandles() const {
+    assert(impl_);
+    std::vector<PollHandle> handles;
+    if (!impl_->isInit_ || !pollMode()) {
+        return handles;
+    }
+
+    handles = callDisp_->pollHandles();
+    if (impl_->respDispatcher_) {
+        handles.push_back(impl_->respDispatcher_->pollHandle());
+    }
+    return handles;
+}
+
+uint32_t Veigar::processReady(uint32_t maxMessages) {
+    assert(impl_);
+    if (!impl_->isInit_ || !pollMode()) {
+        return 0;
+    }
+
+    uint32_t processed = callDisp_->processReady(maxMessages);
+    if (impl_->respDispatcher_) {
+        processed += impl_->respDispatcher_->processReady(maxMessages);
+    }
+
+    // There are no dispatcher threads to trim the buffers while idle.
+    impl_->recvBufferPool_->trim();
+    return processed;
+}
+
+uint32_t Veigar::poll(uint32_t maxMessages, uint32_t timeoutMS) {
+    assert(impl_);
+    if (!impl_->isInit_ || !impl_->threadless_) {
+        return 0;
+    }
+
+    // The calls made since the last poll.
+    uint32_t processed = impl_->sender_->flush(maxMessages);
+
+    uint32_t received = processReady(maxMessages);
+    if (received == 0 && timeoutMS > 0) {
+        int64_t waitMS = timeoutMS;
+
+        // The messages kept by a full target queue are retried soon.
+        if (impl_->sender_->hasPending()) {
+            waitMS = std::min(waitMS, (int64_t)1);
+        }
+
+        const int64_t deadline = impl_->respDispatcher_->earliestDeadline();
+        if (deadline > 0) {
+            const int64_t remain = deadline - TimeUtil::GetMonotonicTimestamp();
+            waitMS = std::min(waitMS, std::max(remain, (int64_t)0) / 1000 + 1);
+        }
+
+        if (MessageQueue::WaitReady(pollHandles(), waitMS)) {
+            received = processReady(maxMessages);
+        }
+    }
+    processed += received;
+
+    // The responses of the calls run above, and the calls made by the functions and the callbacks.
+    processed += impl_->sender_->flush(maxMessages);
+
+    processed += impl_->respDispatcher_->expireDeadlines();
+
+    return processed;
+}
+
+void Veigar::setSendQueueLimit(const SendQueueLimit& limit) {
+    assert(impl_);
+    impl_->sendQueueLimit_ = limit;
+}
+
+SendQueueLimit Veigar::sendQueueLimit() const {
+    assert(impl_);
+    return impl_->sendQueueLimit_;
+}
+
+void Veigar::setPendingCallLimit(uint32_t maxPending) {
+    assert(callDisp_);
+    callDisp_->setPendingCallLimit(maxPending);
+}
+
+void Veigar::setFunctionCallLimit(const std::string& funcName, uint32_t maxInFlight) {
+    assert(callDisp_);
+    callDisp_->setFunctionCallLimit(funcName, maxInFlight);
+}
+
+void Veigar::setCallerCallLimit(const std::string& callerChannelName, uint32_t maxInFlight) {
+    assert(callDisp_);
+    callDisp_->setCallerCallLimit(callerChannelName, maxInFlight);
+}
+
+void Veigar::setFlowControl(const FlowControlLimit& limit) {
+    assert(impl_);
+    impl_->flowControlLimit_ = limit;
+}
+
+FlowControlLimit Veigar::flowControl() const {
+    assert(impl_);
+    return impl_->flowControlLimit_;
+}
+
+void Veigar::setCallbackPolicy(CallbackPolicy policy, Executor executor) {
+    assert(impl_);
+    if (policy == CallbackPolicy::EXECUTOR && !executor) {
+        veigar::log("Veigar: [WARNING] No executor for the callbacks, they will be run on the response dispatcher thread.\n");
+        policy = CallbackPolicy::INLINE;
+    }
+
+    impl_->callbackPolicy_ = policy;
+    impl_->callbackExecutor_ = executor;
+}
+
+CallbackPolicy Veigar::callbackPolicy() const {
+    assert(impl_);
+    return impl_->callbackPolicy_;
+}
+
+Executor Veigar::callbackExecutor() const {
+    assert(impl_);
+    return impl_->callbackExecutor_;
+}
+
+void Veigar::setCpuAffinity(ThreadRole role, const std::vector<uint32_t>& cpus) {
+    assert(impl_);
+    assert((uint32_t)role < kThreadRoleNumber);
+    impl_->cpus_[(uint32_t)role] = cpus;
+}
+
+std::vector<uint32_t> Veigar::cpuAffinity(ThreadRole role) const {
+    assert(impl_);
+    assert((uint32_t)role < kThreadRoleNumber);
+    return impl_->cpus_[(uint32_t)role];
+}
+
+void Veigar::setNumaNode(int32_t node) {
+    assert(impl_);
+    impl_->numaNode_ = node;
+}
+
+int32_t Veigar::numaNode() const {
+    assert(impl_);
+    return impl_->numaNode_;
+}
+
+Statistics Veigar::statistics() const {
+    assert(impl_);
+    Statistics stats;
+    if (!impl_->isInit_) {
+        return stats;
+    }
+
+    if (callDisp_) {
+        callDisp_->collectStatistics(stats);
+    }
+
+    if (impl_->respDispatcher_) {
+        impl_->respDispatcher_->collectStatistics(stats);
+    }
+
+    if (impl_->sender_) {
+        impl_->sender_->collectStatistics(stats);
+    }
+
+    if (impl_->recvBufferPool_) {
+        impl_->recvBufferPool_->collectStatistics(stats);
+    }
+
+    return stats;
+}
+
+std::vector<CallResult> Veigar::callBatch(const std::string& targetChannel, uint32_t timeoutMS, const CallBatch& batch) {
+    return callBatch(CallPriority::NORMAL, targetChannel, timeoutMS, batch);
+}
+
+std::vector<CallResult> Veigar::callBatch(CallPriority priority,
+                                          const std::string& targetChannel,
+                                          uint32_t timeoutMS,
+                                          const CallBatch& batch) {
+    const size_t n = batch.size();
+    std::vector<CallResult> results(n);
+    if (n == 0) {
+        return results;
+    }
+
+    CallResult batchRet;
+    batchRet.errCode = ErrorCode::FAILED;
+
+    const std::string callId = getNextCallId("batch");
+    assert(!callId.empty());
+
+    do {
+        if (callId.empty()) {
+            batchRet.errorMessage = "Unable to generate call id.";
+            break;
+        }
+
+        std::shared_ptr<std::promise<CallResult>> p = std::make_shared<std::promise<CallResult>>();
+        std::future<CallResult> ft = p->get_future();
+
+        try {
+            // flag(5) - callId - callerChannelName - "" - [parallel, [[funcName, args], ...]] [- deadline]
+            const bool withDeadline = deadlinePropagation();
+            auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
+            veigar_msgpack::packer<veigar_msgpack::sbuffer> pk(*buffer);
+            pk.pack_array(withDeadline ? 6 : 5);
+            pk.pack(5);
+            pk.pack(callId);
+            pk.pack(channelName());
+            pk.pack(std::string());
+            pk.pack_array(2);
+            pk.pack(batch.isParallel());
+            pk.pack_array((uint32_t)n);
+            buffer->write(batch.entries_.data(), batch.entries_.size());
+
+            const int64_t deadline = deadlineAfter(timeoutMS);
+            if (withDeadline) {
+                pk.pack(deadline);
+            }
+
+            ResultMeta retMeta;
+            retMeta.metaType = 0;
+            retMeta.p = p;
+            retMeta.deadline = deadline;
+
+            ErrorCode errCode = ErrorCode::FAILED;
+            std::string errMsg;
+            if (!sendCall(priority, targetChannel, timeoutMS, buffer, callId, "batch", retMeta, errCode, errMsg)) {
+                batchRet.errCode = errCode;
+                batchRet.errorMessage = "Send failed: " + (errMsg.empty() ? std::string("Unknown.") : errMsg);
+                break;
+            }
+        } catch (std::exception& e) {
+            batchRet.errorMessage = e.what();
+            break;
+        }
+
+        batchRet = ft.get();
+        releaseCall(callId);
+    } while (false);
+
+    if (batchRet.isSuccess()) {
+        try {
+            std::vector<std::tuple<veigar_msgpack::object, veigar_msgpack::object>> entries;
+            batchRet.obj.get().convert(entries);
+            if (entries.size() != n) {
+                batchRet.errorMessage = "The number of results does not match the number of calls.";
+            }
+            else {
+                for (size_t i = 0; i < n; i++) {
+                    // Same as the error of a call, either a message or [error code, message] when the entry was not run.
+                    results[i].errCode = ErrorCode::SUCCESS;
+                    const veigar_msgpack::object& err = std::get<0>(entries[i]);
+                    if (err.type == veigar_msgpack::type::ARRAY) {
+                        std::tuple<int32_t, std::string> typedError;
+                        err.convert(typedError);
+                        results[i].errCode = (ErrorCode)std::get<0>(typedError);
+                        results[i].errorMessage = std::get<1>(typedError);
+                    }
+                    else if (!err.is_nil()) {
+                        results[i].errorMessage = err.as<std::string>();
+                    }
+                    results[i].obj = veigar_msgpack::clone(std::get<1>(entries[i]));
+                }
+                return results;
+            }
+        } catch (std::exception& e) {
+            batchRet.errorMessage = StringHelper::StringPrintf("An exception occurred during parsing batch results: %s.", e.what());
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        results[i].errCode = batchRet.errCode;
+        results[i].errorMessage = batchRet.errorMessage;
+    }
+    return results;
+}
+
+std::shared_ptr<MultiCallResult> Veigar::sendMultiCall(MultiResultCallback cb,
+                                                       const std::vector<std::string>& targetChannels,
+                                                       uint32_t timeoutMS,
+                                                       const std::string& funcName,
+                                                       const veigar_msgpack::sbuffer& args) {
+    std::shared_ptr<MultiCallResult> mcr(new MultiCallResult(targetChannels, cb));
+
+    const int64_t deadline = deadlineAfter(timeoutMS);
+    const std::string curChannelName = channelName();
+    const bool withDeadline = deadlinePropagation();
+
+    for (size_t i = 0; i < targetChannels.size(); i++) {
+        CallResult failedRet;
+        failedRet.errCode = ErrorCode::FAILED;
+
+        const std::string callId = getNextCallId(funcName);
+        assert(!callId.empty());
+        if (callId.empty()) {
+            failedRet.errorMessage = "Unable to generate call id.";
+            mcr->complete(i, failedRet);
+            continue;
+        }
+
+        if (args.size() == 0) {
+            failedRet.errorMessage = "Unable to pack the arguments.";
+            mcr->complete(i, failedRet);
+            continue;
+        }
+
+        try {
+            // Only the head differs between the targets, the arguments are copied as they are.
+            // flag(0) - callId - callerChannelName - funcName - args [- deadline], see packCall.
+            auto buffer = std::make_shared<veigar_msgpack::sbuffer>(callId.size() + curChannelName.size() + funcName.size() + args.size() + 32);
+            veigar_msgpack::packer<veigar_msgpack::sbuffer> pk(*buffer);
+            pk.pack_array(withDeadline ? 6 : 5);
+            pk.pack(0);
+            pk.pack(callId);
+            pk.pack(curChannelName);
+            pk.pack(funcName);
+            buffer->write(args.data(), args.size());
+            if (withDeadline) {
+                pk.pack(deadline);
+            }
+
+            ResultMeta retMeta;
+            mcr->bindResultMeta(i, retMeta);
+            retMeta.deadline = deadline;
+
+            ErrorCode errCode = ErrorCode::FAILED;
+            std::string errMsg;
+            if (!sendCall(CallPriority::NORMAL, targetChannels[i], timeoutMS, buffer, callId, funcName, retMeta, errCode, errMsg)) {
+                failedRet.errCode = errCode;
+                failedRet.errorMessage = "Send failed: " + (errMsg.empty() ? std::string("Unknown.") : errMsg);
+                mcr->complete(i, failedRet);
+            }
+        } catch (std::exception& e) {
+            failedRet.errorMessage = e.what();
+            mcr->complete(i, failedRet);
+        }
+    }
+
+    return mcr;
+}
+
+std::shared_ptr<StreamReader> Veigar::sendStreamCall(CallPriority priority,
+                                                     const std::string& targetChannel,
+                                                     uint32_t timeoutMS,
+                                                     std::shared_ptr<veigar_msgpack::sbuffer> buffer,
+                                                     const std::string& callId,
+                                                     const std::string& funcName) {
+    // The reader may outlive this instance.
+    std::weak_ptr<InstanceHandle> handle = impl_->handle_;
+    std::shared_ptr<StreamReader> reader(new StreamReader(
+        callId,
+        [handle, targetChannel, callId](int64_t credit) {
+            InstanceHandle::Run(handle, [&](Veigar* veigar) { veigar->sendStreamCredit(targetChannel, callId, credit); });
+        },
+        [handle, callId]() {
+            InstanceHandle::Run(handle, [&](Veigar* veigar) { veigar->releaseCall(callId); });
+        }));
+
+    ResultMeta retMeta;
+    reader->bindResultMeta(retMeta);
+
+    ErrorCode errCode = ErrorCode::FAILED;
+    std::string errMsg;
+    if (!sendCall(priority, targetChannel, timeoutMS, buffer, callId, funcName, retMeta, errCode, errMsg)) {
+        veigar::log("Veigar: [ERROR] Failed to send stream call %s: %s.\n", callId.c_str(), errMsg.c_str());
+        return nullptr;
+    }
+
+    return reader;
+}
+
+void Veigar::sendStreamCredit(const std::string& targetChannel, const std::string& callId, int64_t credit) {
+    try {
+        // The credits go through the high priority lane, so that a busy target does not stall its own streams.
+        auto creditObj = std::make_tuple(4, callId, channelName(), std::string(), credit);
+        auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
+        veigar_msgpack::pack(*buffer, creditObj);
+
+        ResultMeta retMeta;
+        retMeta.metaType = 2;
+
+        ErrorCode errCode = ErrorCode::FAILED;
+        std::string errMsg;
+        sendCall(CallPriority::HIGH, targetChannel, VEIGAR_WRITE_NOTIFICATION_QUEUE_TIMEOUT, buffer, callId, std::string(), retMeta, errCode, errMsg);
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to send stream credit %s: %s.\n", callId.c_str(), e.what());
+    }
+}
+
+void Veigar::sendCancel(const std::string& targetChannel, const std::string& callId) {
+    try {
+        // Like the stream credits, through the high priority lane to overtake the call.
+        auto cancelObj = std::make_tuple(6, callId, channelName(), std::string(), veigar_msgpack::type::nil_t());
+        auto buffer = std::make_shared<veigar_msgpack::sbuffer>();
+        veigar_msgpack::pack(*buffer, cancelObj);
+
+        ResultMeta retMeta;
+        retMeta.metaType = 2;
+
+        ErrorCode errCode = ErrorCode::FAILED;
+        std::string errMsg;
+        sendCall(CallPriority::HIGH, targetChannel, VEIGAR_WRITE_NOTIFICATION_QUEUE_TIMEOUT, buffer, callId, std::string(), retMeta, errCode, errMsg);
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to send cancellation %s: %s.\n", callId.c_str(), e.what());
+    }
+}
+
+bool Veigar::createTopic(const std::string& topic, TopicPolicy policy, uint32_t capacity) {
+    assert(impl_);
+    if (!impl_->isInit_) {
+        veigar::log("Veigar: [ERROR] Instance is not initialized.\n");
+        return false;
+    }
+    return impl_->topicHub_->createTopic(topic, policy, capacity, VEIGAR_TOPIC_MAX_SUBSCRIBER_NUMBER);
+}
+
+void Veigar::destroyTopic(const std::string& topic) {
+    assert(impl_);
+    if (impl_->isInit_) {
+        impl_->topicHub_->destroyTopic(topic);
+    }
+}
+
+bool Veigar::publishData(const std::string& topic, const uint8_t* buf, size_t bufSize, uint32_t timeoutMS) {
+    assert(impl_);
+    if (!impl_->isInit_) {
+        veigar::log("Veigar: [ERROR] Instance is not initialized.\n");
+        return false;
+    }
+    return impl_->topicHub_->publish(topic, buf, bufSize, timeoutMS);
+}
+
+bool Veigar::subscribe(const std::string& topic, TopicCallback cb) {
+    assert(impl_);
+    if (!impl_->isInit_) {
+        veigar::log("Veigar: [ERROR] Instance is not initialized.\n");
+        return false;
+    }
+    return impl_->topicHub_->subscribe(topic, cb);
+}
+
+void Veigar::unsubscribe(const std::string& topic) {
+    assert(impl_);
+    if (impl_->isInit_) {
+        impl_->topicHub_->unsubscribe(topic);
+    }
+}
+
+int64_t Veigar::deadlineAfter(uint32_t timeoutMS) {
+    return TimeUtil::GetMonotonicTimestamp() + (int64_t)timeoutMS * 1000;
+}
+
 std::string Veigar::getNextCallId(const std::string& funcName) const {
     assert(impl_);
     uint32_t idx = impl_->callIndex_.fetch_add(1);
@@ -241,16 +906,19 @@ std::string Veigar::getNextCallId(const std::string& funcName) const {
     return callId;
 }
 
-bool Veigar::sendCall(const std::string& channelName,
+bool Veigar::sendCall(CallPriority priority,
+                      const std::string& channelName,
                       uint32_t timeoutMS,
                       std::shared_ptr<veigar_msgpack::sbuffer> buffer,
                       const std::string& callId,
                       const std::string& funcName,
                       const ResultMeta& retMeta,
+                      ErrorCode& errCode,
                       std::string& exceptionMsg) {
     assert(impl_);
     assert(timeoutMS > impl_->processRWTimeout_ && "The call timeout should be greater than the timeout for acquiring the inter-process read-write lock.");
 
+    errCode = ErrorCode::FAILED;
     if (!impl_->sender_) {
         return false;
     }
@@ -258,7 +926,9 @@ bool Veigar::sendCall(const std::string& channelName,
     Sender::CallMeta cm;
     cm.channel = channelName;
     cm.callId = callId;
+    cm.priority = priority;
     cm.resultMeta = retMeta;
+    cm.resultMeta.channel = channelName;
     cm.dataSize = buffer ? buffer->size() : 0;
     cm.data = (uint8_t*)malloc(cm.dataSize);
     if (!cm.data) {
@@ -273,7 +943,16 @@ bool Veigar::sendCall(const std::string& channelName,
     cm.timeout = timeoutMS * 1000;
     cm.startCallTimePoint = TimeUtil::GetCurrentTimestamp();
 
-    impl_->sender_->addCall(cm);
+    // Same as the deadline of the call, whether it is sent or not (see packCall), notifications and stream calls have none.
+    if (retMeta.metaType != 2 && retMeta.metaType != 3) {
+        cm.deadline = retMeta.deadline > 0 ? retMeta.deadline : deadlineAfter(timeoutMS);
+    }
+
+    errCode = impl_->sender_->addCall(cm, exceptionMsg);
+    if (errCode != ErrorCode::SUCCESS) {
+        free(cm.data);
+        return false;
+    }
 
     return true;
 }
@@ -283,7 +962,17 @@ bool Veigar::sendResponse(const std::string& targetChannel,
                           size_t bufSize,
                           std::string& errMsg) {
     assert(impl_);
-    if (!impl_->sender_) {
+    bool result = false;
+    errMsg = "The channel has been uninitialized.";
+    InstanceHandle::Run(impl_->handle_, [&](Veigar* veigar) { result = veigar->impl_->sendResponse(targetChannel, buf, bufSize, errMsg); });
+    return result;
+}
+
+bool Veigar::Impl::sendResponse(const std::string& targetChannel,
+                                const uint8_t* buf,
+                                size_t bufSize,
+                                std::string& errMsg) {
+    if (!sender_) {
         return false;
     }
 
@@ -300,7 +989,10 @@ bool Veigar::sendResponse(const std::string& targetChannel,
     rm.timeout = VEIGAR_WRITE_RESPONSE_QUEUE_TIMEOUT * 1000;
     rm.startCallTimePoint = TimeUtil::GetCurrentTimestamp();
 
-    impl_->sender_->addResp(rm);
+    if (!sender_->addResp(rm, errMsg)) {
+        free(rm.data);
+        return false;
+    }
 
     return true;
 }
@@ -311,4 +1003,24 @@ void Veigar::releaseCall(const std::string& callId) {
     }
 }
 
+bool Veigar::cancel(const std::string& callId) {
+    assert(impl_);
+    if (!impl_->isInit_ || !impl_->sender_ || !impl_->respDispatcher_) {
+        return false;
+    }
+
+    // Not sent yet, the target never sees it.
+    if (impl_->sender_->cancelCall(callId)) {
+        return true;
+    }
+
+    std::string targetChannel;
+    if (!impl_->respDispatcher_->cancelCall(callId, targetChannel)) {
+        return false;
+    }
+
+    sendCancel(targetChannel, callId);
+    return true;
+}
+
 }  // namespace veigar
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "work_stealing_pool.h"
+#include <assert.h>
+#include "veigar/config.h"
+#include "log.h"
+
+namespace veigar {
+namespace {
+thread_local WorkStealingPool* tlsPool = nullptr;
+thread_local size_t tlsSlotIndex = 0;
+}  // namespace
+
+WorkStealingPool::~WorkStealingPool() {
+    stop();
+}
+
+void WorkStealingPool::setPlacement(const std::string& threadName, const std::vector<uint32_t>& cpus) {
+    workers_.setPlacement(threadName, cpus);
+}
+
+bool WorkStealingPool::start(uint32_t minThreadNumber, uint32_t maxThreadNumber) {
+    assert(slots_.empty());
+    if (!slots_.empty() || maxThreadNumber == 0) {
+        return false;
+    }
+
+    stop_.store(false);
+    pending_.store(0);
+
+    for (uint32_t i = 0; i < maxThreadNumber; ++i) {
+        slots_.emplace_back(new Slot());
+    }
+
+    return workers_.start(minThreadNumber, maxThreadNumber, std::bind(&WorkStealingPool::workerProc, this));
+}
+
+void WorkStealingPool::stop() {
+    stop_.store(true);
+
+    workers_.stop([this]() {
+        std::lock_guard<std::mutex> lg(sleepMutex_);
+        sleepCV_.notify_all();
+    });
+
+    size_t discarded = 0;
+    for (auto& slot : slots_) {
+        discarded += slot->tasks.size();
+    }
+    if (discarded > 0) {
+        veigar::log("Veigar: [WARNING] %d pending tasks have been discarded by stopping the pool.\n", (int)discarded);
+    }
+
+    slots_.clear();
+    pending_.store(0);
+}
+
+bool WorkStealingPool::submit(Task task) {
+    if (stop_.load() || slots_.empty() || !task) {
+        return false;
+    }
+
+    size_t idx = 0;
+    if (tlsPool == this) {
+        idx = tlsSlotIndex;
+    }
+    else {
+        idx = next_.fetch_add(1) % slots_.size();
+    }
+
+    Slot* slot = slots_[idx].get();
+    {
+        std::lock_guard<std::mutex> lg(slot->mutex);
+        slot->tasks.emplace_back(std::move(task));
+        pending_++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(sleepMutex_);
+        sleepCV_.notify_one();
+    }
+
+    workers_.grow(pending_.load() - 1);
+
+    return true;
+}
+
+int64_t WorkStealingPool::pending() const {
+    return pending_.load();
+}
+
+uint32_t WorkStealingPool::threadNumber() const {
+    return workers_.size();
+}
+
+uint32_t WorkStealingPool::busyThreadNumber() const {
+    return workers_.busy();
+}
+
+bool WorkStealingPool::isWorkerThread() const {
+    return tlsPool == this;
+}
+
+uint32_t WorkStealingPool::pinFailedThreadNumber() const {
+    return workers_.pinFailed();
+}
+
+void WorkStealingPool::workerProc() {
+    size_t slotIndex = claimSlot();
+    tlsPool = this;
+    tlsSlotIndex = slotIndex;
+
+    while (!stop_.load()) {
+        Task task;
+        if (take(slotIndex, task)) {
+            workers_.enterBusy();
+            try {
+                task();
+            } catch (std::exception& e) {
+                veigar::log("Veigar: [ERROR] Exception occurred while running task: %s.\n", e.what());
+            } catch (...) {
+                veigar::log("Veigar: [ERROR] Unknown exception occurred while running task.\n");
+            }
+            workers_.leaveBusy();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> ul(sleepMutex_);
+        const bool woken = sleepCV_.wait_for(ul,
+                                             std::chrono::milliseconds(VEIGAR_WORKER_IDLE_TIMEOUT),
+                                             [this]() { return stop_.load() || pending_.load() > 0; });
+        ul.unlock();
+
+        if (!woken) {
+            // Give the slot back before counting as retired, the worker WorkerGroup may start right after needs one.
+            releaseSlot(slotIndex);
+            if (workers_.retire()) {
+                tlsPool = nullptr;
+                return;
+            }
+            slotIndex = claimSlot();
+            tlsSlotIndex = slotIndex;
+        }
+    }
+
+    tlsPool = nullptr;
+    releaseSlot(slotIndex);
+}
+
+bool WorkStealingPool::take(size_t slotIndex, Task& task) {
+    const size_t slotNum = slots_.size();
+    for (size_t i = 0; i < slotNum; ++i) {
+        Slot* slot = slots_[(slotIndex + i) % slotNum].get();
+        std::lock_guard<std::mutex> lg(slot->mutex);
+        if (slot->tasks.empty()) {
+            continue;
+        }
+
+        if (i == 0) {
+            task = std::move(slot->tasks.front());
+            slot->tasks.pop_front();
+        }
+        else {
+            task = std::move(slot->tasks.back());
+            slot->tasks.pop_back();
+        }
+        pending_--;
+        return true;
+    }
+    return false;
+}
+
+size_t WorkStealingPool::claimSlot() {
+    std::lock_guard<std::mutex> lg(slotsMutex_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (!slots_[i]->owned) {
+            slots_[i]->owned = true;
+            return i;
+        }
+    }
+
+    // WorkerGroup never runs more workers than slots.
+    assert(false);
+    return 0;
+}
+
+void WorkStealingPool::releaseSlot(size_t slotIndex) {
+    // The tasks left in the slot will be stolen by other workers.
+    std::lock_guard<std::mutex> lg(slotsMutex_);
+    slots_[slotIndex]->owned = false;
+}
+}  // namespace veigar
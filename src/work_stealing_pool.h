@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_WORK_STEALING_POOL_H_
+#define VEIGAR_WORK_STEALING_POOL_H_
+#pragma once
+
+#include <inttypes.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "worker_group.h"
+
+namespace veigar {
+// Thread pool with a task deque per worker.
+//
+// Tasks submitted from a worker go to that worker's deque, other tasks are spread over the deques.
+// A worker takes tasks from the front of its own deque and steals from the back of the other deques when it runs dry.
+// The number of workers is elastic, see WorkerGroup.
+class WorkStealingPool {
+   public:
+    using Task = std::function<void()>;
+
+    WorkStealingPool() noexcept = default;
+    ~WorkStealingPool();
+
+    // See WorkerGroup::setPlacement.
+    void setPlacement(const std::string& threadName, const std::vector<uint32_t>& cpus);
+
+    bool start(uint32_t minThreadNumber, uint32_t maxThreadNumber);
+
+    // Waits for the running tasks to return and joins the workers.
+    // The tasks that have not started are destroyed without being run, only their number is logged,
+    // the owner must not depend on them, e.g. CallDispatcher clears the calls they would have dispatched.
+    // Must not be called from a worker of this pool, see isWorkerThread.
+    void stop();
+
+    bool submit(Task task);
+
+    // Whether the calling thread is a worker of this pool, which stop can not join.
+    bool isWorkerThread() const;
+
+    // The number of tasks that have been submitted but not yet started.
+    int64_t pending() const;
+
+    // The number of worker threads and the number of them running a task.
+    uint32_t threadNumber() const;
+    uint32_t busyThreadNumber() const;
+    uint32_t pinFailedThreadNumber() const;
+
+   private:
+    struct Slot {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        bool owned = false;
+    };
+
+    void workerProc();
+    bool take(size_t slotIndex, Task& task);
+    size_t claimSlot();
+    void releaseSlot(size_t slotIndex);
+
+   private:
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::mutex slotsMutex_;
+
+    std::atomic<int64_t> pending_ = {0};
+    std::atomic<uint32_t> next_ = {0};
+    std::atomic_bool stop_ = {false};
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCV_;
+
+    WorkerGroup workers_;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_WORK_STEALING_POOL_H_
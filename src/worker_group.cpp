@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include "worker_group.h"
+#include <assert.h>
+#include <algorithm>
+#include "log.h"
+#include "thread_util.h"
+
+namespace veigar {
+WorkerGroup::~WorkerGroup() {
+    stop();
+}
+
+void WorkerGroup::setPlacement(const std::string& threadName, const std::vector<uint32_t>& cpus) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    assert(threads_.empty());
+    threadName_ = threadName;
+    cpus_ = cpus;
+}
+
+bool WorkerGroup::start(uint32_t minNumber, uint32_t maxNumber, std::function<void()> proc) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    assert(threads_.empty());
+    if (!threads_.empty() || !proc) {
+        return false;
+    }
+
+    stopping_ = false;
+    minNumber_ = minNumber;
+    maxNumber_ = std::max(minNumber, maxNumber);
+    size_ = 0;
+    busy_ = 0;
+    pinFailed_ = 0;
+    proc_ = proc;
+
+    for (uint32_t i = 0; i < minNumber_; ++i) {
+        spawn();
+    }
+
+    return true;
+}
+
+void WorkerGroup::stop(const std::function<void()>& wakeup) {
+    std::list<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lg(mutex_);
+        stopping_ = true;
+        threads.swap(threads_);
+        retired_.clear();
+    }
+
+    if (wakeup) {
+        for (size_t i = 0; i < threads.size(); ++i) {
+            wakeup();
+        }
+    }
+
+    for (std::thread& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    std::lock_guard<std::mutex> lg(mutex_);
+    size_ = 0;
+    busy_ = 0;
+}
+
+void WorkerGroup::enterBusy() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    busy_++;
+}
+
+void WorkerGroup::leaveBusy() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    assert(busy_ > 0);
+    if (busy_ > 0) {
+        busy_--;
+    }
+}
+
+bool WorkerGroup::grow(int64_t backlog) {
+    std::lock_guard<std::mutex> lg(mutex_);
+    reap();
+
+    if (stopping_ || size_ >= maxNumber_) {
+        return false;
+    }
+
+    const int64_t idle = (int64_t)size_ - (int64_t)busy_;
+    int64_t wanted = std::max(backlog, (int64_t)0) + 1 - idle;
+    wanted = std::min(wanted, (int64_t)(maxNumber_ - size_));
+
+    bool spawned = false;
+    for (int64_t i = 0; i < wanted; ++i) {
+        if (!spawn()) {
+            break;
+        }
+        spawned = true;
+    }
+
+    return spawned;
+}
+
+bool WorkerGroup::retire() {
+    std::lock_guard<std::mutex> lg(mutex_);
+    if (stopping_ || size_ <= minNumber_) {
+        return false;
+    }
+
+    size_--;
+    retired_.push_back(std::this_thread::get_id());
+    return true;
+}
+
+uint32_t WorkerGroup::size() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return size_;
+}
+
+uint32_t WorkerGroup::busy() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return busy_;
+}
+
+const std::vector<uint32_t>& WorkerGroup::cpus() const {
+    return cpus_;
+}
+
+uint32_t WorkerGroup::pinFailed() const {
+    std::lock_guard<std::mutex> lg(mutex_);
+    return pinFailed_;
+}
+
+bool WorkerGroup::spawn() {
+    // mutex_ must be locked by caller.
+    try {
+        threads_.emplace_back(std::thread(&WorkerGroup::threadProc, this));
+        size_++;
+    } catch (std::exception& e) {
+        veigar::log("Veigar: [ERROR] Failed to create worker thread: %s.\n", e.what());
+        return false;
+    }
+    return true;
+}
+
+void WorkerGroup::threadProc() {
+    if (!threadName_.empty()) {
+        ThreadUtil::SetCurrentThreadName(threadName_);
+    }
+
+    if (!cpus_.empty() && !ThreadUtil::SetCurrentThreadAffinity(cpus_)) {
+        veigar::log("Veigar: [WARNING] Failed to pin thread %s to the CPUs.\n", threadName_.c_str());
+        std::lock_guard<std::mutex> lg(mutex_);
+        pinFailed_++;
+    }
+
+    proc_();
+}
+
+void WorkerGroup::reap() {
+    // mutex_ must be locked by caller.
+    // The retired threads are returning from the worker procedure, joining them will not block for long.
+    for (const std::thread::id& id : retired_) {
+        for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+            if (it->get_id() == id) {
+                if (it->joinable()) {
+                    it->join();
+                }
+                threads_.erase(it);
+                break;
+            }
+        }
+    }
+    retired_.clear();
+}
+}  // namespace veigar
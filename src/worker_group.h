@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#ifndef VEIGAR_WORKER_GROUP_H_
+#define VEIGAR_WORKER_GROUP_H_
+#pragma once
+
+#include <inttypes.h>
+#include <functional>
+#include <list>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace veigar {
+// Elastic group of worker threads.
+//
+// The group starts with 'minNumber' threads, grows toward 'maxNumber' when the owner reports backlog
+// or every worker is busy, and lets surplus workers retire after they have been idle.
+// The owner is responsible for making the worker procedure return when it stops the group.
+class WorkerGroup {
+   public:
+    WorkerGroup() noexcept = default;
+    ~WorkerGroup();
+
+    // Name the worker threads and pin them to 'cpus' (no pinning if empty).
+    // Must be called before start.
+    void setPlacement(const std::string& threadName, const std::vector<uint32_t>& cpus);
+
+    bool start(uint32_t minNumber, uint32_t maxNumber, std::function<void()> proc);
+
+    // Stop growing, call 'wakeup' once per worker and join all worker threads.
+    // The worker procedures must return once they have been woken up.
+    void stop(const std::function<void()>& wakeup = nullptr);
+
+    // Called by worker when it picks up/finishes a piece of work.
+    void enterBusy();
+    void leaveBusy();
+
+    // Called by worker with the backlog remaining after it picked up a piece of work.
+    // Spawn workers until there is one idle worker for each backlog item plus one standby worker,
+    // so that a long running piece of work can not starve the queue.
+    // Return true if any worker has been spawned.
+    bool grow(int64_t backlog);
+
+    // Called by worker after it has been idle for a while.
+    // Return true if the worker should exit.
+    bool retire();
+
+    uint32_t size() const;
+    uint32_t busy() const;
+
+    const std::vector<uint32_t>& cpus() const;
+
+    // The number of workers that could not be pinned to the CPUs.
+    uint32_t pinFailed() const;
+
+   private:
+    bool spawn();
+    void threadProc();
+    void reap();
+
+   private:
+    mutable std::mutex mutex_;
+    bool stopping_ = false;
+    uint32_t minNumber_ = 0;
+    uint32_t maxNumber_ = 0;
+    uint32_t size_ = 0;
+    uint32_t busy_ = 0;
+    uint32_t pinFailed_ = 0;
+    std::string threadName_;
+    std::vector<uint32_t> cpus_;
+    std::function<void()> proc_;
+    std::list<std::thread> threads_;
+    std::vector<std::thread::id> retired_;
+};
+}  // namespace veigar
+#endif  // !VEIGAR_WORKER_GROUP_H_
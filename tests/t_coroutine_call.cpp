@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <thread>
+#include <future>
+#include "catch.hpp"
+#include "veigar/veigar.h"
+
+#if VEIGAR_HAS_COROUTINE
+namespace {
+// Starts eagerly and destroys itself when done.
+struct FireAndForget {
+    struct promise_type {
+        FireAndForget get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+FireAndForget callAdd(veigar::Veigar& vg, std::string target, std::promise<int>& p) {
+    veigar::CallResult ret = co_await vg.call(target, 1000, "add", 1, 2);
+    p.set_value(ret.isSuccess() ? ret.obj.get().as<int>() : -1);
+}
+
+FireAndForget callSlow(veigar::Veigar& vg, std::string target, std::promise<veigar::ErrorCode>& p) {
+    veigar::CallResult ret = co_await vg.call(target, 200, "slow");
+    p.set_value(ret.errCode);
+}
+
+FireAndForget callWithExecutor(veigar::Veigar& vg, veigar::Executor executor, std::string target, std::promise<std::thread::id>& p) {
+    veigar::CallResult ret = co_await vg.call(executor, target, 1000, "add", 3, 4);
+    const bool success = ret.isSuccess() && ret.obj.get().as<int>() == 7;
+    p.set_value(success ? std::this_thread::get_id() : std::thread::id());
+}
+}  // namespace
+
+TEST_CASE("coroutine-call") {
+    std::string baseName = "coroutine-call-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.bind("slow", []() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(800));
+        return 0;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    std::promise<int> addPromise;
+    callAdd(vg2, baseName + "-1", addPromise);
+    std::future<int> addFuture = addPromise.get_future();
+    REQUIRE(addFuture.wait_for(std::chrono::milliseconds(1000)) != std::future_status::timeout);
+    CHECK(addFuture.get() == 3);
+
+    // The coroutine is resumed at the deadline, not when the slow function returns.
+    std::promise<veigar::ErrorCode> slowPromise;
+    const auto start = std::chrono::steady_clock::now();
+    callSlow(vg2, baseName + "-1", slowPromise);
+    std::future<veigar::ErrorCode> slowFuture = slowPromise.get_future();
+    REQUIRE(slowFuture.wait_for(std::chrono::milliseconds(1000)) != std::future_status::timeout);
+    CHECK(slowFuture.get() == veigar::ErrorCode::TIMEOUT);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(600));
+
+    // The coroutine is resumed by the executor.
+    std::thread::id executorThreadId;
+    std::vector<std::thread> executorThreads;
+    std::mutex executorMutex;
+    veigar::Executor executor = [&](std::function<void()> task) {
+        std::lock_guard<std::mutex> lg(executorMutex);
+        executorThreads.emplace_back([task]() { task(); });
+        executorThreadId = executorThreads.back().get_id();
+    };
+
+    std::promise<std::thread::id> executorPromise;
+    callWithExecutor(vg2, executor, baseName + "-1", executorPromise);
+    std::future<std::thread::id> executorFuture = executorPromise.get_future();
+    REQUIRE(executorFuture.wait_for(std::chrono::milliseconds(1000)) != std::future_status::timeout);
+    const std::thread::id resumedThreadId = executorFuture.get();
+    {
+        std::lock_guard<std::mutex> lg(executorMutex);
+        CHECK(resumedThreadId == executorThreadId);
+    }
+
+    for (std::thread& t : executorThreads) {
+        t.join();
+    }
+
+    // Wait for the slow function, so that its response does not outlive the channel.
+    std::this_thread::sleep_for(std::chrono::milliseconds(800));
+
+    vg1.uninit();
+    vg2.uninit();
+}
+#endif  // VEIGAR_HAS_COROUTINE
@@ -12,8 +12,16 @@
 #include <iostream>
 #include <map>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <future>
 #include "catch.hpp"
 #include "veigar/veigar.h"
+#include "../src/message_queue.h"
+#include "../src/recv_buffer_pool.h"
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 TEST_CASE("inprocess-call-sync-1") {
     std::string baseName = "call-sync-1-" + std::to_string(time(nullptr));
@@ -247,4 +255,1830 @@ TEST_CASE("inprocess-call-async-recursion") {
 
     vg1.uninit();
     vg2.uninit();
-}
\ No newline at end of file
+}
+
+TEST_CASE("inprocess-call-elastic-dispatcher") {
+    std::string baseName = "call-elastic-" + std::to_string(time(nullptr));
+
+    std::atomic<int> running = {0};
+    std::atomic<int> maxRunning = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("slow", [&running, &maxRunning](int i) {
+        const int now = ++running;
+        int seen = maxRunning.load();
+        while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        running--;
+        return i;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    // The dispatcher pool grows when all of its threads are occupied by slow handlers,
+    // so the calls run concurrently instead of one after another.
+    std::vector<std::shared_ptr<veigar::AsyncCallResult>> acrs;
+    for (int i = 0; i < 4; i++) {
+        acrs.push_back(vg2.asyncCall(baseName + "-1", 3000, "slow", i));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(acrs[i]);
+        CHECK(acrs[i]->second.wait_for(std::chrono::milliseconds(3000)) != std::future_status::timeout);
+        auto cr = acrs[i]->second.get();
+        CHECK(cr.isSuccess());
+        CHECK(cr.obj.get().as<int>() == i);
+        vg2.releaseCall(acrs[i]->first);
+    }
+
+    // Only one dispatcher thread is started up front, overlapping calls mean the pool has grown.
+    CHECK(maxRunning.load() >= 2);
+    CHECK(maxRunning.load() <= VEIGAR_DISPATCHER_THREAD_NUMBER);
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-short-past-long") {
+    std::string baseName = "call-short-past-long-" + std::to_string(time(nullptr));
+
+    std::atomic<int> longDone = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("long", [&longDone]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        longDone++;
+        return 1;
+    }));
+    CHECK(vg1.bind("short", []() {
+        return 2;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    // Leave one dispatcher thread for the short call.
+    std::vector<std::shared_ptr<veigar::AsyncCallResult>> longAcrs;
+    for (int i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER - 1; i++) {
+        longAcrs.push_back(vg2.asyncCall(baseName + "-1", 3000, "long"));
+    }
+
+    // The short call is not queued behind the long running calls, it completes before any of them.
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 3000, "short");
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<int>() == 2);
+    CHECK(longDone.load() == 0);
+
+    for (auto& acr : longAcrs) {
+        REQUIRE(acr);
+        CHECK(acr->second.wait_for(std::chrono::milliseconds(3000)) != std::future_status::timeout);
+        CHECK(acr->second.get().isSuccess());
+        vg2.releaseCall(acr->first);
+    }
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-priority") {
+    std::string baseName = "call-priority-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    vg1.setPriorityPolicy(veigar::PriorityPolicy::WEIGHTED);
+    REQUIRE(vg1.priorityPolicy() == veigar::PriorityPolicy::WEIGHTED);
+    CHECK(vg1.bind("urgent", []() { return 1; }, veigar::CallPriority::HIGH));
+    CHECK(vg1.bind("normal", []() { return 2; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 1000, "urgent");
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<int>() == 1);
+
+    cr = vg2.syncCall(veigar::CallPriority::HIGH, baseName + "-1", 1000, "normal");
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<int>() == 2);
+
+    std::shared_ptr<veigar::AsyncCallResult> acr = vg2.asyncCall(veigar::CallPriority::LOW, baseName + "-1", 1000, "normal");
+    REQUIRE(acr);
+    REQUIRE(acr->second.wait_for(std::chrono::milliseconds(1000)) != std::future_status::timeout);
+    cr = acr->second.get();
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<int>() == 2);
+    vg2.releaseCall(acr->first);
+
+    std::promise<int> p;
+    veigar::ResultCallback cb = [&p](const veigar::CallResult& ret) {
+        p.set_value(ret.isSuccess() ? ret.obj.get().as<int>() : -1);
+    };
+    vg2.asyncCall(veigar::CallPriority::LOW, cb, baseName + "-1", 1000, "urgent");
+    std::future<int> f = p.get_future();
+    REQUIRE(f.wait_for(std::chrono::milliseconds(1000)) != std::future_status::timeout);
+    CHECK(f.get() == 1);
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+// The thread names and CPU affinity are only read back on Linux.
+#ifdef __linux__
+TEST_CASE("inprocess-call-placement") {
+    std::string baseName = "call-placement-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    vg1.setCpuAffinity(veigar::ThreadRole::CALL_DISPATCHER, {0});
+    vg1.setNumaNode(0);
+    CHECK(vg1.cpuAffinity(veigar::ThreadRole::CALL_DISPATCHER) == std::vector<uint32_t>{0});
+    CHECK(vg1.cpuAffinity(veigar::ThreadRole::SENDER).empty());
+    CHECK(vg1.bind("where", []() {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        return std::string(name) + ":" + std::to_string(CPU_COUNT(&cpuSet)) + ":" + std::to_string(CPU_ISSET(0, &cpuSet) ? 0 : -1);
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 1000, "where");
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<std::string>() == "veigar-call:1:0");
+
+    veigar::Statistics stats = vg1.statistics();
+    const veigar::ThreadStatistics& ts = stats.threads[(uint32_t)veigar::ThreadRole::CALL_DISPATCHER];
+    CHECK(ts.threadNumber >= 2);
+    CHECK(ts.cpus == std::vector<uint32_t>{0});
+    CHECK(ts.pinFailedThreadNumber == 0);
+    CHECK(stats.threads[(uint32_t)veigar::ThreadRole::SENDER].cpus.empty());
+    CHECK(stats.callQueue.memorySize > 0);
+    CHECK(stats.responseQueue.memorySize > 0);
+
+    // The call queue has a lane of the full capacity per priority.
+    CHECK(stats.callQueue.memorySize > stats.responseQueue.memorySize * (veigar::kCallPriorityNumber - 1));
+
+    // mbind may be unavailable (e.g. no NUMA support in the kernel), the queue is not bound then.
+    CHECK((stats.callQueue.numaNode == 0 || stats.callQueue.numaNode == -1));
+
+    veigar::Statistics stats2 = vg2.statistics();
+    CHECK(stats2.callQueue.numaNode == -1);
+
+    vg1.uninit();
+    vg2.uninit();
+
+    CHECK(vg1.statistics().callQueue.memorySize == 0);
+}
+#endif
+
+TEST_CASE("inprocess-call-deferred") {
+    std::string baseName = "call-deferred-" + std::to_string(time(nullptr));
+
+    std::mutex parkedMutex;
+    std::vector<std::pair<veigar::Responder, int>> parked;
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bindDeferred("park", [&parkedMutex, &parked](veigar::Responder r, int a) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        parked.emplace_back(r, a);
+    }));
+    CHECK(vg1.bindDeferred("now", [](veigar::Responder r) {
+        CHECK(r.isValid());
+        CHECK(r.respond(std::string("now")));
+        CHECK(!r.respond(std::string("again")));
+    }));
+    CHECK(vg1.bindDeferred("fail", [](veigar::Responder r) {
+        CHECK(r.respondError("failed"));
+    }));
+    CHECK(vg1.bindDeferred("drop", [](veigar::Responder) {}));
+    CHECK(vg1.bindDeferred("throw", [](veigar::Responder) {
+        throw std::runtime_error("oops");
+    }));
+    CHECK(vg1.bind("quick", []() { return 1; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    // Park more calls than there are dispatcher threads.
+    const int parkedNum = VEIGAR_DISPATCHER_THREAD_NUMBER * 4;
+    std::vector<std::shared_ptr<veigar::AsyncCallResult>> acrs;
+    for (int i = 0; i < parkedNum; i++) {
+        acrs.push_back(vg2.asyncCall(baseName + "-1", 3000, "park", i));
+    }
+
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        if (parked.size() == parkedNum)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    // The dispatcher threads are not held by the parked calls.
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 1000, "quick");
+    CHECK(cr.isSuccess());
+
+    cr = vg2.syncCall(baseName + "-1", 1000, "now");
+    CHECK(cr.isSuccess());
+    CHECK(cr.obj.get().as<std::string>() == "now");
+
+    cr = vg2.syncCall(baseName + "-1", 1000, "fail");
+    CHECK(cr.errorMessage == "failed");
+
+    cr = vg2.syncCall(baseName + "-1", 1000, "drop");
+    CHECK(!cr.isSuccess());
+    CHECK(!cr.errorMessage.empty());
+
+    cr = vg2.syncCall(baseName + "-1", 1000, "throw");
+    CHECK(!cr.isSuccess());
+    CHECK(cr.errorMessage.find("oops") != std::string::npos);
+
+    // Complete the parked calls from another thread.
+    std::thread completer([&parkedMutex, &parked]() {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        for (auto& p : parked) {
+            p.first.respond(p.second * 2);
+        }
+        parked.clear();
+    });
+    completer.join();
+
+    for (int i = 0; i < parkedNum; i++) {
+        REQUIRE(acrs[i]);
+        REQUIRE(acrs[i]->second.wait_for(std::chrono::milliseconds(2000)) != std::future_status::timeout);
+        veigar::CallResult ret = acrs[i]->second.get();
+        CHECK(ret.isSuccess());
+        CHECK(ret.obj.get().as<int>() == i * 2);
+        vg2.releaseCall(acrs[i]->first);
+    }
+
+    // Responding on another thread while the channel is uninitialized.
+    acrs.clear();
+    for (int i = 0; i < parkedNum; i++) {
+        acrs.push_back(vg2.asyncCall(baseName + "-1", 1000, "park", i));
+    }
+
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        if (parked.size() == parkedNum)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::thread racer([&parkedMutex, &parked]() {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        for (auto& p : parked) {
+            p.first.respond(p.second * 2);
+        }
+        parked.clear();
+    });
+    vg1.uninit();
+    racer.join();
+
+    // Some of the responses are discarded, those calls are left to time out.
+    for (int i = 0; i < parkedNum; i++) {
+        REQUIRE(acrs[i]);
+        vg2.releaseCall(acrs[i]->first);
+    }
+
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-notify") {
+    std::string baseName = "notify-" + std::to_string(time(nullptr));
+
+    std::atomic<int> sum = {0};
+    std::atomic<int> deferredNum = {0};
+    std::atomic<int> respondedNum = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("add", [&sum](int n) { sum += n; }));
+    CHECK(vg1.bindDeferred("deferred", [&deferredNum, &respondedNum](veigar::Responder r) {
+        deferredNum++;
+        if (r.isResponded() && !r.respond())
+            respondedNum++;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    for (int i = 1; i <= 100; i++) {
+        CHECK(vg2.notify(baseName + "-1", "add", i));
+    }
+    CHECK(vg2.notify(veigar::CallPriority::HIGH, baseName + "-1", "deferred"));
+    CHECK(vg2.notify(baseName + "-1", "not-exist", 1));
+
+    for (int i = 0; i < 100; i++) {
+        if (sum.load() == 5050 && deferredNum.load() == 1)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(sum.load() == 5050);
+    CHECK(deferredNum.load() == 1);
+    CHECK(respondedNum.load() == 1);
+
+    // The channel still works for calls after notifications.
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 1000, "add", 1);
+    CHECK(cr.isSuccess());
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-stream") {
+    std::string baseName = "call-stream-" + std::to_string(time(nullptr));
+
+    std::atomic<bool> cancelled = {false};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bindStream("range", [](veigar::StreamWriter w, int n) {
+        for (int i = 0; i < n; i++) {
+            if (!w.write(i))
+                return;
+        }
+        w.close();
+    }));
+    CHECK(vg1.bindStream("fail", [](veigar::StreamWriter w) {
+        for (int i = 0; i < 3; i++) {
+            w.write(std::to_string(i));
+        }
+        w.closeWithError("bad");
+    }));
+    CHECK(vg1.bindStream("throw", [](veigar::StreamWriter w) {
+        w.write(1);
+        throw std::runtime_error("oops");
+    }));
+    CHECK(vg1.bindStream("endless", [&cancelled](veigar::StreamWriter w) {
+        while (w.write(std::string(100, 'a'))) {
+        }
+        cancelled.store(w.isCancelled());
+    }));
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    // More items than the window and than the capacity of the response queue.
+    {
+        std::shared_ptr<veigar::StreamReader> reader = vg2.streamCall(baseName + "-1", 100, "range", 1000);
+        REQUIRE(reader);
+
+        int expected = 0;
+        veigar::CallResult item;
+        while (reader->next(item, 1000)) {
+            int v = -1;
+            CHECK(item.convertObject(v));
+            CHECK(v == expected);
+            expected++;
+        }
+        CHECK(expected == 1000);
+        CHECK(reader->isEnded());
+        CHECK(reader->errorCode() == veigar::ErrorCode::SUCCESS);
+        CHECK(reader->errorMessage().empty());
+    }
+
+    {
+        std::shared_ptr<veigar::StreamReader> reader = vg2.streamCall(baseName + "-1", 100, "fail");
+        REQUIRE(reader);
+
+        std::vector<std::string> items;
+        veigar::CallResult item;
+        while (reader->next(item, 1000)) {
+            std::string s;
+            CHECK(item.convertObject(s));
+            items.push_back(s);
+        }
+        CHECK(items == std::vector<std::string>({"0", "1", "2"}));
+        CHECK(reader->isEnded());
+        CHECK(reader->errorMessage() == "bad");
+    }
+
+    {
+        std::shared_ptr<veigar::StreamReader> reader = vg2.streamCall(baseName + "-1", 100, "throw");
+        REQUIRE(reader);
+
+        veigar::CallResult item;
+        while (reader->next(item, 1000)) {
+        }
+        CHECK(reader->isEnded());
+        CHECK(!reader->errorMessage().empty());
+    }
+
+    // The function stops once the reader is gone.
+    {
+        std::shared_ptr<veigar::StreamReader> reader = vg2.streamCall(baseName + "-1", 100, "endless");
+        REQUIRE(reader);
+
+        veigar::CallResult item;
+        for (int i = 0; i < 100; i++) {
+            CHECK(reader->next(item, 1000));
+        }
+        CHECK(!reader->isEnded());
+    }
+    for (int i = 0; i < 100 && !cancelled.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(cancelled.load());
+
+    // Stream functions and plain functions can not be mixed up.
+    veigar::CallResult cr = vg2.syncCall(baseName + "-1", 1000, "range", 1);
+    CHECK(!cr.isSuccess());
+    CHECK(!cr.errorMessage.empty());
+
+    {
+        std::shared_ptr<veigar::StreamReader> reader = vg2.streamCall(baseName + "-1", 100, "add", 1, 2);
+        REQUIRE(reader);
+
+        veigar::CallResult item;
+        CHECK(!reader->next(item, 1000));
+        CHECK(reader->isEnded());
+        CHECK(!reader->errorMessage().empty());
+    }
+
+    // A reader that outlives the instance no longer calls back into it.
+    {
+        std::shared_ptr<veigar::StreamReader> reader;
+        {
+            veigar::Veigar vg3;
+            REQUIRE(vg3.init(baseName + "-3"));
+            reader = vg3.streamCall(baseName + "-1", 100, "endless");
+            REQUIRE(reader);
+
+            veigar::CallResult item;
+            CHECK(reader->next(item, 1000));
+            vg3.uninit();
+        }
+
+        veigar::CallResult item;
+        while (reader->next(item, 10)) {
+        }
+        reader->cancel();
+    }
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-batch") {
+    std::string baseName = "call-batch-" + std::to_string(time(nullptr));
+
+    std::atomic<int> touched = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.bind("touch", [&touched]() { touched++; }));
+    CHECK(vg1.bind("echo", [](const std::string& s) { return s; }));
+    CHECK(vg1.bind("throw", []() { throw std::runtime_error("oops"); }));
+    CHECK(vg1.bindDeferred("deferred", [](veigar::Responder r) { r.respond(); }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    for (bool parallel : {false, true}) {
+        veigar::CallBatch batch;
+        batch.setParallel(parallel);
+        for (int i = 0; i < 1000; i++) {
+            batch.add("add", i, i);
+        }
+        batch.add("touch");
+        batch.add("echo", std::string("hello"));
+        batch.add("throw");
+        batch.add("deferred");
+        batch.add("not-exist", 1);
+        REQUIRE(batch.size() == 1005);
+
+        std::vector<veigar::CallResult> results = vg2.callBatch(baseName + "-1", 5000, batch);
+        REQUIRE(results.size() == 1005);
+
+        for (int i = 0; i < 1000; i++) {
+            REQUIRE(results[i].isSuccess());
+            int sum = 0;
+            CHECK(results[i].convertObject(sum));
+            CHECK(sum == i * 2);
+        }
+
+        CHECK(results[1000].isSuccess());
+
+        std::string s;
+        CHECK(results[1001].isSuccess());
+        CHECK(results[1001].convertObject(s));
+        CHECK(s == "hello");
+
+        CHECK(!results[1002].isSuccess());
+        CHECK(!results[1003].isSuccess());
+        CHECK(!results[1004].isSuccess());
+    }
+    CHECK(touched.load() == 2);
+
+    // The batch fails as a whole if the target does not exist.
+    veigar::CallBatch batch;
+    batch.add("add", 1, 2).add("add", 3, 4);
+    std::vector<veigar::CallResult> results = vg2.callBatch(baseName + "-not-exist", 200, batch);
+    REQUIRE(results.size() == 2);
+    CHECK(!results[0].isSuccess());
+    CHECK(!results[1].isSuccess());
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-all") {
+    std::string baseName = "call-all-" + std::to_string(time(nullptr));
+
+    std::vector<std::shared_ptr<veigar::Veigar>> targets;
+    std::vector<std::string> channels;
+    for (int i = 0; i < 4; i++) {
+        std::shared_ptr<veigar::Veigar> vg = std::make_shared<veigar::Veigar>();
+        CHECK(vg->bind("mul", [i](int a) { return a * i; }));
+        CHECK(vg->bind("slow", [i](int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms * i)); return i; }));
+        channels.push_back(baseName + "-" + std::to_string(i));
+        CHECK(vg->init(channels.back()));
+        targets.push_back(vg);
+    }
+
+    veigar::Veigar caller;
+    CHECK(caller.init(baseName + "-caller"));
+
+    std::mutex mutex;
+    std::vector<size_t> calledBack;
+    std::shared_ptr<veigar::MultiCallResult> mcr = caller.callAll(
+        [&](size_t index, const std::string& channel, const veigar::CallResult& ret) {
+            CHECK(ret.isSuccess());
+            std::lock_guard<std::mutex> lg(mutex);
+            CHECK(channel == channels[index]);
+            calledBack.push_back(index);
+        },
+        channels, 2000, "mul", 10);
+    REQUIRE(mcr);
+    REQUIRE(mcr->size() == channels.size());
+    REQUIRE(mcr->waitAll(3000));
+    CHECK(mcr->completedCount() == channels.size());
+    CHECK(calledBack.size() == channels.size());
+    for (size_t i = 0; i < channels.size(); i++) {
+        CHECK(mcr->isCompleted(i));
+        REQUIRE(mcr->result(i).isSuccess());
+        CHECK(mcr->result(i).obj.get().as<int>() == (int)i * 10);
+    }
+
+    // Wait for the first one, the target that sleeps the least answers first.
+    mcr = caller.callAll(channels, 5000, "slow", 300);
+    REQUIRE(mcr->waitFirst(1, 3000));
+    std::vector<size_t> order = mcr->completionOrder();
+    REQUIRE(!order.empty());
+    CHECK(order[0] == 0);
+    REQUIRE(mcr->waitAll(5000));
+    CHECK(mcr->completionOrder().size() == channels.size());
+
+    // A target that does not exist fails alone.
+    std::vector<std::string> withMissing = channels;
+    withMissing.push_back(baseName + "-not-exist");
+    mcr = caller.callAll(withMissing, 500, "mul", 1);
+    REQUIRE(mcr->waitAll(3000));
+    for (size_t i = 0; i < channels.size(); i++) {
+        CHECK(mcr->result(i).isSuccess());
+    }
+    CHECK(!mcr->result(channels.size()).isSuccess());
+
+    mcr = caller.callAll(std::vector<std::string>(), 500, "mul", 1);
+    CHECK(mcr->size() == 0);
+    CHECK(mcr->waitAll(0));
+
+    caller.uninit();
+    for (auto& vg : targets) {
+        vg->uninit();
+    }
+}
+
+TEST_CASE("inprocess-call-future") {
+    std::string baseName = "call-future-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.bind("sleep", [](int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); return ms; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+
+    // Chain a call on the result of another one.
+    veigar::CallFuture f = vg2.asyncCallFuture(target, 1000, "add", 1, 2)
+                               .then([&vg2, &target](const veigar::CallResult& ret) {
+                                   return vg2.asyncCallFuture(target, 1000, "add", ret.obj.get().as<int>(), 10);
+                               })
+                               .then([](const veigar::CallResult& ret) {
+                                   veigar::CallResult r;
+                                   r.errCode = ret.errCode;
+                                   r.obj = veigar_msgpack::clone(veigar_msgpack::object(ret.obj.get().as<int>() * 2));
+                                   return r;
+                               });
+    REQUIRE(f.wait(3000));
+    REQUIRE(f.result().isSuccess());
+    CHECK(f.result().obj.get().as<int>() == 26);
+
+    // Continuation on an executor.
+    std::atomic<int> posted = {0};
+    veigar::Executor executor = [&posted](std::function<void()> task) {
+        posted++;
+        std::thread(task).detach();
+    };
+    f = vg2.asyncCallFuture(target, 1000, "add", 2, 3).then([](const veigar::CallResult& ret) {
+        veigar::CallResult r;
+        r.errCode = ret.errCode;
+        r.errorMessage = ret.errorMessage;
+        r.obj = veigar_msgpack::clone(ret.obj.get());
+        return r;
+    },
+                                                            executor);
+    REQUIRE(f.wait(3000));
+    CHECK(f.result().obj.get().as<int>() == 5);
+    CHECK(posted.load() == 1);
+
+    // A throwing continuation fails the next future.
+    f = vg2.asyncCallFuture(target, 1000, "add", 2, 3).then([](const veigar::CallResult&) -> veigar::CallResult {
+        throw std::runtime_error("oops");
+    });
+    REQUIRE(f.wait(3000));
+    CHECK(!f.result().isSuccess());
+    CHECK(f.result().errorMessage == "oops");
+
+    // when_all / when_any
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < 10; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 2000, "add", i, i));
+    }
+    veigar::CallFuture all = veigar::CallFuture::WhenAll(futures);
+    REQUIRE(all.wait(3000));
+    CHECK(all.result().isSuccess());
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(futures[i].isReady());
+        CHECK(futures[i].result().obj.get().as<int>() == i * 2);
+    }
+
+    futures.clear();
+    futures.push_back(vg2.asyncCallFuture(target, 3000, "sleep", 1000));
+    futures.push_back(vg2.asyncCallFuture(target, 3000, "sleep", 10));
+    veigar::CallFuture any = veigar::CallFuture::WhenAny(futures);
+    REQUIRE(any.wait(3000));
+    CHECK(any.result().isSuccess());
+    CHECK(any.result().obj.get().as<int>() == 10);
+
+    // A failed call fails when_all.
+    futures.push_back(vg2.asyncCallFuture(target, 1000, "not-exist"));
+    all = veigar::CallFuture::WhenAll(futures);
+    REQUIRE(all.wait(5000));
+    CHECK(!all.result().isSuccess());
+
+    CHECK(veigar::CallFuture::WhenAll({}).isReady());
+    CHECK(!veigar::CallFuture().isValid());
+
+    vg1.uninit();
+    vg2.uninit();
+}
+
+TEST_CASE("inprocess-call-callback-policy") {
+    std::string baseName = "call-cb-policy-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    const std::string target = baseName + "-1";
+
+    std::atomic<int> posted = {0};
+    veigar::Executor executor = [&posted](std::function<void()> task) {
+        posted++;
+        std::thread(task).detach();
+    };
+
+    for (veigar::CallbackPolicy policy : {veigar::CallbackPolicy::INLINE, veigar::CallbackPolicy::POOL, veigar::CallbackPolicy::EXECUTOR}) {
+        veigar::Veigar vg2;
+        vg2.setCallbackPolicy(policy, executor);
+        CHECK(vg2.callbackPolicy() == policy);
+        CHECK(vg2.init(baseName + "-2-" + std::to_string((int)policy)));
+
+        std::atomic<int> slowDone = {0};
+        std::thread::id cbThread;
+        vg2.asyncCall(
+            [&slowDone, &cbThread](const veigar::CallResult& ret) {
+                CHECK(ret.isSuccess());
+                cbThread = std::this_thread::get_id();
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                slowDone++;
+            },
+            target, 1000, "add", 1, 2);
+
+        // Give the slow callback time to start.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // The promise is fulfilled on the response dispatcher thread, it must not wait for the slow callback
+        // unless the callbacks run inline.
+        veigar::CallResult ret = vg2.syncCall(target, 2000, "add", 3, 4);
+        CHECK(ret.isSuccess());
+        if (policy != veigar::CallbackPolicy::INLINE) {
+            CHECK(slowDone.load() == 0);
+        }
+
+        if (policy == veigar::CallbackPolicy::POOL) {
+            veigar::Statistics stats = vg2.statistics();
+            CHECK(stats.threads[(uint32_t)veigar::ThreadRole::RESULT_CALLBACK].threadNumber >= 1);
+        }
+
+        // uninit waits for the callbacks run by the pool.
+        while (policy == veigar::CallbackPolicy::EXECUTOR && slowDone.load() == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        vg2.uninit();
+        CHECK(slowDone.load() == 1);
+        CHECK(cbThread != std::this_thread::get_id());
+    }
+    CHECK(posted.load() == 1);
+
+    // A callback run by the pool that does not return only holds uninit up to VEIGAR_CALLBACK_DRAIN_TIMEOUT.
+    {
+        veigar::Veigar vg3;
+        vg3.setCallbackPolicy(veigar::CallbackPolicy::POOL);
+        CHECK(vg3.init(baseName + "-3"));
+
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        std::atomic<bool> entered = {false};
+        vg3.asyncCall(
+            [released, &entered](const veigar::CallResult&) {
+                entered.store(true);
+                released.wait();
+            },
+            target, 1000, "add", 1, 2);
+
+        for (int i = 0; i < 100 && !entered.load(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(entered.load());
+
+        vg3.uninit();
+        release.set_value();
+    }
+
+    // The instance can be destroyed from one of its result callbacks run by the pool.
+    {
+        veigar::Veigar* vg4 = new veigar::Veigar();
+        vg4->setCallbackPolicy(veigar::CallbackPolicy::POOL);
+        CHECK(vg4->init(baseName + "-4"));
+
+        std::promise<void> destroyed;
+        vg4->asyncCall(
+            [vg4, &destroyed](const veigar::CallResult&) {
+                vg4->uninit();
+                delete vg4;
+                destroyed.set_value();
+            },
+            target, 1000, "add", 1, 2);
+        REQUIRE(destroyed.get_future().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    }
+
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-send-queue-limit") {
+    std::string baseName = "call-send-limit-" + std::to_string(time(nullptr));
+
+    // A target whose call queue holds a single message and is never drained,
+    // so the calls pile up in the send queue of the caller.
+    const std::string target = baseName + "-target";
+    veigar::MessageQueue targetMQ(1, 256, veigar::kCallPriorityNumber);
+    REQUIRE(targetMQ.create(target + VEIGAR_CALL_QUEUE_NAME_SUFFIX));
+
+    const int kCallNumber = 20;
+
+    for (veigar::SendQueuePolicy policy : {veigar::SendQueuePolicy::FAIL_FAST, veigar::SendQueuePolicy::DROP_OLDEST, veigar::SendQueuePolicy::BLOCK}) {
+        veigar::Veigar vg;
+        veigar::SendQueueLimit limit;
+        limit.maxNumber = 2;
+        limit.policy = policy;
+        vg.setSendQueueLimit(limit);
+        CHECK(vg.sendQueueLimit().maxNumber == 2);
+        REQUIRE(vg.init(baseName + "-" + std::to_string((int)policy), 1, 256));
+
+        std::vector<veigar::CallFuture> futures;
+        for (int i = 0; i < kCallNumber; i++) {
+            futures.push_back(vg.asyncCallFuture(target, 300, "add", i, i));
+        }
+
+        veigar::Statistics stats = vg.statistics();
+        CHECK(stats.callSendQueue.number <= 2);
+
+        int busy = 0;
+        int timeout = 0;
+        for (auto& f : futures) {
+            REQUIRE(f.wait(3000));
+            const veigar::CallResult& ret = f.result();
+            CHECK(!ret.isSuccess());
+            if (ret.errCode == veigar::ErrorCode::BUSY) {
+                busy++;
+            }
+            else if (ret.errCode == veigar::ErrorCode::TIMEOUT) {
+                timeout++;
+            }
+        }
+
+        stats = vg.statistics();
+        if (policy == veigar::SendQueuePolicy::FAIL_FAST) {
+            CHECK(busy > 0);
+            CHECK(stats.callSendQueue.rejectedNumber == busy);
+        }
+        else if (policy == veigar::SendQueuePolicy::DROP_OLDEST) {
+            CHECK(busy > 0);
+            CHECK(stats.callSendQueue.droppedNumber == busy);
+        }
+        else {
+            CHECK(busy == 0);
+            CHECK(timeout == kCallNumber);
+        }
+
+        vg.uninit();
+    }
+
+    targetMQ.close();
+}
+
+TEST_CASE("inprocess-call-admission") {
+    std::string baseName = "call-admission-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("slow", [](int a) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return a;
+    }));
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+    const int kCallNumber = 8;
+
+    // Only one call of 'slow' may be in flight, the others are shed.
+    vg1.setFunctionCallLimit("slow", 1);
+
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < kCallNumber; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 3000, "slow", i));
+    }
+
+    int succeeded = 0;
+    int overloaded = 0;
+    for (auto& f : futures) {
+        REQUIRE(f.wait(5000));
+        const veigar::CallResult& ret = f.result();
+        if (ret.isSuccess()) {
+            succeeded++;
+        }
+        else if (ret.errCode == veigar::ErrorCode::OVERLOADED) {
+            CHECK(!ret.errorMessage.empty());
+            overloaded++;
+        }
+    }
+    CHECK(succeeded >= 1);
+    CHECK(overloaded >= 1);
+    CHECK(succeeded + overloaded == kCallNumber);
+
+    veigar::Statistics stats = vg1.statistics();
+    CHECK(stats.shedCallNumber == overloaded);
+
+    // Other functions are not limited.
+    CHECK(vg2.syncCall(target, 1000, "add", 1, 2).isSuccess());
+
+    // Lifting the limit.
+    vg1.setFunctionCallLimit("slow", 0);
+    futures.clear();
+    for (int i = 0; i < 3; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 3000, "slow", i));
+    }
+    for (auto& f : futures) {
+        REQUIRE(f.wait(5000));
+        CHECK(f.result().isSuccess());
+    }
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-admission-deferred-batch") {
+    std::string baseName = "call-admission-deferred-" + std::to_string(time(nullptr));
+
+    std::mutex parkedMutex;
+    std::vector<veigar::Responder> parked;
+    std::atomic<bool> slowRunning = {false};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bindDeferred("park", [&parkedMutex, &parked](veigar::Responder r) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        parked.push_back(r);
+    }));
+    CHECK(vg1.bind("slow", [&slowRunning](int a) {
+        slowRunning = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        slowRunning = false;
+        return a;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+    vg1.setFunctionCallLimit("park", 1);
+    vg1.setFunctionCallLimit("slow", 1);
+
+    // A deferred call holds its slot until it responds.
+    veigar::CallFuture f1 = vg2.asyncCallFuture(target, 3000, "park");
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        if (parked.size() == 1)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(parked.size() == 1);
+
+    veigar::CallResult ret = vg2.syncCall(target, 1000, "park");
+    CHECK(ret.errCode == veigar::ErrorCode::OVERLOADED);
+
+    CHECK(parked[0].respond());
+    REQUIRE(f1.wait(3000));
+    CHECK(f1.result().isSuccess());
+
+    // Or until its responder is destroyed.
+    veigar::CallFuture f2 = vg2.asyncCallFuture(target, 3000, "park");
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        if (parked.size() == 2)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    parkedMutex.lock();
+    REQUIRE(parked.size() == 2);
+    parked.clear();
+    parkedMutex.unlock();
+    REQUIRE(f2.wait(3000));
+    CHECK(!f2.result().isSuccess());
+
+    veigar::CallFuture f3 = vg2.asyncCallFuture(target, 3000, "park");
+    for (int i = 0; i < 100; i++) {
+        std::lock_guard<std::mutex> lg(parkedMutex);
+        if (parked.size() == 1)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    parkedMutex.lock();
+    REQUIRE(parked.size() == 1);
+    CHECK(parked[0].respond());
+    parkedMutex.unlock();
+    REQUIRE(f3.wait(3000));
+    CHECK(f3.result().isSuccess());
+
+    // The entries of a batch count against the function limits.
+    veigar::CallFuture f4 = vg2.asyncCallFuture(target, 3000, "slow", 1);
+    for (int i = 0; i < 100 && !slowRunning.load(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(slowRunning.load());
+
+    veigar::CallBatch batch;
+    batch.add("slow", 2);
+    std::vector<veigar::CallResult> results = vg2.callBatch(target, 3000, batch);
+    REQUIRE(results.size() == 1);
+    CHECK(!results[0].isSuccess());
+    CHECK(results[0].errCode == veigar::ErrorCode::OVERLOADED);
+    CHECK(results[0].errorMessage.find("overloaded") != std::string::npos);
+
+    REQUIRE(f4.wait(3000));
+    CHECK(f4.result().isSuccess());
+
+    results = vg2.callBatch(target, 3000, batch);
+    REQUIRE(results.size() == 1);
+    CHECK(results[0].isSuccess());
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-deadline") {
+    std::string baseName = "call-deadline-" + std::to_string(time(nullptr));
+
+    std::atomic<int> slowRun = {0};
+    std::atomic<int64_t> remainingMS = {-2};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("slow", [&slowRun](int a) {
+        slowRun++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        return a;
+    }));
+    CHECK(vg1.bind("remaining", [&remainingMS]() {
+        veigar::CallContext ctx = veigar::CallContext::Current();
+        CHECK(ctx.isValid());
+        CHECK(!ctx.callId().empty());
+        CHECK(!ctx.callerChannelName().empty());
+        remainingMS = ctx.remainingMS();
+        return !ctx.isExpired();
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(!vg2.deadlinePropagation());
+    vg2.setDeadlinePropagation(true);
+    CHECK(vg2.deadlinePropagation());
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+
+    CHECK(!veigar::CallContext::Current().isValid());
+
+    // The handler sees the time remaining before the deadline of the caller.
+    veigar::CallResult ret = vg2.syncCall(target, 2000, "remaining");
+    REQUIRE(ret.isSuccess());
+    bool notExpired = false;
+    CHECK(ret.convertObject(notExpired));
+    CHECK(notExpired);
+    CHECK(remainingMS.load() > 0);
+    CHECK(remainingMS.load() <= 2000);
+
+    // Once all dispatcher threads are busy, the calls queued behind expire before they are dispatched.
+    const int kCallNumber = VEIGAR_DISPATCHER_THREAD_NUMBER * 3;
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < kCallNumber; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 100, "slow", i));
+    }
+    for (auto& f : futures) {
+        REQUIRE(f.wait(3000));
+        CHECK(f.result().errCode == veigar::ErrorCode::TIMEOUT);
+    }
+
+    // Wait for the dispatcher to drain the expired calls.
+    veigar::Statistics stats;
+    for (int i = 0; i < 300; i++) {
+        stats = vg1.statistics();
+        if (stats.expiredCallNumber + slowRun.load() == kCallNumber) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(slowRun.load() < kCallNumber);
+    CHECK(stats.expiredCallNumber == kCallNumber - slowRun.load());
+
+    // Without deadline propagation the calls are packed as before, the handler sees no deadline.
+    veigar::Veigar vg3;
+    CHECK(vg3.init(baseName + "-3"));
+    ret = vg3.syncCall(target, 2000, "remaining");
+    REQUIRE(ret.isSuccess());
+    CHECK(remainingMS.load() == -1);
+    vg3.uninit();
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-edf") {
+    std::string baseName = "call-edf-" + std::to_string(time(nullptr));
+
+    std::mutex orderMutex;
+    std::vector<std::string> order;
+
+    veigar::Veigar vg1;
+    vg1.setSchedulingPolicy(veigar::SchedulingPolicy::EDF);
+    CHECK(vg1.schedulingPolicy() == veigar::SchedulingPolicy::EDF);
+    CHECK(vg1.bind("block", [](int ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return ms;
+    }));
+    CHECK(vg1.bind("record", [&orderMutex, &order](std::string name) {
+        std::lock_guard<std::mutex> lg(orderMutex);
+        order.push_back(name);
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    vg2.setSchedulingPolicy(veigar::SchedulingPolicy::EDF);
+    vg2.setDeadlinePropagation(true);
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+
+    // Keep all dispatcher threads busy, they are released one by one.
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 10000, "block", 300 + i * 100));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Sent later, but with less time to spare.
+    futures.push_back(vg2.asyncCallFuture(target, 10000, "record", std::string("relaxed")));
+    futures.push_back(vg2.asyncCallFuture(target, 3000, "record", std::string("urgent")));
+
+    for (auto& f : futures) {
+        REQUIRE(f.wait(12000));
+        CHECK(f.result().isSuccess());
+    }
+
+    REQUIRE(order.size() == 2);
+    CHECK(order[0] == "urgent");
+    CHECK(order[1] == "relaxed");
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-fairness") {
+    std::string baseName = "call-fairness-" + std::to_string(time(nullptr));
+
+    std::mutex orderMutex;
+    std::vector<std::string> order;
+
+    veigar::Veigar vg1;
+    vg1.setFairnessPolicy(veigar::FairnessPolicy::CALLER);
+    CHECK(vg1.fairnessPolicy() == veigar::FairnessPolicy::CALLER);
+    CHECK(vg1.bind("block", [](int ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return ms;
+    }));
+    CHECK(vg1.bind("record", [&orderMutex, &order](std::string name) {
+        std::lock_guard<std::mutex> lg(orderMutex);
+        order.push_back(name);
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar noisy;
+    CHECK(noisy.init(baseName + "-noisy"));
+
+    veigar::Veigar quiet;
+    CHECK(quiet.init(baseName + "-quiet"));
+
+    veigar::Veigar heavy;
+    CHECK(heavy.init(baseName + "-heavy"));
+    vg1.setCallerWeight(baseName + "-heavy", 2);
+
+    const std::string target = baseName + "-1";
+
+    // Keep all dispatcher threads busy, they are released one by one.
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER; i++) {
+        futures.push_back(noisy.asyncCallFuture(target, 10000, "block", 300 + i * 100));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // The noisy caller queues first and the most.
+    for (int i = 0; i < 20; i++) {
+        futures.push_back(noisy.asyncCallFuture(target, 10000, "record", std::string("noisy")));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for (int i = 0; i < 2; i++) {
+        futures.push_back(quiet.asyncCallFuture(target, 10000, "record", std::string("quiet")));
+    }
+    for (int i = 0; i < 4; i++) {
+        futures.push_back(heavy.asyncCallFuture(target, 10000, "record", std::string("heavy")));
+    }
+
+    for (auto& f : futures) {
+        REQUIRE(f.wait(12000));
+        CHECK(f.result().isSuccess());
+    }
+
+    REQUIRE(order.size() == 26);
+
+    // One turn each: noisy 1, quiet 1, heavy 2; twice.
+    std::map<std::string, int> firstEight;
+    for (size_t i = 0; i < 8; i++) {
+        firstEight[order[i]]++;
+    }
+    CHECK(firstEight["noisy"] == 2);
+    CHECK(firstEight["quiet"] == 2);
+    CHECK(firstEight["heavy"] == 4);
+
+    heavy.uninit();
+    quiet.uninit();
+    noisy.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-shards") {
+    std::string baseName = "call-shards-" + std::to_string(time(nullptr));
+
+    veigar::Veigar vg1;
+    vg1.setCallQueueShards(0);
+    CHECK(vg1.callQueueShards() == 1);
+    vg1.setCallQueueShards(4);
+    CHECK(vg1.callQueueShards() == 4);
+    CHECK(vg1.bind("add", [](int a, int b) { return a + b; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Statistics stats = vg1.statistics();
+    CHECK(stats.callQueue.shardNumber == 4);
+    CHECK(stats.callQueue.memorySize > 0);
+
+    veigar::Veigar byHash;
+    CHECK(byHash.shardPolicy() == veigar::ShardPolicy::CALLER_HASH);
+    CHECK(byHash.init(baseName + "-2"));
+
+    veigar::Veigar byDepth;
+    byDepth.setShardPolicy(veigar::ShardPolicy::LEAST_DEPTH);
+    CHECK(byDepth.shardPolicy() == veigar::ShardPolicy::LEAST_DEPTH);
+    CHECK(byDepth.init(baseName + "-3"));
+
+    const std::string target = baseName + "-1";
+
+    // The calls spread over the shards are all dispatched, including those to itself.
+    std::vector<veigar::Veigar*> callers = {&byHash, &byDepth, &vg1};
+    std::vector<std::thread> threads;
+    std::atomic<int> succeeded = {0};
+    for (veigar::Veigar* caller : callers) {
+        threads.emplace_back([caller, &target, &succeeded]() {
+            std::vector<veigar::CallFuture> futures;
+            for (int i = 0; i < 100; i++) {
+                futures.push_back(caller->asyncCallFuture(target, 5000, "add", i, 1));
+            }
+
+            for (int i = 0; i < 100; i++) {
+                if (futures[i].wait(6000) && futures[i].result().isSuccess() && futures[i].result().obj.get().as<int>() == i + 1) {
+                    succeeded++;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(succeeded.load() == 300);
+
+    byDepth.uninit();
+    byHash.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-poll") {
+    std::string baseName = "call-poll-" + std::to_string(time(nullptr));
+
+    std::thread::id handlerThread;
+    veigar::Veigar vg1;
+    vg1.setPollMode(true);
+    CHECK(vg1.pollMode());
+    vg1.setCallQueueShards(2);
+    CHECK(vg1.bind("add", [&handlerThread](int a, int b) {
+        handlerThread = std::this_thread::get_id();
+        return a + b;
+    }));
+    CHECK(vg1.pollHandles().empty());
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    vg2.setPollMode(true);
+    CHECK(vg2.init(baseName + "-2"));
+
+    // 2 call queue shards and the response queue.
+    std::vector<veigar::PollHandle> handles1 = vg1.pollHandles();
+    std::vector<veigar::PollHandle> handles2 = vg2.pollHandles();
+    CHECK(handles1.size() == 3);
+    CHECK(handles2.size() == 2);
+
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < 20; i++) {
+        futures.push_back(vg2.asyncCallFuture(baseName + "-1", 5000, "add", i, 1));
+    }
+
+    // The calls and the responses are only dispatched by processReady of this thread.
+    int64_t start = time(nullptr);
+    bool allDone = false;
+    while (!allDone && time(nullptr) - start < 10) {
+#ifndef _WIN32
+        std::vector<pollfd> fds;
+        for (veigar::PollHandle h : handles1) {
+            fds.push_back({h, POLLIN, 0});
+        }
+        for (veigar::PollHandle h : handles2) {
+            fds.push_back({h, POLLIN, 0});
+        }
+        ::poll(fds.data(), (nfds_t)fds.size(), 100);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+        vg1.processReady();
+        vg2.processReady();
+
+        allDone = true;
+        for (auto& f : futures) {
+            if (!f.wait(0)) {
+                allDone = false;
+                break;
+            }
+        }
+    }
+    CHECK(allDone);
+    CHECK(handlerThread == std::this_thread::get_id());
+
+    int succeeded = 0;
+    for (int i = 0; i < 20; i++) {
+        if (futures[i].wait(0) && futures[i].result().isSuccess() && futures[i].result().obj.get().as<int>() == i + 1) {
+            succeeded++;
+        }
+    }
+    CHECK(succeeded == 20);
+
+    vg2.uninit();
+    vg1.uninit();
+    CHECK(vg1.processReady() == 0);
+}
+
+TEST_CASE("inprocess-call-threadless") {
+    std::string baseName = "call-threadless-" + std::to_string(time(nullptr));
+
+    const std::thread::id self = std::this_thread::get_id();
+    std::atomic<int> handlerOnSelf = {0};
+
+    veigar::Veigar vg1;
+    vg1.setThreadless(true);
+    CHECK(vg1.threadless());
+    CHECK(vg1.pollMode());
+    CHECK(vg1.bind("add", [self, &handlerOnSelf](int a, int b) {
+        if (std::this_thread::get_id() == self) {
+            handlerOnSelf++;
+        }
+        return a + b;
+    }));
+    CHECK(vg1.bindStream("range", [](veigar::StreamWriter w, int n) {
+        for (int i = 0; i < n; i++) {
+            w.write(i);
+        }
+        w.close();
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    vg2.setThreadless(true);
+    CHECK(vg2.init(baseName + "-2"));
+
+    veigar::Statistics stats = vg1.statistics();
+    for (uint32_t i = 0; i < veigar::kThreadRoleNumber; i++) {
+        CHECK(stats.threads[i].threadNumber == 0);
+    }
+
+    // Nothing is sent until vg2 is polled, nothing is run until vg1 is polled.
+    std::atomic<int> succeeded = {0};
+    std::atomic<int> callbackOnSelf = {0};
+    for (int i = 0; i < 50; i++) {
+        vg2.asyncCall([i, self, &succeeded, &callbackOnSelf](const veigar::CallResult& ret) {
+            if (ret.isSuccess() && ret.obj.get().as<int>() == i + 1) {
+                succeeded++;
+            }
+            if (std::this_thread::get_id() == self) {
+                callbackOnSelf++;
+            }
+        },
+                      baseName + "-1", 5000, "add", i, 1);
+    }
+    CHECK(vg1.poll(0, 0) == 0);
+
+    int64_t start = time(nullptr);
+    while (succeeded.load() < 50 && time(nullptr) - start < 10) {
+        vg2.poll(0, 1);
+        vg1.poll(0, 1);
+    }
+    CHECK(succeeded.load() == 50);
+    CHECK(callbackOnSelf.load() == 50);
+    CHECK(handlerOnSelf.load() == 50);
+
+    // The deadline passes while vg1 is not polled.
+    veigar::CallFuture late = vg2.asyncCallFuture(baseName + "-1", 100, "add", 1, 1);
+    start = time(nullptr);
+    while (!late.wait(0) && time(nullptr) - start < 10) {
+        vg2.poll(0, 10);
+    }
+    REQUIRE(late.wait(0));
+    CHECK(late.result().errCode == veigar::ErrorCode::TIMEOUT);
+
+    // Only poll drains the send queue and returns the credits, the calls fail at once instead of waiting for them.
+    {
+        veigar::Veigar vg4;
+        vg4.setThreadless(true);
+        veigar::SendQueueLimit sendLimit;
+        sendLimit.maxNumber = 2;
+        vg4.setSendQueueLimit(sendLimit);
+        REQUIRE(vg4.init(baseName + "-4"));
+
+        std::vector<veigar::CallFuture> futures;
+        for (int i = 0; i < 3; i++) {
+            futures.push_back(vg4.asyncCallFuture(baseName + "-1", 5000, "add", i, 1));
+        }
+        REQUIRE(futures[2].wait(0));
+        CHECK(futures[2].result().errCode == veigar::ErrorCode::BUSY);
+        CHECK(!futures[0].wait(0));
+        vg4.uninit();
+
+        veigar::Veigar vg5;
+        vg5.setThreadless(true);
+        veigar::FlowControlLimit creditLimit;
+        creditLimit.maxNumber = 1;
+        vg5.setFlowControl(creditLimit);
+        REQUIRE(vg5.init(baseName + "-5"));
+
+        veigar::CallFuture first = vg5.asyncCallFuture(baseName + "-1", 5000, "add", 1, 1);
+        veigar::CallFuture second = vg5.asyncCallFuture(baseName + "-1", 5000, "add", 2, 1);
+        REQUIRE(second.wait(0));
+        CHECK(second.result().errCode == veigar::ErrorCode::BUSY);
+        CHECK(!first.wait(0));
+        vg5.uninit();
+    }
+
+    // Stream functions need the instance's threads.
+    veigar::Veigar vg3;
+    CHECK(vg3.init(baseName + "-3"));
+    std::shared_ptr<veigar::StreamReader> reader = vg3.streamCall(baseName + "-1", 5000, "range", 10);
+    REQUIRE(reader);
+    veigar::CallResult item;
+    start = time(nullptr);
+    while (!reader->isEnded() && time(nullptr) - start < 10) {
+        vg1.poll(0, 10);
+        reader->next(item, 0);
+    }
+    CHECK(reader->isEnded());
+    CHECK(reader->errorCode() == veigar::ErrorCode::FAILED);
+
+    vg3.uninit();
+    vg2.uninit();
+    vg1.uninit();
+    CHECK(vg1.poll(0, 0) == 0);
+}
+
+TEST_CASE("inprocess-call-recv-buffers") {
+    std::string baseName = "call-recv-buffers-" + std::to_string(time(nullptr));
+
+    {
+        std::shared_ptr<veigar::RecvBufferPool> pool = std::make_shared<veigar::RecvBufferPool>();
+        veigar::RecvBufferPool::BufferPtr small = pool->acquire(100);
+        REQUIRE(small);
+        CHECK(small->capacity() == VEIGAR_RECV_BUFFER_MIN_SIZE);
+
+        // A returned buffer is reused by the next message of its size class.
+        uint8_t* data = small->data();
+        small.reset();
+        small = pool->acquire(VEIGAR_RECV_BUFFER_MIN_SIZE);
+        CHECK(small->data() == data);
+
+        veigar::RecvBufferPool::BufferPtr large = pool->acquire(VEIGAR_RECV_BUFFER_MAX_SIZE + 1);
+        REQUIRE(large);
+        CHECK(large->capacity() == VEIGAR_RECV_BUFFER_MAX_SIZE + 1);
+
+        veigar::Statistics stats;
+        pool->collectStatistics(stats);
+        CHECK(stats.recvBuffers.usedBytes == (int64_t)(VEIGAR_RECV_BUFFER_MIN_SIZE + VEIGAR_RECV_BUFFER_MAX_SIZE + 1));
+        CHECK(stats.recvBuffers.allocatedNumber == 2);
+        CHECK(stats.recvBuffers.reusedNumber == 1);
+
+        // A buffer larger than the size classes is not kept.
+        large.reset();
+        pool->collectStatistics(stats);
+        CHECK(stats.recvBuffers.pooledBytes == 0);
+
+        // The unpacked objects keep the buffer, even after the pool is gone.
+        veigar_msgpack::sbuffer sbuf;
+        veigar_msgpack::pack(sbuf, std::string("hello"));
+        veigar_msgpack::pack(sbuf, std::make_tuple(1, std::string("world")));
+        memcpy(small->data(), sbuf.data(), sbuf.size());
+
+        std::vector<veigar_msgpack::object_handle> objs;
+        veigar::RecvBufferPool::Unpack(small, sbuf.size(), objs);
+        REQUIRE(objs.size() == 2);
+        CHECK(small.use_count() > 1);
+        small.reset();
+        pool.reset();
+
+        CHECK(objs[0].get().as<std::string>() == "hello");
+        CHECK(std::get<1>(objs[1].get().as<std::tuple<int, std::string>>()) == "world");
+        objs.clear();
+    }
+
+    veigar::Veigar vg1;
+    vg1.setPollMode(true);
+    CHECK(vg1.bind("echo", [](const std::string& s) { return s; }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    vg2.setPollMode(true);
+    CHECK(vg2.init(baseName + "-2"));
+
+    // A burst of calls larger than expected, then small ones.
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < 5; i++) {
+        futures.push_back(vg2.asyncCallFuture(baseName + "-1", 5000, "echo", std::string(64 * 1024, 'a')));
+    }
+    for (int i = 0; i < 50; i++) {
+        futures.push_back(vg2.asyncCallFuture(baseName + "-1", 5000, "echo", std::string(10, 'b')));
+    }
+
+    int64_t start = time(nullptr);
+    size_t done = 0;
+    while (done < futures.size() && time(nullptr) - start < 10) {
+        vg1.processReady();
+        vg2.processReady();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        done = 0;
+        for (auto& f : futures) {
+            if (f.wait(0) && f.result().isSuccess()) {
+                done++;
+            }
+        }
+    }
+    CHECK(done == futures.size());
+
+    veigar::Statistics stats1 = vg1.statistics();
+    veigar::Statistics stats2 = vg2.statistics();
+    CHECK(stats1.recvBuffers.usedBytes == 0);
+    CHECK(stats2.recvBuffers.usedBytes == 0);
+    CHECK(stats1.recvBuffers.reusedNumber > 0);
+    CHECK(stats1.recvBuffers.pooledBytes > 0);
+    CHECK(stats1.recvBuffers.pooledBytes <= VEIGAR_RECV_BUFFER_POOL_MAX_BYTES);
+
+    // The pooled buffers are freed once idle.
+    std::this_thread::sleep_for(std::chrono::milliseconds(VEIGAR_RECV_BUFFER_IDLE_TRIM + 200));
+    vg1.processReady();
+    stats1 = vg1.statistics();
+    CHECK(stats1.recvBuffers.pooledBytes == 0);
+    CHECK(stats1.recvBuffers.trimmedNumber > 0);
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-cancel") {
+    std::string baseName = "call-cancel-" + std::to_string(time(nullptr));
+
+    std::atomic<int> blockRun = {0};
+    std::atomic<int> cancelObserved = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("block", [&blockRun](int ms) {
+        blockRun++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        return ms;
+    }));
+    CHECK(vg1.bind("poll", [&cancelObserved]() {
+        veigar::CallContext ctx = veigar::CallContext::Current();
+        for (int i = 0; i < 300 && !ctx.isCancelled(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (ctx.isCancelled()) {
+            cancelObserved++;
+        }
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+
+    CHECK(!vg2.cancel("unknown-call-id"));
+
+    // The running function observes the cancellation.
+    veigar::CallFuture pollFuture = vg2.asyncCallFuture(target, 10000, "poll");
+    REQUIRE(!pollFuture.callId().empty());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(vg2.cancel(pollFuture.callId()));
+    REQUIRE(pollFuture.wait(1000));
+    CHECK(pollFuture.result().errCode == veigar::ErrorCode::CANCELLED);
+    CHECK(!vg2.cancel(pollFuture.callId()));
+
+    for (int i = 0; i < 300 && cancelObserved.load() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(cancelObserved.load() == 1);
+
+    // Keep all dispatcher threads busy, then cancel calls that are pending on the target.
+    std::vector<veigar::CallFuture> blockers;
+    for (int i = 0; i < VEIGAR_DISPATCHER_THREAD_NUMBER; i++) {
+        blockers.push_back(vg2.asyncCallFuture(target, 10000, "block", 500));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const int kCancelNumber = 4;
+    std::vector<std::shared_ptr<veigar::AsyncCallResult>> pending;
+    for (int i = 0; i < kCancelNumber; i++) {
+        pending.push_back(vg2.asyncCall(target, 10000, "block", 10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (auto& acr : pending) {
+        CHECK(vg2.cancel(acr->first));
+        REQUIRE(acr->second.wait_for(std::chrono::milliseconds(1000)) == std::future_status::ready);
+        CHECK(acr->second.get().errCode == veigar::ErrorCode::CANCELLED);
+    }
+
+    for (auto& f : blockers) {
+        REQUIRE(f.wait(5000));
+        CHECK(f.result().isSuccess());
+    }
+
+    veigar::Statistics stats;
+    for (int i = 0; i < 300; i++) {
+        stats = vg1.statistics();
+        if (stats.cancelledCallNumber == kCancelNumber) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK(stats.cancelledCallNumber == kCancelNumber);
+    CHECK(blockRun.load() == VEIGAR_DISPATCHER_THREAD_NUMBER);
+
+    vg2.uninit();
+    vg1.uninit();
+
+    // A call still in the send queue is removed from it, towards a target that is never drained.
+    const std::string stuckTarget = baseName + "-stuck";
+    veigar::MessageQueue stuckMQ(1, 256, veigar::kCallPriorityNumber);
+    REQUIRE(stuckMQ.create(stuckTarget + VEIGAR_CALL_QUEUE_NAME_SUFFIX));
+
+    // The sender waiting for space holds the rw-lock of the target until the call times out,
+    // and the other senders wait for it, so the calls beyond the senders stay queued for a while.
+    // The rw-lock timeout must stay below the call timeout.
+    veigar::Veigar vg3;
+    vg3.setTimeoutOfRWLock(500);
+    REQUIRE(vg3.init(baseName + "-3", 1, 256));
+
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < VEIGAR_SEND_CALL_THREAD_NUMBER + 4; i++) {
+        futures.push_back(vg3.asyncCallFuture(stuckTarget, 2000, "block", i));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(vg3.statistics().callSendQueue.number >= 4);
+
+    CHECK(vg3.cancel(futures.back().callId()));
+    REQUIRE(futures.back().wait(100));
+    CHECK(futures.back().result().errCode == veigar::ErrorCode::CANCELLED);
+
+    for (auto& f : futures) {
+        REQUIRE(f.wait(5000));
+    }
+
+    // A call blocked in a sender waiting for the target can be cancelled,
+    // the send that times out afterwards must not complete it a second time.
+    std::vector<std::shared_ptr<veigar::AsyncCallResult>> blocked;
+    for (int i = 0; i < VEIGAR_SEND_CALL_THREAD_NUMBER; i++) {
+        blocked.push_back(vg3.asyncCall(stuckTarget, 1000, "block", i));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    for (auto& acr : blocked) {
+        REQUIRE(acr);
+        CHECK(vg3.cancel(acr->first));
+        REQUIRE(acr->second.wait_for(std::chrono::milliseconds(100)) == std::future_status::ready);
+        CHECK(acr->second.get().errCode == veigar::ErrorCode::CANCELLED);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    vg3.uninit();
+    stuckMQ.close();
+}
+
+TEST_CASE("inprocess-call-flow-control") {
+    std::string baseName = "call-flow-control-" + std::to_string(time(nullptr));
+
+    std::atomic<int> running = {0};
+    std::atomic<int> maxRunning = {0};
+
+    veigar::Veigar vg1;
+    CHECK(vg1.bind("slow", [&running, &maxRunning](int ms) {
+        int r = ++running;
+        int m = maxRunning.load();
+        while (r > m && !maxRunning.compare_exchange_weak(m, r)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        running--;
+        return ms;
+    }));
+    CHECK(vg1.init(baseName + "-1"));
+
+    veigar::Veigar vg2;
+    veigar::FlowControlLimit limit;
+    limit.maxNumber = 2;
+    vg2.setFlowControl(limit);
+    CHECK(vg2.flowControl().maxNumber == 2);
+    CHECK(vg2.init(baseName + "-2"));
+
+    const std::string target = baseName + "-1";
+
+    // The caller waits for credits, at most 2 calls are in flight.
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < 6; i++) {
+        futures.push_back(vg2.asyncCallFuture(target, 3000, "slow", 100));
+        CHECK(vg2.statistics().flowControl.number <= 2);
+    }
+    for (auto& f : futures) {
+        REQUIRE(f.wait(5000));
+        CHECK(f.result().isSuccess());
+    }
+    CHECK(maxRunning.load() <= 2);
+
+    veigar::Statistics stats = vg2.statistics();
+    CHECK(stats.flowControl.number == 0);
+    CHECK(stats.flowControl.bytes == 0);
+    CHECK(stats.flowControl.waitedNumber > 0);
+
+    // Out of credit for longer than the timeout of the call.
+    futures.clear();
+    futures.push_back(vg2.asyncCallFuture(target, 3000, "slow", 500));
+    futures.push_back(vg2.asyncCallFuture(target, 3000, "slow", 500));
+    veigar::CallFuture late = vg2.asyncCallFuture(target, 100, "slow", 1);
+    REQUIRE(late.wait(1000));
+    CHECK(late.result().errCode == veigar::ErrorCode::TIMEOUT);
+    CHECK(vg2.statistics().flowControl.timeoutNumber == 1);
+
+    for (auto& f : futures) {
+        REQUIRE(f.wait(5000));
+        CHECK(f.result().isSuccess());
+    }
+
+    vg2.uninit();
+    vg1.uninit();
+}
+
+TEST_CASE("inprocess-call-queue-full-policy") {
+    std::string baseName = "call-queue-full-policy-" + std::to_string(time(nullptr));
+
+    // The policy is set by the owner of the queue and read by the callers.
+    veigar::Veigar vg1;
+    vg1.setCallQueueFullPolicy(veigar::QueueFullPolicy::REJECT);
+    vg1.setResponseQueueFullPolicy(veigar::QueueFullPolicy::DROP_OLDEST);
+    CHECK(vg1.callQueueFullPolicy() == veigar::QueueFullPolicy::REJECT);
+    CHECK(vg1.responseQueueFullPolicy() == veigar::QueueFullPolicy::DROP_OLDEST);
+    REQUIRE(vg1.init(baseName + "-1"));
+
+    veigar::MessageQueue peekMQ(200, 10240, veigar::kCallPriorityNumber);
+    REQUIRE(peekMQ.open(baseName + "-1" + VEIGAR_CALL_QUEUE_NAME_SUFFIX));
+    CHECK(peekMQ.fullPolicy() == veigar::QueueFullPolicy::REJECT);
+    peekMQ.close();
+    vg1.uninit();
+
+    veigar::Veigar vg2;
+    REQUIRE(vg2.init(baseName + "-2", 1, 256));
+
+    // REJECT: the calls fail at once instead of waiting for their timeout, the queued one is kept.
+    const std::string rejectTarget = baseName + "-reject";
+    veigar::MessageQueue rejectMQ(1, 256, veigar::kCallPriorityNumber);
+    rejectMQ.setFullPolicy(veigar::QueueFullPolicy::REJECT);
+    REQUIRE(rejectMQ.create(rejectTarget + VEIGAR_CALL_QUEUE_NAME_SUFFIX));
+
+    veigar::CallFuture queued = vg2.asyncCallFuture(rejectTarget, 3000, "func");
+    for (int i = 0; i < 100 && rejectMQ.msgNumber() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(rejectMQ.msgNumber() == 1);
+
+    const auto start = std::chrono::steady_clock::now();
+    veigar::CallResult rejected = vg2.syncCall(rejectTarget, 3000, "func");
+    CHECK(rejected.errCode == veigar::ErrorCode::OVERLOADED);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1000));
+    CHECK(rejectMQ.msgNumber() == 1);
+    CHECK(rejectMQ.fullCounters().rejectedNumber == 1);
+    CHECK(rejectMQ.fullCounters().droppedNumber == 0);
+
+    // DROP_OLDEST: the callers never wait, the calls dropped time out.
+    const std::string dropTarget = baseName + "-drop";
+    veigar::MessageQueue dropMQ(1, 256, veigar::kCallPriorityNumber);
+    dropMQ.setFullPolicy(veigar::QueueFullPolicy::DROP_OLDEST);
+    REQUIRE(dropMQ.create(dropTarget + VEIGAR_CALL_QUEUE_NAME_SUFFIX));
+
+    std::vector<veigar::CallFuture> futures;
+    for (int i = 0; i < 5; i++) {
+        futures.push_back(vg2.asyncCallFuture(dropTarget, 300, "func", i));
+    }
+    for (auto& f : futures) {
+        REQUIRE(f.wait(3000));
+        CHECK(f.result().errCode == veigar::ErrorCode::TIMEOUT);
+    }
+    CHECK(dropMQ.msgNumber() == 1);
+    CHECK(dropMQ.fullCounters().droppedNumber == 4);
+    CHECK(dropMQ.fullCounters().blockedNumber == 0);
+
+    // BLOCK: the counters of the own queues are in the statistics.
+    veigar::Statistics stats = vg2.statistics();
+    CHECK(stats.callQueue.droppedNumber == 0);
+    CHECK(stats.callQueue.rejectedNumber == 0);
+    CHECK(stats.responseQueue.blockedNumber == 0);
+
+    REQUIRE(queued.wait(5000));
+    vg2.uninit();
+    dropMQ.close();
+    rejectMQ.close();
+}
@@ -190,4 +190,180 @@ TEST_CASE("mq-multi-thread-push-pop") {
     REQUIRE(popFailed == 0);
     REQUIRE(popRWLockFailed == 0);
     REQUIRE(pushRWLockFailed == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("mq-priority-lanes") {
+    std::string mqPath = "mq-priority-lanes-" + std::to_string(time(nullptr));
+
+    veigar::MessageQueue mq(10, 20, 3);
+    REQUIRE(mq.create(mqPath));
+    REQUIRE(mq.laneNumber() == 3);
+
+    for (uint32_t lane = 0; lane < 3; lane++) {
+        for (int i = 0; i < 8; i++) {
+            const std::string data = std::to_string(lane);
+            REQUIRE(mq.pushBack(data.c_str(), data.size() + 1, lane));
+        }
+    }
+    REQUIRE(mq.msgNumber() == 24);
+    REQUIRE(mq.msgNumber(1) == 8);
+
+    char buf[20] = {0};
+    int64_t written = 0;
+    uint32_t lane = 0;
+
+    // STRICT: the highest lane is always drained first.
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(mq.popFront(buf, 20, written, &lane));
+        REQUIRE(lane == 2);
+        REQUIRE(std::string(buf) == "2");
+    }
+
+    // WEIGHTED: each round serves 4 HIGH, 2 NORMAL and 1 LOW.
+    mq.setPriorityPolicy(veigar::PriorityPolicy::WEIGHTED);
+    std::map<uint32_t, int> served;
+    for (int i = 0; i < 7; i++) {
+        REQUIRE(mq.popFront(buf, 20, written, &lane));
+        REQUIRE(std::string(buf) == std::to_string(lane));
+        served[lane]++;
+    }
+    REQUIRE(served[2] == 4);
+    REQUIRE(served[1] == 2);
+    REQUIRE(served[0] == 1);
+
+    // Lanes without messages do not block the others.
+    while (mq.msgNumber(1) > 0 || mq.msgNumber(0) > 0) {
+        REQUIRE(mq.popFront(buf, 20, written, &lane));
+        REQUIRE(lane != 2);
+    }
+    REQUIRE(mq.msgNumber() == 0);
+    REQUIRE(!mq.popFront(buf, 20, written, &lane));
+
+    mq.close();
+}
+
+TEST_CASE("mq-full-policy") {
+    std::string mqPath = "mq-full-policy-" + std::to_string(time(nullptr));
+
+    veigar::MessageQueue mq1(3, 10, 2);  // max size = 30 per lane
+    mq1.setFullPolicy(veigar::QueueFullPolicy::DROP_OLDEST);
+    REQUIRE(mq1.create(mqPath));
+
+    // The writers follow the policy of the creator.
+    veigar::MessageQueue mq2(3, 10, 2);
+    REQUIRE(mq2.open(mqPath));
+    REQUIRE(mq2.fullPolicy() == veigar::QueueFullPolicy::DROP_OLDEST);
+
+    // The oldest messages make room for the new ones.
+    for (int i = 0; i < 4; i++) {
+        const std::string data = "message-" + std::to_string(i);  // size = 10
+        REQUIRE(mq2.pushBack(data.c_str(), data.size() + 1));
+    }
+    REQUIRE(mq2.pushBack("a", 2));
+    REQUIRE(mq2.pushBack("b", 2));
+    REQUIRE(mq2.msgNumber() == 3);
+
+    // The other lane is not touched.
+    REQUIRE(mq2.pushBack("low", 4, 1));
+    REQUIRE(mq2.msgNumber(1) == 1);
+
+    char buf[20] = {0};
+    int64_t written = 0;
+    uint32_t lane = 0;
+    REQUIRE(mq1.popFront(buf, 20, written, &lane));
+    REQUIRE(std::string(buf) == "low");
+    REQUIRE(mq1.popFront(buf, 20, written, &lane));
+    REQUIRE(std::string(buf) == "message-3");
+    REQUIRE(mq1.popFront(buf, 20, written, &lane));
+    REQUIRE(std::string(buf) == "a");
+    REQUIRE(mq1.popFront(buf, 20, written, &lane));
+    REQUIRE(std::string(buf) == "b");
+    REQUIRE(!mq1.popFront(buf, 20, written, &lane));
+
+    // A message larger than the lane is not pushed by dropping everything.
+    bool waitable = true;
+    REQUIRE(!mq2.checkSpaceSufficient(40, waitable));
+    REQUIRE(!waitable);
+
+    REQUIRE(mq1.fullCounters().droppedNumber == 3);
+    REQUIRE(mq1.fullCounters().rejectedNumber == 0);
+
+    mq2.close();
+    mq1.close();
+}
+
+TEST_CASE("mq-full-policy-keep") {
+    std::string mqPath = "mq-full-policy-keep-" + std::to_string(time(nullptr));
+
+    veigar::MessageQueue mq1(3, 10);
+    mq1.setFullPolicy(veigar::QueueFullPolicy::DROP_OLDEST);
+    REQUIRE(mq1.create(mqPath));
+
+    veigar::MessageQueue mq2(3, 10);
+    REQUIRE(mq2.open(mqPath));
+
+    // The message that is not evictable stays in front, the one behind it is dropped.
+    REQUIRE(mq2.pushBack("keep", 5, 0, false));
+    mq2.notifyRead();
+    for (int i = 0; i < 3; i++) {
+        const std::string data = "m" + std::to_string(i);
+        REQUIRE(mq2.pushBack(data.c_str(), data.size() + 1));
+        mq2.notifyRead();
+    }
+    REQUIRE(mq2.msgNumber() == 3);
+    REQUIRE(mq1.msgNumberHint() == 3);
+    REQUIRE(mq1.fullCounters().droppedNumber == 1);
+
+    // The read notification of the dropped message is taken back.
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(mq1.waitForRead(0));
+    }
+    REQUIRE(!mq1.waitForRead(0));
+
+    char buf[20] = {0};
+    int64_t written = 0;
+    REQUIRE(mq1.popFront(buf, 20, written));
+    REQUIRE(std::string(buf) == "keep");
+    REQUIRE(written == 5);
+    REQUIRE(mq1.popFront(buf, 20, written));
+    REQUIRE(std::string(buf) == "m1");
+    REQUIRE(mq1.popFront(buf, 20, written));
+    REQUIRE(std::string(buf) == "m2");
+
+    // Nothing is dropped to make room when all messages are kept.
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(mq2.pushBack("keep", 5, 0, false));
+    }
+    REQUIRE(!mq2.pushBack("new", 4));
+    REQUIRE(mq2.msgNumber() == 3);
+
+    mq2.close();
+    mq1.close();
+}
+
+TEST_CASE("mq-poll-handle-reopen") {
+    std::string mqPath = "mq-poll-handle-reopen-" + std::to_string(time(nullptr));
+
+    veigar::MessageQueue reader(3, 10);
+    reader.setPollable(true);
+    REQUIRE(reader.create(mqPath));
+
+    veigar::MessageQueue writer(3, 10);
+    REQUIRE(writer.open(mqPath));
+    REQUIRE(writer.isPollable());
+
+    // Waking up a reader that is gone is harmless.
+    reader.close();
+    writer.notifyRead();
+
+    // The writer has to open the queue created again.
+    REQUIRE(reader.create(mqPath));
+    writer.close();
+    REQUIRE(writer.open(mqPath));
+    REQUIRE(!veigar::MessageQueue::WaitReady({reader.pollHandle()}, 0));
+    writer.notifyRead();
+    REQUIRE(veigar::MessageQueue::WaitReady({reader.pollHandle()}, 100));
+
+    writer.close();
+    reader.close();
+}
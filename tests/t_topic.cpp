@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) winsoft666.
+ * All rights reserved.
+ *
+ * This source code is licensed under the license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "catch.hpp"
+#include "veigar/veigar.h"
+#include "../src/broadcast_ring.h"
+
+TEST_CASE("broadcast-ring-lap") {
+    std::string name = "broadcast-ring-lap-" + std::to_string(time(nullptr));
+
+    veigar::BroadcastRing writer;
+    REQUIRE(writer.create(name, 256, 2, veigar::TopicPolicy::LAP));
+
+    veigar::BroadcastRing reader;
+    REQUIRE(reader.open(name));
+
+    const int32_t fast = reader.attach();
+    const int32_t slow = reader.attach();
+    REQUIRE(fast >= 0);
+    REQUIRE(slow >= 0);
+    REQUIRE(reader.readerNumber() == 2);
+
+    // 16 bytes header + 24 bytes payload per record.
+    const std::string data = "123456789012345678901234";
+    std::vector<uint8_t> buf;
+    uint64_t seq = 0;
+    uint64_t missed = 0;
+    for (uint64_t i = 0; i < 20; i++) {
+        REQUIRE(writer.write(data.c_str(), (int64_t)data.size(), 0));
+        REQUIRE(reader.read(fast, buf, seq, missed));
+        CHECK(seq == i);
+        CHECK(missed == 0);
+        CHECK(std::string(buf.begin(), buf.end()) == data);
+    }
+    CHECK(!reader.read(fast, buf, seq, missed));
+
+    // The slow reader has been lapped, it gets the newest records and is told how many it missed.
+    REQUIRE(reader.read(slow, buf, seq, missed));
+    CHECK(seq > 0);
+    CHECK(missed == seq);
+    for (uint64_t i = seq + 1; i < 20; i++) {
+        REQUIRE(reader.read(slow, buf, seq, missed));
+        CHECK(seq == i);
+        CHECK(missed == 0);
+    }
+    CHECK(!reader.read(slow, buf, seq, missed));
+
+    // Too large for the ring.
+    std::vector<uint8_t> large(512, 1);
+    CHECK(!writer.write(large.data(), (int64_t)large.size(), 0));
+
+    reader.detach(slow);
+    CHECK(reader.readerNumber() == 1);
+
+    reader.close();
+    writer.close();
+}
+
+TEST_CASE("broadcast-ring-block") {
+    std::string name = "broadcast-ring-block-" + std::to_string(time(nullptr));
+
+    veigar::BroadcastRing writer;
+    REQUIRE(writer.create(name, 128, 1, veigar::TopicPolicy::BLOCK));
+
+    veigar::BroadcastRing reader;
+    REQUIRE(reader.open(name));
+    const int32_t slot = reader.attach();
+    REQUIRE(slot >= 0);
+
+    // 32 bytes per record, the ring holds 4 of them.
+    const std::string data = "1234567890123456";
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(writer.write(data.c_str(), (int64_t)data.size(), 0));
+    }
+    CHECK(!writer.write(data.c_str(), (int64_t)data.size(), 50));
+
+    std::vector<uint8_t> buf;
+    uint64_t seq = 0;
+    uint64_t missed = 0;
+    REQUIRE(reader.read(slot, buf, seq, missed));
+    CHECK(seq == 0);
+    CHECK(writer.write(data.c_str(), (int64_t)data.size(), 0));
+
+    // Wraps around the end of the ring.
+    for (uint64_t i = 1; i < 5; i++) {
+        REQUIRE(reader.read(slot, buf, seq, missed));
+        CHECK(seq == i);
+        CHECK(missed == 0);
+    }
+
+    reader.detach(slot);
+    CHECK(writer.write(data.c_str(), (int64_t)data.size(), 0));
+
+    reader.close();
+    writer.close();
+}
+
+TEST_CASE("broadcast-ring-stall") {
+    std::string name = "broadcast-ring-stall-" + std::to_string(time(nullptr));
+
+    veigar::BroadcastRing writer;
+    REQUIRE(writer.create(name, 128, 1, veigar::TopicPolicy::BLOCK, 200));
+
+    veigar::BroadcastRing reader;
+    REQUIRE(reader.open(name));
+    const int32_t slot = reader.attach();
+    REQUIRE(slot >= 0);
+
+    const std::string data = "1234567890123456";
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(writer.write(data.c_str(), (int64_t)data.size(), 0));
+    }
+
+    // The reader does not read, the writer waits for it until the stall timeout.
+    CHECK(!writer.write(data.c_str(), (int64_t)data.size(), 50));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(writer.write(data.c_str(), (int64_t)data.size(), 0));
+    CHECK(writer.write(data.c_str(), (int64_t)data.size(), 0));
+
+    std::vector<uint8_t> buf;
+    uint64_t seq = 0;
+    uint64_t missed = 0;
+    REQUIRE(reader.read(slot, buf, seq, missed));
+    CHECK(seq == 2);
+    CHECK(missed == 2);
+
+    // Once it reads again, the writer waits for it again.
+    CHECK(writer.write(data.c_str(), (int64_t)data.size(), 0));
+    CHECK(!writer.write(data.c_str(), (int64_t)data.size(), 0));
+
+    reader.detach(slot);
+    reader.close();
+    writer.close();
+}
+
+TEST_CASE("topic-publish-subscribe") {
+    std::string baseName = "topic-pub-sub-" + std::to_string(time(nullptr));
+    const std::string topic = baseName + "-topic";
+
+    veigar::Veigar pub;
+    REQUIRE(pub.init(baseName + "-pub"));
+    CHECK(!pub.publish(topic, 1));
+    REQUIRE(pub.createTopic(topic));
+    CHECK(!pub.createTopic(topic));
+
+    veigar::Veigar sub1;
+    REQUIRE(sub1.init(baseName + "-sub1"));
+    veigar::Veigar sub2;
+    REQUIRE(sub2.init(baseName + "-sub2"));
+
+    CHECK(!sub1.subscribe(baseName + "-not-exist", [](const veigar::TopicEvent&) {}));
+
+    std::mutex mutex;
+    std::vector<int> events1;
+    std::vector<int> events2;
+    CHECK(sub1.subscribe(topic, [&](const veigar::TopicEvent& e) {
+        std::lock_guard<std::mutex> lg(mutex);
+        events1.push_back(e.obj.get().as<int>());
+    }));
+    CHECK(sub2.subscribe(topic, [&](const veigar::TopicEvent& e) {
+        std::lock_guard<std::mutex> lg(mutex);
+        events2.push_back(e.obj.get().as<int>());
+    }));
+
+    for (int i = 0; i < 100; i++) {
+        CHECK(pub.publish(topic, i));
+    }
+
+    for (int i = 0; i < 100; i++) {
+        {
+            std::lock_guard<std::mutex> lg(mutex);
+            if (events1.size() == 100 && events2.size() == 100)
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    {
+        std::lock_guard<std::mutex> lg(mutex);
+        REQUIRE(events1.size() == 100);
+        REQUIRE(events2.size() == 100);
+        for (int i = 0; i < 100; i++) {
+            CHECK(events1[i] == i);
+            CHECK(events2[i] == i);
+        }
+    }
+
+    sub1.unsubscribe(topic);
+    CHECK(pub.publish(topic, 100));
+
+    pub.destroyTopic(topic);
+    CHECK(!pub.publish(topic, 101));
+
+    sub2.uninit();
+    sub1.uninit();
+    pub.uninit();
+}
+
+TEST_CASE("topic-slow-subscriber") {
+    std::string baseName = "topic-slow-" + std::to_string(time(nullptr));
+    const std::string lapTopic = baseName + "-lap";
+    const std::string blockTopic = baseName + "-block";
+
+    veigar::Veigar pub;
+    REQUIRE(pub.init(baseName + "-pub"));
+    REQUIRE(pub.createTopic(lapTopic, veigar::TopicPolicy::LAP, 1024));
+    REQUIRE(pub.createTopic(blockTopic, veigar::TopicPolicy::BLOCK, 1024));
+
+    veigar::Veigar sub;
+    REQUIRE(sub.init(baseName + "-sub"));
+
+    std::atomic<bool> release = {false};
+    std::atomic<uint64_t> received = {0};
+    std::atomic<uint64_t> missed = {0};
+    CHECK(sub.subscribe(lapTopic, [&](const veigar::TopicEvent& e) {
+        while (!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        received++;
+        missed += e.missed;
+    }));
+
+    std::atomic<uint64_t> blockReceived = {0};
+    CHECK(sub.subscribe(blockTopic, [&](const veigar::TopicEvent&) {
+        while (!release.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        blockReceived++;
+    }));
+
+    const std::string data(100, 'a');
+    uint64_t blockPublished = 0;
+    for (int i = 0; i < 100; i++) {
+        CHECK(pub.publish(lapTopic, data));
+        if (pub.publish(blockTopic, data, 10))
+            blockPublished++;
+    }
+    // The blocking topic refuses the events which do not fit until the subscriber catches up.
+    CHECK(blockPublished < 100);
+
+    release.store(true);
+
+    for (int i = 0; i < 100; i++) {
+        if (received.load() + missed.load() == 100 && blockReceived.load() == blockPublished)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    CHECK(received.load() + missed.load() == 100);
+    CHECK(missed.load() > 0);
+    CHECK(blockReceived.load() == blockPublished);
+
+    sub.uninit();
+    pub.uninit();
+}